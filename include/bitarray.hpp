@@ -96,6 +96,42 @@ class BitField3D : public BitField {
      */
     uint64_t getRow(uint x, uint y) override;
 
+    /**
+     * @brief Sets the bits of a row that are set in the mask
+     * 
+     * @param x 
+     * @param y 
+     * @param mask 
+     * @return true 
+     * @return false 
+     */
+    bool setRowMask(uint x, uint y, uint64_t mask) override;
+
+    /**
+     * @brief Resets the bits of a row that are set in the mask
+     * 
+     * @param x 
+     * @param y 
+     * @param mask 
+     * @return true 
+     * @return false 
+     */
+    bool resetRowMask(uint x, uint y, uint64_t mask) override;
+
+    /**
+     * @brief Sets every bit that is set in the mask, under a single lock
+     * 
+     * @param mask 
+     */
+    void setMask(const BitField& mask) override;
+
+    /**
+     * @brief Resets every bit that is set in the mask, under a single lock
+     * 
+     * @param mask 
+     */
+    void resetMask(const BitField& mask) override;
+
     /**
      * @brief Returns a pointer to a transposed version of the bitfield (rotated) in the cache
      * 
@@ -160,9 +196,92 @@ class BitField3D : public BitField {
     friend class BitFieldCache;
 };
 
+/**
+ * @brief A frozen copy of a field together with its transposed version, read without any locks or virtual calls
+ *
+ * Rows are indexed the same way as in the BitField (x + y * 64), the transposed rows have x and z swapped.
+ */
+class BitFieldSnapshot {
+  private:
+    std::array<uint64_t, 64 * 64> rows_data{};
+    std::array<uint64_t, 64 * 64> transposed_data{};
+
+  public:
+    BitFieldSnapshot() {}
+
+    /**
+     * @brief Copies the field under its guard and builds the transposed version from the copy
+     *
+     * @param field
+     */
+    void capture(BitField3D& field);
+
+    /**
+     * @brief Zeroes out both versions, the same as capturing an empty field
+     *
+     */
+    void clear();
+
+    const uint64_t* rows() const {
+        return rows_data.data();
+    }
+    const uint64_t* transposedRows() const {
+        return transposed_data.data();
+    }
+
+    uint64_t getRow(uint x, uint y) const {
+        return rows_data[x + y * 64];
+    }
+    uint64_t getTransposedRow(uint x, uint y) const {
+        return transposed_data[x + y * 64];
+    }
+};
+
+/**
+ * @brief Copies of the planes where a field touches a neighbouring chunk, taken under the field's guard
+ *
+ * Reading a neighbour through getTransposed is not safe while other jobs mesh, the transposed version lives in the shared
+ * BitFieldCache and can be recycled mid read. A single plane is cheap enough to copy for every layer.
+ */
+class BitFieldBorder {
+  private:
+    std::array<uint64_t, 64> x_plane{};
+    std::array<uint64_t, 64> y_plane{};
+    std::array<uint64_t, 64> z_plane{};
+
+  public:
+    /**
+     * @brief Copies the rows at x, the same as getRow(x, row) for every row
+     *
+     */
+    void captureX(BitField3D& field, uint x);
+    /**
+     * @brief Copies the rows at y, the same as getRow(row, y) for every row
+     *
+     */
+    void captureY(BitField3D& field, uint y);
+    /**
+     * @brief Gathers the bits at z into rows of x, the same as getTransposed()->getRow(z, row) for every row
+     *
+     */
+    void captureZ(BitField3D& field, uint z);
+
+    void clear();
+
+    uint64_t getXRow(uint row) const {
+        return x_plane[row];
+    }
+    uint64_t getYRow(uint row) const {
+        return y_plane[row];
+    }
+    uint64_t getZRow(uint row) const {
+        return z_plane[row];
+    }
+};
+
 /**
  * @brief Cached rotated field
- * 
+ *
  */
 struct TCacheMember {
     size_t creator_id;
@@ -6,6 +6,7 @@
 #include <structure/serialization/serializer.hpp>
 #include <structure/bytearray.hpp>
 #include <structure/bitworks.hpp>
+#include <structure/palette_array.hpp>
 
 #include <vec_hash.hpp>
 
@@ -50,6 +51,11 @@ class SparseBlockArray {
         type_indexes[type] = layers.size();
         layers.push_back({type, Block{type}, field});
         present_types.push_back(type);
+
+        if (layout == PALETTE)
+            indexLayer(layers.size() - 1, field);
+        else
+            selectLayout();
         return true;
     }
 
@@ -77,10 +83,52 @@ class SparseBlockArray {
         return layers;
     }
 
+  public:
+    /**
+     * @brief How blocks are looked up, the layers are kept in both layouts since the mesher works with them
+     *
+     */
+    enum Layout {
+        LAYERED, // Every layer is checked until one has the block
+        PALETTE  // A packed index of the layer at every position, the palette is the list of layers
+    };
+
+    const static size_t palette_min_layers = 3; // With less layers checking them is as fast as the index
+    // The index takes 64 to 128KB however few blocks there are, chunks that are mostly air keep only their compressed layers
+    const static size_t palette_min_blocks = PaletteIndexArray::entry_count / 16;
+
+    /**
+     * @brief Switches the layout, building or dropping the palette index
+     *
+     * @param layout
+     */
+    void setLayout(Layout layout);
+
+    /**
+     * @brief Picks the layout from the content, the palette for dense chunks with many types of blocks
+     *
+     */
+    void selectLayout();
+
+    Layout getLayout() {
+        return layout;
+    }
+
   private:
     Block airBlock = {BLOCK_AIR_INDEX};
     CompressedBitField3D solid_field; // Registers solid blocks
 
+    Layout layout = LAYERED;
+    PaletteIndexArray palette_indexes{}; // Index of the layer + 1 at every position, zero is air
+
+    /**
+     * @brief Writes the blocks of a layer into the palette index where no other layer has a block yet
+     *
+     * @param layer_index
+     * @param field
+     */
+    void indexLayer(size_t layer_index, const BitField3D& field);
+
     bool altered = false;
 
     std::vector<Layer> layers;
@@ -109,9 +157,31 @@ class SparseBlockArray {
      * 
      * @param position 
      * @param block 
-     * @param dont_check if true ignores already existing block if there is one (will be faster)
+     * @param dont_check if true ignores already existing block if there is one (will be faster), only in the LAYERED layout
+     * and for blocks other than air
      */
     void setBlock(glm::ivec3 position, const Block& block, bool dont_check = false);
+
+    /**
+     * @brief Sets the block at every position that is set in the mask, a whole layer at a time instead of block by block
+     * 
+     * @param mask 
+     * @param block 
+     * @param dont_check if true ignores already existing blocks at the positions (will be faster), like in setBlock only in the
+     * LAYERED layout and for blocks other than air
+     */
+    void setRows(const BitField& mask, const Block& block, bool dont_check = false);
+
+    /**
+     * @brief Copies every block of another array moved by offset, blocks moved outside are skipped and air leaves the blocks here
+     * 
+     * Works with the layers of the source moved a row at a time, so it costs about the same for a full array as for a single block.
+     * 
+     * @param source a different array
+     * @param offset where the first block of the source lands, up to 63 blocks away in each direction
+     * @return true if any block landed in this array
+     */
+    bool paste(SparseBlockArray& source, const glm::ivec3& offset);
     
     /**
      * @brief Returns a block at position
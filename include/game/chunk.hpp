@@ -44,9 +44,13 @@ class Chunk: public SparseBlockArray{
 
         BitField3D::SimplificationLevel current_simplification = BitField3D::NONE;
 
+        uint64_t generation = 0; // Assigned by the ChunkMap on every insert, a chunk reusing freed memory gets a new one
+
         friend class ChunkMeshGenerator;
         friend class WorldGenerator;
         friend class TerrainManager;
+        friend class Terrain;
+        friend class ChunkMap;
 
         friend class Serializer;
 
@@ -56,6 +60,7 @@ class Chunk: public SparseBlockArray{
 
         const glm::ivec3& getWorldPosition() const { return worldPosition; }
         unsigned int GetSimplificationStep() const {return generated_simplification_step;}
+        uint64_t getGeneration() const { return generation; }
         void setWorldPosition(const glm::ivec3& position){ worldPosition = position; }
 };
 
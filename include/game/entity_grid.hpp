@@ -0,0 +1,76 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <vec_hash.hpp>
+
+class Entity;
+
+/**
+ * @brief Uniform grid spatial hash of entity bounding boxes, the broadphase for entity collisions
+ *
+ * Every entity gets an order when it is added, queries return entities sorted by it,
+ * so collisions are handled in the same order as a pass over the entities would.
+ */
+class EntityGrid {
+  public:
+    constexpr static float cell_size = 2.0f;
+
+  private:
+    struct Record {
+        size_t order;
+        glm::ivec3 cell_min;
+        glm::ivec3 cell_max;
+    };
+
+    std::unordered_map<Entity*, Record> records{};
+    std::unordered_map<glm::ivec3, std::vector<std::pair<size_t, Entity*>>, IVec3Hash, IVec3Equal> cells{}; // Order and entity
+    size_t next_order = 0;
+
+    std::vector<std::pair<size_t, Entity*>> found{}; // Scratch for queries
+
+    static glm::ivec3 cellOf(const glm::vec3& position) {
+        return glm::floor(position / cell_size);
+    }
+    static void bounds(const Entity& entity, glm::ivec3& cell_min, glm::ivec3& cell_max);
+
+    void link(Entity* entity, size_t order, const glm::ivec3& cell_min, const glm::ivec3& cell_max);
+    void unlink(Entity* entity, const glm::ivec3& cell_min, const glm::ivec3& cell_max);
+
+  public:
+    /**
+     * @brief Removes every entity and restarts the ordering
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Adds an entity after all the others, or moves it to the cells of its current position if it was added already
+     *
+     * @param entity
+     */
+    void update(Entity* entity);
+
+    /**
+     * @brief Removes an entity, has to be called before the entity is destroyed
+     *
+     * @param entity
+     */
+    void remove(Entity* entity);
+
+    /**
+     * @brief Finds the entities that could overlap a box, sorted by their order
+     *
+     * @param min
+     * @param max
+     * @param output cleared first
+     */
+    void query(const glm::vec3& min, const glm::vec3& max, std::vector<Entity*>& output);
+
+    size_t size() const {
+        return records.size();
+    }
+};
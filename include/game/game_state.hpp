@@ -1,6 +1,7 @@
 #pragma once
 
 #include <game/items/item.hpp>
+#include <game/entity_grid.hpp>
 #include <game/save_structure.hpp>
 #include <game/world/terrain.hpp>
 
@@ -9,6 +10,7 @@
 
 #include <filesystem>
 #include <list>
+#include <mutex>
 
 class TerrainManager;
 
@@ -23,6 +25,11 @@ class GameState {
     Terrain           terrain;
     std::list<Entity> entities;
 
+    // Broadphase of the entity collisions, rebuilt every tick and updated as entities move
+    EntityGrid entity_grid;
+    std::vector<Entity*> collision_candidates;
+    std::recursive_mutex entity_mutex; // Collision callbacks can add entities while the entities are updated
+
     LogicalItemInventory player_inventory{10, 5};
     LogicalItemInventory player_hotbar{9, 1};
 
@@ -52,6 +59,9 @@ class GameState {
     void saveEntities();
     void loadEntities();
 
+    // Saves the chunks that were unloaded and are no longer used by other threads
+    void saveReleasedChunks();
+
     friend class TerrainManager;
 
   public:
@@ -66,7 +76,10 @@ class GameState {
     void updateEntities(float deltatime);
 
     void addEntity(Entity entity) {
+        std::lock_guard lock(entity_mutex);
+
         entities.push_back(entity);
+        entity_grid.update(&entities.back());
     }
     
     /**
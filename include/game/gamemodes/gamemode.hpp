@@ -32,6 +32,7 @@ struct GameModeState{
     TerrainManager& terrain_manager;
     Scene& scene;
     std::function<void(Chunk* chunk, const glm::ivec3 position)> regenerateChunkMesh;
+    std::function<void(Chunk* chunk)> regenerateWholeChunkMesh;
 };
 
 /**
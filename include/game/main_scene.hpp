@@ -109,6 +109,10 @@ class MainScene : public Scene {
                                    [this](Chunk* chunk, glm::ivec3 position) {
                                        regenerateChunkMesh(chunk, position);
                                        updateVisibility = 1;
+                                   },
+                                   [this](Chunk* chunk) {
+                                       regenerateChunkMesh(chunk);
+                                       updateVisibility = 1;
                                    }};
 
     template <typename T, typename... Args> void AddGameMode(Args... args) {
@@ -226,6 +230,9 @@ class MainScene : public Scene {
     double         last_tick_time;
     Uniform<float> interpolation_time = Uniform<float>("model_interpolation_time");
 
+    double upload_budget_milliseconds = 4.0;            // Time a frame can spend uploading chunk meshes
+    std::chrono::microseconds edit_wait_budget{2000}; // Time a frame waits for edit remeshes to finish
+
     /**
 	 * @brief Reloads a chunks mesh
 	 * 
@@ -36,7 +36,7 @@ class Structure{
         using PositionSet = std::unordered_set<glm::ivec3, IVec3Hash, IVec3Equal>;
 
         /*
-            Places structure and returns all chunk positions that need updating
+            Places structure and returns the positions of the loaded chunks it changed
         */
         PositionSet place(const glm::ivec3& position, Terrain& world);   
         
@@ -10,8 +10,10 @@
 #include <game/game_state.hpp>
 
 #include <structure/service.hpp>
+#include <game/threadpool.hpp>
 
 #include <atomic>
+#include <chrono>
 #include <indexing.hpp>
 #include <thread>
 #include <mutex>
@@ -22,6 +24,9 @@
  * 
  */
 class TerrainManager {
+  public:
+    enum class ChunkStage { Absent, Generated, NeighboursReady, Meshed, Uploaded };
+
   private:
     ChunkMeshGenerator mesh_generator;
     std::shared_ptr<Generator> world_generator;
@@ -47,17 +52,108 @@ class TerrainManager {
     
     std::atomic<bool> should_mesh_loader_reset = 0;
 
-    std::atomic<size_t> generated_count = 0;
-
     void UnloadChunkColumn(const glm::ivec2& position);
 
     std::unique_ptr<Service> service_manager;
 
+    struct ChunkStatus {
+        ChunkStage stage = ChunkStage::Absent;
+        bool gets_mesh   = false; // The outer ring is only generated so the meshes inside have their neighbours
+    };
+
+    /**
+     * @brief Bookkeeping of a loaded region shared by all of its jobs
+     *
+     * Every planned chunk moves through the stages only when something happens to it or its neighbours,
+     * a chunk is promoted to NeighboursReady once its -X, -Y and -Z neighbours are generated (or are not part of the region,
+     * then they never come) and only then its mesh is generated, so faces across chunk borders are never skipped.
+     * The faces towards the +X, +Y and +Z neighbours belong to their meshes, a chunk is never meshed again when they arrive.
+     */
+    struct RegionSchedule {
+        glm::ivec3 around;
+        std::atomic<bool> cancelled = false;
+
+        std::mutex mutex;
+        std::unordered_map<glm::ivec3, ChunkStatus, IVec3Hash, IVec3Equal> chunks; // By world chunk position
+    };
+
+    std::shared_ptr<RegionSchedule> current_schedule = nullptr;
+
+    JobSystem jobs; // Generation and meshing
+
+    JobSystem edit_jobs{1}; // Remeshing of edited chunks, separate so edits never wait behind generation
+
+    std::mutex edit_mutex;
+    std::condition_variable edits_finished;
+    std::unordered_map<glm::ivec3, DirtyPlanes, IVec3Hash, IVec3Equal> pending_edits; // Merged until their job starts
+    std::atomic<size_t> edits_in_flight = 0;                                           // Pending and running edit jobs
+
+    /**
+     * @brief Plans the columns of the region around its center and submits their generation jobs
+     *
+     * @param schedule
+     */
+    void ScheduleRegion(const std::shared_ptr<RegionSchedule>& schedule);
+
+    /**
+     * @brief Loads or generates all chunks of a column
+     *
+     * @param schedule
+     * @param column_position relative to the center of the region
+     */
+    void GenerateColumn(RegionSchedule& schedule, const glm::ivec2& column_position);
+
+    /**
+     * @brief Moves the chunks of a column to Generated and promotes every chunk that it made ready
+     *
+     * @param schedule
+     * @param column_position relative to the center of the region
+     */
+    void OnColumnGenerated(const std::shared_ptr<RegionSchedule>& schedule, const glm::ivec2& column_position);
+
+    /**
+     * @brief Whether a chunk can be meshed, has to be locked
+     *
+     * @param schedule
+     * @param position
+     * @return true
+     * @return false
+     */
+    bool AreNeighboursReady(RegionSchedule& schedule, const glm::ivec3& position);
+
+    /**
+     * @brief Submits a mesh job for a chunk in the NeighboursReady stage
+     *
+     * @param schedule
+     * @param position
+     */
+    void SubmitMeshJob(const std::shared_ptr<RegionSchedule>& schedule, const glm::ivec3& position);
+
+    /**
+     * @brief Called from the mesh loader when a mesh reaches the gpu
+     *
+     * @param position
+     */
+    void OnMeshUploaded(const glm::ivec3& position);
+
+    /**
+     * @brief Cancels all pending jobs and waits for the running ones
+     *
+     */
+    void StopJobs();
+
+    /**
+     * @brief Cancels all pending edit remeshes and waits for the running one
+     *
+     */
+    void StopEdits();
+
   public:
     // Dont ask please, its for legacy support on 
     std::function<std::unique_ptr<MeshInterface>()> createMesh;
 
     TerrainManager(std::shared_ptr<Generator> world_generator);
+    ~TerrainManager();
 
 	/**
 	 * @brief Unload everything, chunks and meshes
@@ -77,6 +173,39 @@ class TerrainManager {
 
     void setGameState(std::shared_ptr<GameState> state);
 
+    /**
+     * @brief Returns the stage of a chunk in the currently loaded region, Absent if it isnt part of it
+     *
+     * @param position
+     * @return ChunkStage
+     */
+    ChunkStage getChunkStage(const glm::ivec3& position);
+
+    /**
+     * @brief Remeshes the dirty planes of an edited chunk on the edit lane, the mesh is uploaded before all others
+     *
+     * Edits of a chunk that is already waiting for its remesh are merged into it.
+     *
+     * @param position
+     * @param dirty
+     */
+    void remeshEdit(const glm::ivec3& position, const DirtyPlanes& dirty);
+
+    /**
+     * @brief Waits until all edit remeshes are done or the timeout runs out
+     *
+     * @param timeout
+     * @return true if all edits are done
+     * @return false
+     */
+    bool waitForEdits(std::chrono::microseconds timeout);
+
+    /**
+     * @brief Pending and running edit remeshes, read without locking so the render thread can check it every frame
+     *
+     */
+    size_t getPendingEditCount();
+
     ChunkMeshGenerator& getMeshGenerator(){
         return mesh_generator;
     }
@@ -89,5 +218,4 @@ class TerrainManager {
     void meshLoaderReset(){
         should_mesh_loader_reset = false;
     }
-
 };
@@ -6,6 +6,9 @@
 #include <queue>
 #include <memory>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
 
 /**
  * @brief A thread that can is put to sleep waiting for more work
@@ -34,4 +37,89 @@ class SleepyThread{
          * @param func 
          */
         void awake(const std::function<void(void)>& func);
-};
\ No newline at end of file
+};
+
+/**
+ * @brief A pool of workers that each have their own queue of jobs and steal from the others when they run out
+ * 
+ * Jobs with a lower priority value are picked first (chunks use their distance from the player),
+ * jobs with the same priority run in the order they were submitted.
+ */
+class JobSystem{
+    public:
+        using JobFunction = std::function<void(void)>;
+
+    private:
+        struct Job{
+            float priority;
+            size_t sequence;
+            JobFunction function;
+        };
+
+        // Heap comparator, the top is the job with the lowest priority value
+        struct JobOrder{
+            bool operator()(const Job& a, const Job& b) const {
+                if(a.priority != b.priority) return a.priority > b.priority;
+                return a.sequence > b.sequence;
+            }
+        };
+
+        struct Worker{
+            std::mutex mutex;
+            std::vector<Job> jobs; // Kept as a heap
+            std::thread thread;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+
+        std::atomic<size_t> next_worker = 0;
+        std::atomic<size_t> next_sequence = 0;
+
+        std::atomic<size_t> queued = 0; // Jobs waiting in any of the queues
+        std::atomic<size_t> running = 0; // Jobs currently being executed
+
+        std::mutex sleep_mutex;
+        std::condition_variable work_available;
+        std::condition_variable work_finished;
+        bool stopping = false;
+
+        void run(size_t index);
+        bool popJob(size_t index, Job& output);
+        bool popFrom(Worker& worker, Job& output);
+        int currentWorkerIndex() const;
+
+    public:
+        /**
+         * @brief Starts the workers
+         * 
+         * @param worker_count number of worker threads, 0 picks one less than the number of cores (at least one)
+         */
+        JobSystem(size_t worker_count = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem& other) = delete;
+        JobSystem& operator=(const JobSystem& other) = delete;
+
+        /**
+         * @brief Queue a job, jobs submitted from a worker go into its own queue
+         * 
+         * @param priority lower runs sooner
+         * @param function 
+         */
+        void submit(float priority, const JobFunction& function);
+
+        /**
+         * @brief Drops all jobs that didnt start yet, running jobs are left to finish
+         * 
+         */
+        void cancel();
+
+        /**
+         * @brief Blocks until all queues are empty and no job is running
+         * 
+         */
+        void wait();
+
+        size_t getWorkerCount() const { return workers.size(); }
+        size_t getQueuedCount() const { return queued; }
+};
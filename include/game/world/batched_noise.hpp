@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+
+#include <FastNoiseLite.h>
+
+/**
+ * @brief Settings of a 2D OpenSimplex2 noise, the part of FastNoiseLite the world generator uses
+ *
+ */
+struct NoiseSettings {
+    int seed                = 1337;
+    float frequency         = 0.01f;
+    bool fractal            = false; // FBm over the octaves when set
+    int octaves             = 3;
+    float lacunarity        = 2.0f;
+    float gain              = 0.5f;
+    float weighted_strength = 0.0f;
+};
+
+/**
+ * @brief 2D OpenSimplex2 noise that evaluates many points at once
+ *
+ * Batches are processed in vector lanes with the widest instructions the cpu supports (AVX2, SSE4.1 or plain scalar code),
+ * picked once at runtime. The lanes do the same float operations in the same order as FastNoiseLite::GetNoise(float, float),
+ * so the results are bit exact. The only exception is a build that lets the compiler fuse FastNoiseLites multiplications
+ * and additions (-march with FMA), the lanes never fuse so the values then differ by up to a few ulp (below 1e-6).
+ */
+class BatchedNoise {
+  public:
+    /**
+     * @brief Evaluates 'count' points with the settings of the noise
+     *
+     */
+    using Kernel = void (*)(const BatchedNoise& noise, const float* x, const float* y, size_t count, float* output);
+
+  private:
+    NoiseSettings settings{};
+    float fractal_bounding = 1.0f;
+
+    FastNoiseLite reference{}; // Configured the same way, used for single samples and by the scalar kernel
+
+  public:
+    BatchedNoise() {
+        configure({});
+    }
+
+    /**
+     * @brief Replaces all the settings
+     *
+     * @param settings
+     */
+    void configure(const NoiseSettings& settings);
+
+    const NoiseSettings& getSettings() const {
+        return settings;
+    }
+
+    // Scale of the first octave, keeps the fractal sum between -1 and 1
+    float getFractalBounding() const {
+        return fractal_bounding;
+    }
+
+    /**
+     * @brief Noise at a single point, between -1 and 1
+     *
+     * @param x
+     * @param y
+     * @return float
+     */
+    float sample(float x, float y) const {
+        return reference.GetNoise(x, y);
+    }
+
+    /**
+     * @brief Noise at 'count' points, output[i] is the same as sample(x[i], y[i])
+     *
+     * @param x
+     * @param y
+     * @param count
+     * @param output
+     */
+    void sample(const float* x, const float* y, size_t count, float* output) const;
+
+    /**
+     * @brief Returns the name of the kernel used on this cpu
+     *
+     * @return const char*
+     */
+    static const char* KernelName();
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <bit>
+
+#include <glm/glm.hpp>
+
+#include <game/blocks.hpp>
+
+/**
+ * @brief Integer conversions between world block positions and chunk positions
+ *
+ * CHUNK_SIZE is a power of two, so the chunk of a block is an arithmetic shift of its position and the position inside the
+ * chunk are the lowest bits. Shifts round towards negative infinity like floor does, block -1 is the last block of chunk -1.
+ */
+namespace ChunkCoordinates {
+
+static_assert(CHUNK_SIZE > 0 && (CHUNK_SIZE & (CHUNK_SIZE - 1)) == 0, "Chunk coordinates need a power of two CHUNK_SIZE");
+
+constexpr int shift = std::countr_zero(static_cast<unsigned>(CHUNK_SIZE));
+constexpr int mask  = CHUNK_SIZE - 1;
+
+inline glm::ivec3 ToChunk(const glm::ivec3& block_position) {
+    return {block_position.x >> shift, block_position.y >> shift, block_position.z >> shift};
+}
+
+/**
+ * @brief Position of a block inside its chunk, every component is between 0 and CHUNK_SIZE - 1
+ *
+ */
+inline glm::ivec3 ToLocal(const glm::ivec3& block_position) {
+    return {block_position.x & mask, block_position.y & mask, block_position.z & mask};
+}
+
+inline glm::ivec3 ToWorld(const glm::ivec3& chunk_position, const glm::ivec3& local_position) {
+    return chunk_position * CHUNK_SIZE + local_position;
+}
+
+} // namespace ChunkCoordinates
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <game/chunk.hpp>
+#include <structure/synchronization/epoch.hpp>
+#include <vec_hash.hpp>
+
+/**
+ * @brief A concurrent map of chunks by their position, lookups are lock free
+ *
+ * Chunks are spread over shards by the hash of their position, every shard is an open addressed table that is
+ * replaced as a whole by writers (copy on write) under the lock of the shard.
+ * Replaced tables and removed chunks are retired to an epoch domain, so they stay valid for readers that pinned it.
+ * Removing never waits for the readers, released chunks are kept in a list and handed out once their readers are gone.
+ */
+class ChunkMap {
+  private:
+    const static size_t shard_bits  = 6;
+    const static size_t shard_count = 1 << shard_bits;
+
+    struct Entry {
+        glm::ivec3 position;
+        Chunk* chunk = nullptr; // nullptr marks a free slot
+    };
+
+    struct Table {
+        std::vector<Entry> entries{}; // Power of two in size, at most half full
+        size_t count = 0;
+    };
+
+    struct alignas(64) Shard {
+        std::atomic<Table*> table = nullptr;
+        std::mutex mutex; // Held by writers
+    };
+
+    std::array<Shard, shard_count> shards{};
+    std::atomic<size_t> count = 0;
+    std::atomic<uint64_t> next_generation = 1;
+
+    struct Released {
+        std::unique_ptr<Chunk> chunk;
+        bool readers_gone = false;
+    };
+
+    // Chunks removed with release, until they are collected or reclaimed. Declared before the epochs, their retired
+    // callbacks still find the list when the domain is destroyed
+    std::mutex released_mutex;
+    std::unordered_multimap<glm::ivec3, Released, IVec3Hash, IVec3Equal> released{};
+
+    mutable Sync::EpochDomain epochs{};
+
+    static size_t hash(const glm::ivec3& position);
+    Shard& shardFor(size_t hash) {
+        return shards[hash >> (64 - shard_bits)];
+    }
+
+    // Copies a table with one entry added or removed (chunk = nullptr), needs the shard lock
+    static Table* rebuild(const Table* table, const glm::ivec3& position, Chunk* chunk);
+
+    // Adds a chunk if there is none at the position yet, returns the chunk at the position
+    Chunk* link(const glm::ivec3& position, Chunk* chunk);
+
+    // Replaces the table of a shard without a position, returns the chunk that was stored there
+    Chunk* unlink(const glm::ivec3& position);
+
+    // Keeps an unlinked chunk in the released list until the readers that could have found it are gone
+    void retireReleased(const glm::ivec3& position, Chunk* chunk);
+
+  public:
+    using Guard = Sync::EpochDomain::Guard;
+
+    ChunkMap() {}
+    ~ChunkMap();
+
+    ChunkMap(const ChunkMap&)            = delete;
+    ChunkMap& operator=(const ChunkMap&) = delete;
+
+    /**
+     * @brief Keeps every chunk found while the guard lives from being freed
+     *
+     * @return Guard
+     */
+    Guard pin() const {
+        return epochs.Pin();
+    }
+
+    /**
+     * @brief Lock free lookup, the chunk stays valid while the map is pinned
+     *
+     * @param position
+     * @return Chunk* nullptr if there is no chunk at the position
+     */
+    Chunk* find(const glm::ivec3& position) const;
+
+    /**
+     * @brief Adds a chunk if there is none at the position yet, it gets a new generation
+     *
+     * @param position
+     * @param chunk
+     * @return Chunk* the chunk at the position, the existing one when there was one already
+     */
+    Chunk* insert(const glm::ivec3& position, std::unique_ptr<Chunk> chunk);
+
+    /**
+     * @brief Removes a chunk without waiting, collectReleased hands it out once no reader can use it anymore
+     *
+     * @param position
+     */
+    void release(const glm::ivec3& position);
+
+    /**
+     * @brief Releases every chunk like release
+     *
+     */
+    void releaseAll();
+
+    /**
+     * @brief Returns the released chunks no reader uses anymore, never waits for the others
+     *
+     * @return std::vector<std::unique_ptr<Chunk>>
+     */
+    std::vector<std::unique_ptr<Chunk>> collectReleased();
+
+    /**
+     * @brief Puts a released chunk that wasnt collected yet back at its position, it gets a new generation
+     *
+     * @param position
+     * @return Chunk* the chunk at the position or nullptr if none was released there
+     */
+    Chunk* reclaim(const glm::ivec3& position);
+
+    /**
+     * @brief Returns how many released chunks were not collected or reclaimed yet
+     *
+     * @return size_t
+     */
+    size_t releasedCount();
+
+    /**
+     * @brief Removes a chunk without waiting, it is freed once its readers are gone
+     *
+     * @param position
+     */
+    void erase(const glm::ivec3& position);
+
+    size_t size() const {
+        return count.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <cstdint>
+#include <cstddef>
+
+#include <bitarray.hpp>
+#include <structure/bitworks.hpp>
+
+/**
+ * @brief Returns forward and backward visible faces between two neighbouring rows of a field
+ *
+ * @param solid_forward solid row in the current layer
+ * @param solid_backward solid row in the next layer
+ * @param field_forward field row in the current layer
+ * @param field_backward field row in the next layer
+ * @param transparent whether the field is a transparent block type
+ * @return std::tuple<uint64_t, uint64_t>
+ */
+inline std::tuple<uint64_t, uint64_t> ProcessFaceRowValues(
+    uint64_t solid_forward, uint64_t solid_backward, uint64_t field_forward, uint64_t field_backward, bool transparent) {
+
+    if (transparent) {
+        uint64_t allFacesX = (field_forward ^ field_backward) & ~(solid_forward | solid_backward);
+        return {field_forward & allFacesX, field_backward & allFacesX};
+    }
+    uint64_t possible_mask = solid_forward ^ solid_backward;
+
+    return std::tuple<uint64_t, uint64_t>{field_forward & possible_mask, field_backward & possible_mask};
+}
+
+/**
+ * @brief Visible face masks of a whole chunk for one block type, every layer of every axis in both directions
+ *
+ * All the masks are calculated in one pass over the snapshots with the widest vector instructions the cpu supports
+ * (AVX2, SSE2 or plain scalar code), picked once at runtime.
+ */
+class FaceMaskBuffer {
+  public:
+    enum Plane { X_FORWARD = 0, X_BACKWARD, Y_FORWARD, Y_BACKWARD, Z_FORWARD, Z_BACKWARD };
+
+    /**
+     * @brief Calculates masks for 'count' rows, comparing each row with the one 'next' rows after it
+     *
+     */
+    using Kernel = void (*)(const uint64_t* solid,
+                            const uint64_t* field,
+                            size_t next,
+                            size_t count,
+                            uint64_t* forward,
+                            uint64_t* backward,
+                            bool transparent);
+
+  private:
+    // Masks are stored the same way as the rows they were calculated from (x + y * 64)
+    std::array<std::array<uint64_t, 64 * 64>, 6> masks{};
+
+  public:
+    FaceMaskBuffer() {}
+
+    /**
+     * @brief Calculates all masks for the field, overwriting the previous ones
+     *
+     * @param solid snapshot of the chunks solid field
+     * @param field snapshot of the block types field
+     * @param transparent whether the block type is transparent
+     */
+    void compute(const BitFieldSnapshot& solid, const BitFieldSnapshot& field, bool transparent);
+
+    /**
+     * @brief Copies a plane of masks between a layer and the one after it
+     *
+     * @param plane
+     * @param layer 0 - 62
+     * @param output
+     * @return true if the plane has any faces
+     * @return false if its empty
+     */
+    bool getPlane(Plane plane, int layer, BitPlane<64>& output) const;
+
+    /**
+     * @brief Returns the name of the kernel used on this cpu
+     *
+     * @return const char*
+     */
+    static const char* KernelName();
+};
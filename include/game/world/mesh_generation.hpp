@@ -1,18 +1,24 @@
 #pragma once
 
 #include <game/world/terrain.hpp>
+#include <game/world/face_masks.hpp>
+#include <game/world/mesh_segments.hpp>
 
 #include <rendering/mesh_spec.hpp>
 #include <rendering/region_culler.hpp>
 #include <rendering/instanced_mesh.hpp>
 
 #include <structure/synchronization/threadlocal.hpp>
+#include <vec_hash.hpp>
 
 #include <mutex>
+#include <list>
 #include <blockarray.hpp>
 #include <glm/glm.hpp>
 #include <bit>
+#include <bitset>
 #include <atomic>
+#include <functional>
 
 /**
  * @brief A chunk that uses algorithms to generate meshes
@@ -27,14 +33,6 @@ class ChunkMeshGenerator {
         int height;
     };
 
-    struct OccludedPlane {
-        std::array<float, 4> occlusion = {0, 0, 0, 0};
-        BitPlane<64> plane;
-
-        int start = 0;  // Zeroes from the start that can be skipped
-        int end   = 64; // Zeroes to the bottom
-    };
-
     struct OcclusionPlane {
         std::array<uint64_t, 66> rows{};
         uint64_t left  = 0;
@@ -46,52 +44,99 @@ class ChunkMeshGenerator {
         unsigned bottom_right_corner : 1 = 0;
     };
 
+    /**
+     * @brief Greedy meshed faces of a plane sorted by their ambient occlusion key
+     *
+     * Every bit of a key is one of the occlusion offsets, all bits with the same key have the same occlusion values
+     * and are greedy meshed together. Only the keys in the order have valid first and count entries.
+     */
+    struct OcclusionFaces {
+        std::vector<Face> faces{};         // Faces of all keys, grouped by key
+        std::array<uint32_t, 256> first{}; // Index of the first face of the key
+        std::array<uint32_t, 256> count{}; // Number of faces of the key
+        std::bitset<256> present{};
+
+        std::array<uint8_t, 256> order{}; // Keys in the order their faces are meshed
+        size_t order_count = 0;
+    };
+
   private:
-    std::vector<Face>& greedyMeshPlane(BitPlane<64> rows, int start = 0, int end = 64);
+    /**
+     * @brief Generates greedy meshed faces from a plane of bits, the plane is consumed (zeroed out) in the process
+     *
+     * @param rows
+     * @return std::vector<Face>&
+     */
+    std::vector<Face>& greedyMeshPlane(BitPlane<64>& rows);
     bool generateChunkMesh(const glm::ivec3& position,
                            MeshInterface* output,
                            Chunk* group,
                            BitField3D::SimplificationLevel simplification_level);
 
+    /**
+     * @brief Generates a chunk mesh, optionally into segments and only for the dirty planes
+     *
+     * @param position
+     * @param output mesh to add faces to, ignored when segments are used
+     * @param group
+     * @param simplification_level
+     * @param segments if set faces are recorded into the segments instead of the output
+     * @param dirty if set only the dirty planes are meshed, the rest of the segments is kept
+     * @return true
+     * @return false
+     */
+    bool generateChunkMesh(const glm::ivec3& position,
+                           MeshInterface* output,
+                           Chunk* group,
+                           BitField3D::SimplificationLevel simplification_level,
+                           ChunkMeshSegments* segments,
+                           const DirtyPlanes* dirty);
+
+    // Segments of recently edited chunks, the most recent first
+    const static size_t max_edited_segments = 16;
+    std::mutex edited_segments_mutex;
+    std::list<std::unique_ptr<ChunkMeshSegments>> edited_segments;
+
+    std::unique_ptr<ChunkMeshSegments> takeSegments(Chunk* chunk);
+    void storeSegments(std::unique_ptr<ChunkMeshSegments> segments);
+    void dropSegments(const glm::ivec3& position);
+
     std::mutex meshLoadingMutex;
 
     struct MeshLoadingMember {
         glm::ivec3 position;
         std::unique_ptr<MeshInterface> mesh;
+        size_t edit_version = 0; // Edits of the chunk queued before the mesh was generated
     };
 
     std::queue<MeshLoadingMember> meshLoadingQueue;
+    std::queue<MeshLoadingMember> editLoadingQueue; // Meshes of edited chunks, uploaded before all others
+
+    // Count of edit meshes queued per chunk, regular meshes generated before the last one are stale and get dropped
+    std::unordered_map<glm::ivec3, size_t, IVec3Hash, IVec3Equal> edit_versions;
+
+    size_t getEditVersion(const glm::ivec3& position);
 
     Terrain* world = nullptr; // Points to the world relative to which you generate meshes, doesnt need to be set
 
-    void addToChunkMeshLoadingQueue(glm::ivec3 position, std::unique_ptr<MeshInterface> mesh);
+    std::function<void(const glm::ivec3&)> upload_callback = nullptr;
 
-    /**
-     * @brief Creates separate planes from one plane with occlusion values
-     *
-     * @param source_plane
-     * @param occlusion_plane
-     * @return std::vector<OccludedPlane>&
-     */
-    std::vector<OccludedPlane>& calculatePlaneAmbientOcclusion(BitPlane<64>& source_plane, OcclusionPlane& occlusion_plane);
+    void addToChunkMeshLoadingQueue(glm::ivec3 position, std::unique_ptr<MeshInterface> mesh, size_t edit_version);
+    void addToEditMeshLoadingQueue(glm::ivec3 position, std::unique_ptr<MeshInterface> mesh);
 
     /**
-     * @brief Returns two plains separated by the occlusion at the offset and information whether they are empty
+     * @brief Greedy meshes a plane split by occlusion key, in one sweep over its rows
      *
-     * Separates a plane to two planes, one plane of bits that are affected by the occlusion plane and the other that isnt,
-     * Doing this enough times separates a plane into all possible occlusion options finds each individual face with the same occlusion
-     * that can be greedy meshed later.
+     * Each row is split by the occlusion of all 8 offsets at once. Faces open from the rows above grow into the row where
+     * their columns still have the same key, the rest of the row starts new faces. This gives the same faces greedy meshing
+     * a separate plane of every key would, which are then grouped by key in the order halving the plane by each offset
+     * would mesh them.
      *
      * @param source_plane
      * @param occlusion_plane
-     * @param affects
-     * @param lookup_offset
-     * @return std::tuple<OccludedPlane, bool, OccludedPlane, bool>
+     * @return OcclusionFaces&
      */
-    std::tuple<OccludedPlane, bool, OccludedPlane, bool> segregatePlane(OccludedPlane& source_plane,
-                                                                        OcclusionPlane& occlusion_plane,
-                                                                        std::array<bool, 4> affects,
-                                                                        glm::ivec2 lookup_offset);
+    OcclusionFaces& calculatePlaneAmbientOcclusion(BitPlane<64>& source_plane, OcclusionPlane& occlusion_plane);
 
     /**
      * @brief Takes a plane, segregates occlusion and for each individual plane greedymeshes and inserts faces into a mesh
@@ -117,8 +162,35 @@ class ChunkMeshGenerator {
 
     std::atomic<bool> meshes_pending = false;
 
+  public:
+    struct FrameStats {
+        size_t queued              = 0; // Meshes still waiting for upload after the frame
+        size_t queued_edits        = 0; // Of which are meshes of edited chunks
+        size_t meshed              = 0; // Meshes generated since the previous frame
+        size_t uploaded            = 0; // Meshes uploaded in the frame
+        size_t uploaded_edits      = 0;
+        size_t dropped             = 0; // Meshes made stale by a newer edit mesh of the same chunk
+        double upload_milliseconds = 0;
+    };
+
+  private:
+    std::atomic<size_t> meshed_since_frame = 0;
+    double upload_budget_milliseconds      = 4.0;
+    FrameStats frame_stats{};
+
   public:
     ChunkMeshGenerator() {}
+
+    /**
+     * @brief Uploads queued meshes, meshes of edited chunks first
+     *
+     * Stops after the limit or when the upload budget is spent, at least one mesh is uploaded every call.
+     *
+     * @param buffer
+     * @param limit maximum number of uploaded meshes
+     * @return true if any mesh was uploaded
+     * @return false
+     */
     bool loadMeshFromQueue(RegionCuller& buffer, size_t limit = 1);
 
     /**
@@ -149,8 +221,49 @@ class ChunkMeshGenerator {
                                     std::unique_ptr<MeshInterface> mesh,
                                     BitField3D::SimplificationLevel simplification_level);
 
+    /**
+     * @brief Regenerates only the planes touched by an edit and sends the mesh to the edit loading queue
+     *
+     * The first edit of a chunk meshes it whole into segments, following edits reuse them.
+     * Calls for the same chunk must not run at the same time.
+     *
+     * @param chunk
+     * @param mesh
+     * @param dirty
+     * @return true
+     * @return false
+     */
+    bool syncUpdateAsyncUploadMesh(Chunk* chunk, std::unique_ptr<MeshInterface> mesh, const DirtyPlanes& dirty);
+
+    /**
+     * @brief Set how long loadMeshFromQueue can spend uploading meshes in a frame
+     *
+     * @param milliseconds
+     */
+    void setUploadBudget(double milliseconds) {
+        upload_budget_milliseconds = milliseconds;
+    }
+
+    /**
+     * @brief Stats of the last loadMeshFromQueue call, only read them from the thread that uploads
+     *
+     * @return const FrameStats&
+     */
+    const FrameStats& getFrameStats() const {
+        return frame_stats;
+    }
+
     void setWorld(Terrain* world) {
         this->world = world;
     }
+
+    /**
+     * @brief Set a function called from loadMeshFromQueue with the position of every mesh that was uploaded
+     *
+     * @param callback
+     */
+    void setUploadCallback(const std::function<void(const glm::ivec3&)>& callback) {
+        upload_callback = callback;
+    }
     void clear();
 };
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <vector>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include <bitarray.hpp>
+#include <game/blocks.hpp>
+#include <rendering/mesh_spec.hpp>
+#include <rendering/packed_face.hpp>
+
+/**
+ * @brief Planes of a chunk that have to be meshed again, one bit per layer for every axis
+ *
+ * Bit 0 is the layer across the chunk border (-1), bit n + 1 is the layer n (faces between blocks n and n + 1).
+ */
+struct DirtyPlanes {
+    std::array<std::bitset<65>, 3> layers{};
+
+    /**
+     * @brief Marks the planes a block change at a position inside the chunk touches
+     *
+     * Faces and their occlusion only depend on the layers they are between, so its the two layers around the block on each axis.
+     *
+     * @param position
+     */
+    void markBlock(const glm::ivec3& position) {
+        for (int axis = 0; axis < 3; axis++) {
+            layers[axis].set(position[axis]);     // layer before the block
+            layers[axis].set(position[axis] + 1); // layer after the block
+        }
+    }
+
+    /**
+     * @brief Marks the layer across the chunk border of an axis, used when the block was changed in the neighbouring chunk
+     *
+     * @param axis
+     */
+    void markBorder(int axis) {
+        layers[axis].set(0);
+    }
+
+    /**
+     * @brief Marks every plane, meshing with it is the same as meshing the whole chunk
+     *
+     */
+    void markAll() {
+        for (auto& axis : layers)
+            axis.set();
+    }
+
+    /**
+     * @brief Adds the planes of another change, so multiple edits can be remeshed at once
+     *
+     * @param other
+     */
+    void merge(const DirtyPlanes& other) {
+        for (int axis = 0; axis < 3; axis++)
+            layers[axis] |= other.layers[axis];
+    }
+
+    bool isDirty(int axis, int layer) const {
+        return layers[axis][layer + 1];
+    }
+};
+
+/**
+ * @brief Faces of a chunk mesh kept grouped by the block type and plane they come from
+ *
+ * Meshing a chunk into segments instead of a mesh allows remeshing just the planes an edit touched,
+ * the segments are then replayed into a mesh in the same order a full generation would add them.
+ * Faces are kept packed, so meshes that store packed faces take every segment in one copy.
+ */
+class ChunkMeshSegments : public MeshInterface {
+  public:
+    // Faces packed as PackedFace, two uint32 values per face. Planes of an axis only hold faces of that axis
+    using Segment = std::vector<uint32_t>;
+
+    struct OrderEntry {
+        BlockID type;
+        bool billboard;
+    };
+
+  private:
+    struct TypeSegments {
+        std::array<std::array<Segment, 65>, 3> planes{}; // [axis][layer + 1]
+        Segment billboards{};
+    };
+
+    std::unordered_map<BlockID, TypeSegments> types{};
+    Segment* current = nullptr;
+
+    std::vector<OrderEntry> layer_order{};   // Types in the order of the chunks layers
+    std::vector<BlockID> border_order{};     // Types in the order the faces across chunk borders were meshed
+    glm::vec3 world_position = {0, 0, 0};
+
+  public:
+    uint64_t generation = 0; // Generation of the chunk the segments belong to, only used to check they are still valid
+    glm::ivec3 position = {0, 0, 0};
+    BitField3D::SimplificationLevel simplification_level = BitField3D::NONE;
+
+    /**
+     * @brief Clears a plane segment and records all the following faces into it
+     *
+     * @param type
+     * @param axis
+     * @param layer -1 for the layer across the chunk border
+     */
+    void selectPlane(BlockID type, int axis, int layer);
+
+    /**
+     * @brief Clears the billboard segment of a type and records all the following faces into it
+     *
+     * @param type
+     */
+    void selectBillboards(BlockID type);
+
+    /**
+     * @brief Clears the segments across the chunk border of every type
+     *
+     */
+    void clearBorder();
+
+    /**
+     * @brief Sets the order the segments are replayed in, called after every (partial) generation
+     *
+     * @param layers
+     * @param border
+     * @param world_position
+     */
+    void setOrder(std::vector<OrderEntry>&& layers, std::vector<BlockID>&& border, const glm::vec3& world_position);
+
+    /**
+     * @brief Adds all segments into a mesh
+     *
+     * @param mesh
+     */
+    void replay(MeshInterface* mesh) const;
+
+    void addQuadFace(const glm::ivec3& position,
+                     float width,
+                     float height,
+                     int texture_index,
+                     FaceType type,
+                     Direction direction,
+                     const std::array<float, 4>& occlusion,
+                     const glm::vec3& world_position) override;
+    void emitFaces(std::span<const QuadFace> faces,
+                   int texture_index,
+                   FaceType type,
+                   Direction direction,
+                   const std::array<float, 4>& occlusion,
+                   const glm::vec3& world_position) override;
+    void preallocate(size_t size, FaceType type) override;
+    bool empty() override;
+    void shrink() override {}
+};
@@ -140,6 +140,39 @@ class RegionRegistry{
 
             return nullptr;
         }
+        /**
+         * @brief Returns every region registered for the space between min and max (max not included), each only once
+         * 
+         * Regions registered only outside of the space can still reach into it, get() doesn't find them there either.
+         * 
+         * @param min 
+         * @param max 
+         * @return std::vector<Region*> 
+         */
+        std::vector<Region*> getWithin(const glm::ivec3& min, const glm::ivec3& max){
+            glm::ivec3 subregion_min = glm::floor(glm::vec3(min) / subregion_size);
+            glm::ivec3 subregion_max = glm::floor(glm::vec3(max - 1) / subregion_size);
+
+            std::vector<Region*> output{};
+            std::unordered_set<Region*> already_found;
+
+            std::shared_lock lock(mutex);
+            for(int x = subregion_min.x;x <= subregion_max.x;x++)
+            for(int y = subregion_min.y;y <= subregion_max.y;y++)
+            for(int z = subregion_min.z;z <= subregion_max.z;z++){
+                auto subregion = regions.find({x,y,z});
+                if(subregion == regions.end()) continue;
+
+                for(auto& region: subregion->second){
+                    if(already_found.contains(region.get())) continue;
+                    already_found.emplace(region.get());
+                    output.push_back(region.get());
+                }
+            }
+
+            return output;
+        }
+
         /**
          * @brief Removes all registered data
          * 
@@ -19,30 +19,91 @@
 
 #include <game/entity.hpp>
 #include <game/chunk.hpp>
+#include <game/world/chunk_coordinates.hpp>
 #include <game/world/world_generation.hpp>
 #include <vec_hash.hpp>
 #include <game/threadpool.hpp>
 
 #include <game/world/world_stream.hpp>
+#include <game/world/chunk_map.hpp>
 
 class GameState;
 
 struct RaycastResult{
     glm::ivec3 position; // Position of the hit block
     glm::vec3 lastPosition; // Position before the hit
+    bool hit = false; // When false position is the last block in range
+    glm::ivec3 normal = {0,0,0}; // Normal of the face the ray entered the block through, zero if it started inside
+    float distance = 0.0f; // Distance along the ray to the face
 };
 
 /**
  * @brief A class that holds chunks of block data to represent an 'infinite' world
  * 
+ * Chunk lookups are lock free, chunks found while the terrain is pinned are not freed until the pin is released.
  */
 class Terrain{
     private:
         std::mutex mutex;
-        std::unordered_map<glm::ivec3, std::unique_ptr<Chunk>, IVec3Hash, IVec3Equal> chunks{};
+        ChunkMap chunks{};
 
     public:
         Terrain(){}
+
+        /**
+         * @brief Keeps the chunks found while the guard lives from being freed by the unloading
+         * 
+         * @return ChunkMap::Guard 
+         */
+        ChunkMap::Guard pin() const { return chunks.pin(); }
+
+        /**
+         * @brief Block access by world position that remembers the chunk of the last position
+         * 
+         * The chunk is only looked up again once a position in another chunk is used, walking over nearby blocks costs
+         * a shift and a compare per block. Missing chunks are looked up every time, so chunks added meanwhile are found.
+         * Keeps the terrain pinned while it lives, meant to be short lived.
+         */
+        class Cursor{
+            private:
+                const Terrain* terrain;
+                ChunkMap::Guard guard;
+
+                glm::ivec3 chunk_position{0};
+                Chunk* chunk = nullptr;
+
+            public:
+                Cursor(const Terrain& terrain): terrain(&terrain), guard(terrain.pin()) {}
+
+                /**
+                 * @brief Returns the chunk a block position is in
+                 * 
+                 * @param block_position 
+                 * @return Chunk* nullptr if the chunk isn't loaded
+                 */
+                Chunk* getChunk(const glm::ivec3& block_position){
+                    glm::ivec3 position = ChunkCoordinates::ToChunk(block_position);
+                    if(!chunk || position != chunk_position){
+                        chunk_position = position;
+                        chunk = terrain->getChunk(position);
+                    }
+                    return chunk;
+                }
+
+                Block* getBlock(const glm::ivec3& position){
+                    Chunk* target = getChunk(position);
+                    return target ? target->getBlock(ChunkCoordinates::ToLocal(position)) : nullptr;
+                }
+
+                bool setBlock(const glm::ivec3& position, const Block& block){
+                    Chunk* target = getChunk(position);
+                    if(!target) return false;
+
+                    target->setBlock(ChunkCoordinates::ToLocal(position), block);
+                    return true;
+                }
+        };
+
         Block* getBlock(glm::ivec3 position) const;
         bool setBlock(const glm::ivec3& position, const Block& index);
 
@@ -51,15 +112,37 @@ class Terrain{
         void addChunk(const glm::ivec3& position, std::unique_ptr<Chunk> chunk);
 
         /**
-         * @brief Pull a chunk out of the world
+         * @brief Pull a chunk out of the world without waiting, collectReleasedChunks hands it out once no other thread has it pinned
+         * 
+         * @param position 
+         */
+        void releaseChunk(const glm::ivec3& position);
+
+        /**
+         * @brief Pull all chunks out of the world like releaseChunk
+         * 
+         */
+        void releaseAllChunks();
+
+        /**
+         * @brief Returns the released chunks no other thread has pinned anymore, never waits
+         * 
+         * @return std::vector<std::unique_ptr<Chunk>> 
+         */
+        std::vector<std::unique_ptr<Chunk>> collectReleasedChunks();
+
+        /**
+         * @brief Puts a released chunk that wasnt collected yet back into the world, so its blocks are not generated again
          * 
          * @param position 
-         * @return std::unique_ptr<Chunk> 
+         * @return Chunk* nullptr if no chunk was released at the position
          */
-        std::unique_ptr<Chunk> takeChunk(const glm::ivec3& position);
+        Chunk* reclaimChunk(const glm::ivec3& position);
+
+        size_t releasedChunksTotal() {return chunks.releasedCount();}
 
         /**
-         * @brief Deletes a chunk completely
+         * @brief Deletes a chunk completely, once no other thread has it pinned
          * 
          * @param position 
          */
@@ -104,6 +187,9 @@ class Terrain{
         /**
          * @brief Cast a ray trough the world and return the first intersection or no intersection if max distance was reached
          * 
+         * Walks the blocks with a DDA (Amanatides & Woo), testing whole rows of the chunks at once,
+         * rows without blocks and chunks that are missing or empty are skipped without visiting every block.
+         * 
          * @param from start position
          * @param direction a normalized direction
          * @param maxDistance 
@@ -111,7 +197,7 @@ class Terrain{
          */
         RaycastResult raycast(const glm::vec3& from, const glm::vec3& direction, float maxDistance);
 
-        int chunksTotal() const {return chunks.size();}
+        int chunksTotal() const {return static_cast<int>(chunks.size());}
 
         friend class GameState;
 };
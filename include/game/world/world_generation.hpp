@@ -12,12 +12,14 @@
 #include <rendering/opengl/shaders.hpp>
 #include <rendering/opengl/texture.hpp>
 
+#include <structure/caching/concurrent_cache.hpp>
 #include <structure/interval.hpp>
 
 #include <vec_hash.hpp>
 
 #include <game/blocks.hpp>
 #include <game/structure.hpp>
+#include <game/world/batched_noise.hpp>
 #include <game/world/biomes/biome.hpp>
 #include <game/world/generator.hpp>
 #include <game/world/region_lookup.hpp>
@@ -31,33 +33,66 @@ class Terrain;
  */
 class WorldGenerator : public Generator {
   public:
+    // A structure that spawns in a column unless a candidate with a higher priority overlaps it
+    struct StructureCandidate {
+        glm::ivec3 position;
+        std::shared_ptr<Structure> structure;
+        uint64_t priority;
+    };
+
     struct Heightmap {
         std::array<std::array<int, CHUNK_SIZE>, CHUNK_SIZE> heights;
         std::array<std::array<Biome*, CHUNK_SIZE>, CHUNK_SIZE> biomes;
         int lowest  = INT32_MAX;
         int highest = INT32_MIN;
+
+        std::vector<StructureCandidate> structure_candidates;
+
+        // Set once the candidates were resolved, a heightmap calculated again after it was evicted resolves them again
+        // to the same structures, RegionRegistry doesnt add the ones already placed twice
+        mutable bool structures_placed = false;
     };
 
-    Heightmap& getHeightmapFor(glm::ivec3 position);
+    using HeightmapCache = ConcurrentCache<glm::ivec3, Heightmap, IVec3Hash, IVec3Equal>;
+
+    // Around a thousand columns, enough to generate a render distance of 14 chunks without recalculating any
+    const static size_t heightmap_cache_budget = 64 * 1024 * 1024;
+
+    /**
+     * @brief Returns the heightmap of a column, calculates it if it isn't cached
+     *
+     * @param position a chunk position, y is ignored
+     * @return std::shared_ptr<const Heightmap> stays valid after it is evicted from the cache
+     */
+    std::shared_ptr<const Heightmap> getHeightmapFor(glm::ivec3 position);
 
-    std::unordered_map<glm::ivec3, std::unique_ptr<WorldGenerator::Heightmap>, IVec3Hash, IVec3Equal>& getHeightMaps() {
-        static std::unordered_map<glm::ivec3, std::unique_ptr<WorldGenerator::Heightmap>, IVec3Hash, IVec3Equal> height_maps{};
+    HeightmapCache& getHeightmapCache() {
         return height_maps;
     }
 
   private:
+    HeightmapCache height_maps{heightmap_cache_budget};
+
     struct NoiseLayer {
-        FastNoiseLite noise;
+        BatchedNoise noise;
         glm::vec2 offset;
         int snap_range = 0;
     };
 
+    // Index of a layer, resolved once when the layers are set up
+    using NoiseLayerHandle = size_t;
+
     std::unique_ptr<std::mt19937> offset_random_engine;
-    std::unique_ptr<std::mt19937> structure_random_engine;
 
-    std::unordered_map<std::string, NoiseLayer> noise_layers;
+    std::vector<NoiseLayer> noise_layers;
     std::vector<std::shared_ptr<Biome>> biomes;
 
+    NoiseLayerHandle continentalness_layer = 0;
+    NoiseLayerHandle weirdness_layer       = 0;
+    NoiseLayerHandle errosion_layer        = 0;
+    NoiseLayerHandle temperature_layer     = 0;
+    NoiseLayerHandle humidity_layer        = 0;
+
     std::shared_ptr<Biome> default_biome;
 
     /**
@@ -67,9 +102,21 @@ class WorldGenerator : public Generator {
      * @return Biome*
      */
     Biome* GetBiomeFor(const glm::ivec3& position);
+    Biome* GetBiomeFor(float temperature, float humidity);
 
-    NoiseLayer& AddNoiseLayer(const std::string& name);
-    float GetNoiseValueAt(const glm::vec3& position, const std::string& layer_name);
+    static int GetHeightFor(float continentalness, float weirdness, float errosion);
+
+    NoiseLayerHandle AddNoiseLayer(const NoiseSettings& settings, int snap_range = 0);
+    float GetNoiseValueAt(const glm::vec3& position, NoiseLayerHandle layer);
+
+    /**
+     * @brief Noise values of a layer for every column of a chunk, the same values GetNoiseValueAt returns
+     *
+     * @param position a chunk position, not a world position
+     * @param layer
+     * @param output indexed by x * CHUNK_SIZE + z
+     */
+    void GetNoiseValuesFor(const glm::ivec3& position, NoiseLayerHandle layer, std::array<float, CHUNK_SIZE * CHUNK_SIZE>& output);
 
     int seed;
 
@@ -81,6 +128,18 @@ class WorldGenerator : public Generator {
     RegionRegistry<std::shared_ptr<Structure>> structures;
     void placeStructure(const glm::ivec3& position, const std::shared_ptr<Structure>& structure);
 
+    std::mutex structure_mutex; // Guards structures_placed of the heightmaps
+
+    /**
+     * @brief Places the structures that spawn in a column, once
+     *
+     * Candidates are resolved against the candidates of the neighbouring columns by priority, so the result is the
+     * same whichever column is resolved first.
+     *
+     * @param position a chunk position, y is ignored
+     */
+    void placeStructuresFor(const glm::ivec3& position);
+
     const int water_level = 0;
 
     void SetupBiomeLayers();
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief Stateless randomness for world generation
+ *
+ * Every random decision is a hash of the world seed, the position it is made for and a feature id instead of the next
+ * value of a shared engine, so the world doesn't depend on the order chunks are generated in or on the threads doing it.
+ */
+namespace WorldRandom {
+
+// One id per kind of decision, decisions made at the same position for different features are independent
+enum Feature : uint32_t {
+    STRUCTURE_SPAWN    = 0x100, // + index of the structure in its biome
+    STRUCTURE_PRIORITY = 0x200,
+    CAVE_FACE          = 0x300, // + axis of the face
+    CAVE_CHOICE        = 0x400,
+    CAVE_ORDER         = 0x500,
+};
+
+// Finalizer of splitmix64, every input bit affects every output bit
+inline uint64_t Mix(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+inline uint64_t Hash(int seed, const glm::ivec3& position, uint32_t feature) {
+    uint64_t value = Mix(static_cast<uint32_t>(seed) | (static_cast<uint64_t>(feature) << 32));
+    value          = Mix(value + static_cast<uint32_t>(position.x));
+    value          = Mix(value + static_cast<uint32_t>(position.y));
+    value          = Mix(value + static_cast<uint32_t>(position.z));
+    return value;
+}
+
+/**
+ * @brief Uniform value in [0, 1)
+ *
+ */
+inline float Chance(int seed, const glm::ivec3& position, uint32_t feature) {
+    return static_cast<float>(Hash(seed, position, feature) >> 40) * (1.0f / static_cast<float>(1 << 24));
+}
+
+/**
+ * @brief Uniform index in [0, count)
+ *
+ */
+inline size_t Pick(int seed, const glm::ivec3& position, uint32_t feature, size_t count) {
+    return static_cast<size_t>(((Hash(seed, position, feature) >> 32) * count) >> 32);
+}
+
+} // namespace WorldRandom
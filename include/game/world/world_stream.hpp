@@ -15,16 +15,22 @@
 #include <random>
 #include <limits>
 #include <iostream>
+#include <thread>
+#include <condition_variable>
+#include <optional>
+#include <unordered_set>
 
 /**
  * @brief A class responsible for storing chunks into a file
  * 
+ * Segments evicted from the cache are saved by a writer thread, so the thread dropping them never waits on the disk
+ * unless too many saves are already waiting.
+ * 
  * Thread safe
  */
 class WorldStream {
     private:
         constexpr static int segment_size = 4;
-        std::shared_mutex record_mutex;
 
         glm::ivec3 GetSegmentPositionFor(const glm::ivec3& position);
 
@@ -36,28 +42,63 @@ class WorldStream {
         };
 
         using SegmentRecordStore = std::shared_ptr<KeyedStorage<glm::ivec3>>;
-        SegmentRecordStore record_store;
+
+        /*
+            Everything a dropped segment needs to be saved. Segments only hold a weak reference to it, so one dropped
+            after the stream is destroyed doesn't reach into a freed stream
+        */
+        struct SaveQueue {
+            SegmentRecordStore record_store;
+            std::shared_mutex record_mutex;
+
+            // Evicted segments waiting for the writer, a newer save of a segment replaces the older one
+            std::unordered_map<glm::ivec3, std::unique_ptr<SegmentPack>, IVec3Hash, IVec3Equal> pending_saves;
+            std::optional<glm::ivec3> writing_position; // Segment the writer is saving right now
+            std::unordered_set<glm::ivec3, IVec3Hash, IVec3Equal> loading_positions; // Only one thread loads a segment at a time
+            // Every segment still in use, also the ones already evicted from the cache, so a segment is never loaded twice
+            std::unordered_map<glm::ivec3, std::weak_ptr<SegmentPack>, IVec3Hash, IVec3Equal> live_segments;
+
+            std::mutex pending_mutex;
+            std::condition_variable pending_available; // Wakes the writer
+            std::condition_variable pending_written;   // Wakes threads waiting for space in the queue or for a segment to be written
+            bool stopping = false;                     // The writer is gone, dropped segments are saved right away
+
+            SaveQueue(const SegmentRecordStore& record_store): record_store(record_store) {}
+        };
+
+        // Declared before the cache, segments the cache still holds when it is destroyed are saved through it
+        std::shared_ptr<SaveQueue> queue;
 
         Cache<glm::ivec3, std::shared_ptr<SegmentPack>, IVec3Hash, IVec3Equal> segment_cache{40};
 
-        // Thread safe, Returns whether the segment could be loaded
-        bool LoadSegment(const glm::ivec3& position);
+        // Thread safe, Returns the loaded segment or nullptr if it isnt stored, with create a missing segment is created
+        std::shared_ptr<SegmentPack> LoadSegment(const glm::ivec3& position, bool create = false);
         // Thread safe
         void LoadSegmentToCache(const glm::ivec3& position, std::shared_ptr<SegmentPack> segment);
         // Thread safe
-        void SaveSegment(const glm::ivec3& position, SegmentPack* segment);
-        // Thread safe
-        void CreateSegment(const glm::ivec3& position);
-
+        static void SaveSegment(SaveQueue& queue, const glm::ivec3& position, SegmentPack* segment);
         // Thread safe
         std::shared_ptr<SegmentPack> GetSegment(const glm::ivec3& position, bool set_in_use = false);
-        std::shared_ptr<SegmentPack> InitSegment(const glm::ivec3& position);
+        // Wraps a segment so it is queued for saving once it is dropped
+        std::shared_ptr<SegmentPack> InitSegment(const glm::ivec3& position, std::unique_ptr<SegmentPack> segment = nullptr);
 
-        void Flush();
+        const static size_t max_pending_saves = 64;
+
+        std::thread writer;
+
+        // Thread safe, blocks while the queue is full
+        static void QueueSave(SaveQueue& queue, const glm::ivec3& position, SegmentPack* segment);
+        void RunWriter();
 
     public:
         WorldStream(const std::shared_ptr<KeyedStorage<glm::ivec3>>& storage);
-       // ~WorldStream();
+        ~WorldStream();
+
+        /**
+         * @brief Saves all cached segments, blocks until every queued save is written and flushed to the disk, used when the game is saved and closed
+         * 
+         */
+        void Flush();
         
         /**
          * @brief Check whether there is a chunk stored for the given position
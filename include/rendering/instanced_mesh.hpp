@@ -10,26 +10,29 @@
 #include <memory>
 #include <atomic>
 #include <rendering/mesh_spec.hpp>
+#include <rendering/packed_face.hpp>
 
-#include <structure/multilevel_pool.hpp>
 #include <memory>
 
 /**
- * @brief A mesh that holds faces for instancing
+ * @brief A mesh that holds faces for instancing, every face is a PackedFace relative to the chunk origin
  * 
  */
 class InstancedMesh: public MeshInterface{
     public:
-        const static size_t instance_data_size = 12;
+        const static size_t instance_data_size = sizeof(PackedFace) / sizeof(uint32_t);
 
     private:
-        std::array<std::unique_ptr<MultilevelPool<float>::List>, 4> instance_data;
+        // Owned by the mesh, meshes are built on many threads at once so they cannot share pooled storage
+        std::array<std::vector<uint32_t>, 4> instance_data{};
     
     public:
         InstancedMesh();
         void addQuadFace(const glm::ivec3& position, float width, float height, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position) override;
+        void emitFaces(std::span<const QuadFace> faces, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position) override;
         void preallocate(size_t size, FaceType type) override;
-        const MultilevelPool<float>::List& getInstanceData(FaceType type);
+        bool appendPacked(std::span<const uint32_t> data, FaceType type) override;
+        const std::vector<uint32_t>& getInstanceData(FaceType type);
         bool empty() override;
         void shrink() override;
 };
@@ -37,6 +40,8 @@ class InstancedMesh: public MeshInterface{
 /**
  * @brief An aggregate loader for instanced meshes that manages actual opengl buffers and is able to draw them
  * 
+ * Instances are read from a storage buffer by gl_BaseInstance + gl_InstanceID,
+ * the chunk origin of every draw call from another one by gl_DrawID.
  */
 class InstancedMeshLoader: public MeshLoaderInterface{
     public:
@@ -44,7 +49,7 @@ class InstancedMeshLoader: public MeshLoaderInterface{
             private:
                 InstancedMeshLoader& creator;
                 bool valid = true;
-                std::array<CoherentList<float>::RegionIterator, 4> loaded_regions = {}; 
+                std::array<CoherentList<uint32_t>::RegionIterator, 4> loaded_regions = {}; 
                 std::array<bool, 4> has_region = {};
 
                 friend class InstancedMeshLoader;
@@ -55,7 +60,6 @@ class InstancedMeshLoader: public MeshLoaderInterface{
                 //~LoadedMesh() {destroy();}
                 // Adds the meshes draw call to the next batch
                 void addDrawCall(const glm::ivec3& position) override ;
-                void render();
                 void update(MeshInterface* mesh) override ;
                 void destroy() override ;
                 bool isValid() override {return valid;}
@@ -70,21 +74,25 @@ class InstancedMeshLoader: public MeshLoaderInterface{
 
         ShaderProgram shared_program = ShaderProgram("resources/shaders/terrain.vs","resources/shaders/terrain.fs");
 
+        Uniform<float> draw_offset_uniform = Uniform<float>("DrawOffset"); // Index of the first draw call in a batch
+
         struct RenderableGroup{
-            GLCoherentBuffer<float, GL_ARRAY_BUFFER> instance_data{};
+            GLCoherentBuffer<uint32_t, GL_SHADER_STORAGE_BUFFER> instance_data{};
             GLDrawCallBuffer draw_call_buffer{};
-            GLVertexArray vao{};
+
+            std::vector<glm::ivec4> origins{}; // Chunk origin of every draw call, padded for std430
+            GLBuffer<int32_t, GL_SHADER_STORAGE_BUFFER> origin_buffer{};
         };
         
         std::array<RenderableGroup, distinct_face_count> render_information{};
         GLBuffer<float, GL_ARRAY_BUFFER> loaded_face_buffer{};
+        GLVertexArray vao{};
 
         std::mutex loading_mutex;
         std::mutex draw_call_mutex;
 
         void removeMesh(LoadedMesh& mesh);
-        void addDrawCall(LoadedMesh& mesh);
-        void renderMesh(LoadedMesh& mesh);
+        void addDrawCall(LoadedMesh& mesh, const glm::ivec3& position);
         void updateMesh(LoadedMesh& loaded_mesh, InstancedMesh& new_mesh);
                 
     public:
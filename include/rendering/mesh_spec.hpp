@@ -1,8 +1,11 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <cstdlib>
 #include <glm/glm.hpp>
 #include <memory>
+#include <span>
 
 /**
  * @brief A specification of how a block mesh should behave
@@ -22,8 +25,49 @@ class MeshInterface{
             Backward = 1
         };
 
+        struct QuadFace{
+            glm::ivec3 position;
+            float width;
+            float height;
+        };
+
         virtual void addQuadFace(const glm::ivec3& position, float width, float height, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position) = 0;
+
+        /**
+         * @brief Adds a batch of faces that share everything but their position and size
+         * 
+         * Meshes override it to check their capacity once per batch and write the faces straight into their storage,
+         * the default just adds them one by one.
+         * 
+         * @param faces 
+         * @param texture_index 
+         * @param type 
+         * @param direction 
+         * @param occlusion 
+         * @param world_position 
+         */
+        virtual void emitFaces(std::span<const QuadFace> faces, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position){
+            preallocate(faces.size(), type);
+            for(auto& face: faces)
+                addQuadFace(face.position, face.width, face.height, texture_index, type, direction, occlusion, world_position);
+        }
+
+        /**
+         * @brief Reserves space for a number of additional faces of a type
+         * 
+         * @param size 
+         * @param type 
+         */
         virtual void preallocate(size_t size, FaceType type) = 0;
+
+        /**
+         * @brief Appends faces that are already packed (see PackedFace, two uint32 values per face), all of one type
+         * 
+         * @param data 
+         * @param type 
+         * @return true if the mesh stores packed faces and took them, otherwise the caller has to add them one by one
+         */
+        virtual bool appendPacked(std::span<const uint32_t> data, FaceType type){ return false; }
         virtual bool empty() = 0;
         virtual void shrink() = 0;
 };
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include <rendering/mesh_spec.hpp>
+
+/*
+    Packed face instance format, 2 x uint32 per face, the chunk origin is supplied per draw:
+
+    (Indexed from the least significant bit)
+
+    uint32
+    (0 ) -> 7 bits x (chunk local, faces on the far side of the chunk sit at 64)
+    (7 ) -> 7 bits y
+    (14) -> 7 bits z
+    (21) -> 6 bits width (0 means 64)
+    (27) -> 2 bits face type
+    (29) -> 1 bit direction
+
+    uint32
+    (0 ) -> 6 bits height (0 means 64)
+    (6 ) -> 4 * 2 bits occlusion, in GL_TRIANGLE_STRIP order
+    (14) -> 18 bits texture index
+
+    Has to match resources/shaders/terrain.vs
+*/
+struct PackedFace {
+    uint32_t first  = 0;
+    uint32_t second = 0;
+
+    /**
+     * @brief The fields of a face, as they are passed to MeshInterface::addQuadFace
+     *
+     */
+    struct Fields {
+        glm::ivec3 position;
+        int width;
+        int height;
+        int texture_index;
+        MeshInterface::FaceType type;
+        MeshInterface::Direction direction;
+        std::array<int, 4> occlusion; // Clockwise from the top left, as calculated by the mesher
+    };
+
+    const static int max_texture_index = (1 << 18) - 1;
+
+    constexpr static uint32_t mask2 = 0b11;
+    constexpr static uint32_t mask6 = 0b111111;
+    constexpr static uint32_t mask7 = 0b1111111;
+
+    // Vertex order of a GL_TRIANGLE_STRIP quad swaps the last two corners
+    constexpr static std::array<int, 4> strip_order = {0, 1, 3, 2};
+
+    constexpr static PackedFace Pack(const Fields& fields) {
+        PackedFace face{};
+
+        face.first |= (static_cast<uint32_t>(fields.position.x) & mask7);
+        face.first |= (static_cast<uint32_t>(fields.position.y) & mask7) << 7;
+        face.first |= (static_cast<uint32_t>(fields.position.z) & mask7) << 14;
+        face.first |= (static_cast<uint32_t>(fields.width) & mask6) << 21;
+        face.first |= (static_cast<uint32_t>(fields.type) & mask2) << 27;
+        face.first |= (static_cast<uint32_t>(fields.direction) & 0b1) << 29;
+
+        face.second |= (static_cast<uint32_t>(fields.height) & mask6);
+        for (int i = 0; i < 4; i++)
+            face.second |= (static_cast<uint32_t>(fields.occlusion[strip_order[i]]) & mask2) << (6 + i * 2);
+        face.second |= (static_cast<uint32_t>(fields.texture_index) & max_texture_index) << 14;
+
+        return face;
+    }
+
+    constexpr Fields unpack() const {
+        Fields fields{};
+
+        fields.position.x = first & mask7;
+        fields.position.y = (first >> 7) & mask7;
+        fields.position.z = (first >> 14) & mask7;
+
+        fields.width     = (first >> 21) & mask6;
+        fields.width     = fields.width != 0 ? fields.width : 64;
+        fields.type      = static_cast<MeshInterface::FaceType>((first >> 27) & mask2);
+        fields.direction = static_cast<MeshInterface::Direction>((first >> 29) & 0b1);
+
+        fields.height = second & mask6;
+        fields.height = fields.height != 0 ? fields.height : 64;
+        for (int i = 0; i < 4; i++)
+            fields.occlusion[strip_order[i]] = (second >> (6 + i * 2)) & mask2;
+        fields.texture_index = (second >> 14) & max_texture_index;
+
+        return fields;
+    }
+};
+
+static_assert(sizeof(PackedFace) == 8, "Packed faces are uploaded as two consecutive uint32 values");
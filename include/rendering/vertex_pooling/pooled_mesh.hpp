@@ -36,6 +36,7 @@ class PooledMesh: public MeshInterface{
 
         PooledMesh(){}
         void addQuadFace(const glm::ivec3& position, float width, float height, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position) override;
+        void emitFaces(std::span<const QuadFace> faces, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position) override;
         void preallocate(size_t size, FaceType type) override;
         const SegregatedList<FaceType, uint32_t>& GetData() { return data; };
         bool empty() override;
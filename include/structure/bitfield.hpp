@@ -46,6 +46,26 @@ class BitField {
      * 
      */
     virtual uint64_t getRow(uint x, uint y);
+    /**
+     * @brief Sets the bits of a row that are set in the mask, keeps the others
+     * 
+     */
+    virtual bool setRowMask(uint x, uint y, uint64_t mask);
+    /**
+     * @brief Resets the bits of a row that are set in the mask, keeps the others
+     * 
+     */
+    virtual bool resetRowMask(uint x, uint y, uint64_t mask);
+    /**
+     * @brief Sets every bit that is set in the mask, the same as setRowMask for all the rows
+     * 
+     */
+    virtual void setMask(const BitField& mask);
+    /**
+     * @brief Resets every bit that is set in the mask, the same as resetRowMask for all the rows
+     * 
+     */
+    virtual void resetMask(const BitField& mask);
     /**
      * @brief Fill the array with the set value
      * 
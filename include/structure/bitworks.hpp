@@ -75,6 +75,26 @@ template <typename T> inline uint8_t count_ones(T x) {
     return std::popcount(x);
 }
 
+/**
+ * @brief Transposes a 64x64 matrix of bits in place, rows are 64 bit integers with the first column in the highest bit
+ *
+ * Recursively swaps the off-diagonal blocks, first 32x32 then 16x16 all the way down to single bits,
+ * so the whole matrix takes 6 * 32 word operations instead of touching each bit.
+ *
+ * @param rows pointer to 64 consecutive rows
+ */
+inline void transpose_bit_matrix_64(uint64_t* rows) {
+    uint64_t mask = 0x00000000FFFFFFFFULL;
+
+    for (int width = 32; width != 0; width >>= 1, mask ^= (mask << width)) {
+        for (int k = 0; k < 64; k = (k + width + 1) & ~width) {
+            uint64_t swapped = (rows[k] ^ (rows[k + width] >> width)) & mask;
+            rows[k] ^= swapped;
+            rows[k + width] ^= (swapped << width);
+        }
+    }
+}
+
 /**
  * @brief A 2D plane of bits
  * 
@@ -38,6 +38,23 @@ class Cache {
         return nullptr;
     }
 
+    /**
+     * @brief Returns a copy of the cached value, unlike Get it stays valid while other threads load values into the cache
+     * 
+     * @param key 
+     * @return std::optional<T> 
+     */
+    std::optional<T> GetCopy(const Key& key) {
+        std::lock_guard lock(mutex);
+        eviction_policy.KeyRequested(key);
+
+        auto value = cached_values.find(key);
+        if (value == cached_values.end())
+            return std::nullopt;
+
+        return value->second;
+    }
+
     /**
      * @brief If a cached value was evicted returns it with its key, otherwise returns std::nullopt
      * 
@@ -63,6 +80,18 @@ class Cache {
         return std::move(result);
     }
 
+    /**
+     * @brief Calls a function for every cached value, nothing is evicted
+     * 
+     * @param function 
+     */
+    void ForEach(const std::function<void(const Key&, T&)>& function) {
+        std::lock_guard lock(mutex);
+
+        for (auto& [key, value] : cached_values)
+            function(key, value);
+    }
+
     /**
      * @brief Clears the cache and handles each individual eviction with a callback
      * 
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <structure/caching/eviction_policies.hpp>
+
+/**
+ * @brief A thread safe cache of shared values that stays within a memory budget
+ *
+ * Keys are spread over shards that each have their own lock and eviction policy, the budget is split evenly between them.
+ * Values are handed out as shared pointers, so an evicted value stays alive for as long as someone still uses it.
+ *
+ * @tparam Key
+ * @tparam T
+ * @tparam Hash
+ * @tparam Equal
+ * @tparam EvictionPolicy
+ */
+template <typename Key, typename T, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>,
+          typename EvictionPolicy = CacheEvictionPolicies::Clock<Key, Hash, Equal>>
+class ConcurrentCache {
+  public:
+    struct Statistics {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+        size_t entries;
+        size_t memory_usage;
+        size_t memory_budget;
+    };
+
+  private:
+    const static size_t shard_count = 16;
+
+    struct Entry {
+        std::shared_ptr<const T> value;
+        size_t size;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<Key, Entry, Hash, Equal> values{};
+        EvictionPolicy eviction_policy{};
+        size_t memory_usage = 0;
+    };
+
+    std::array<Shard, shard_count> shards{};
+    size_t memory_budget;
+
+    std::atomic<size_t> hits      = 0;
+    std::atomic<size_t> misses    = 0;
+    std::atomic<size_t> evictions = 0;
+
+    Shard& ShardFor(const Key& key) {
+        // Spread the bits of weak hashes before picking a shard by the top ones
+        uint64_t value = static_cast<uint64_t>(Hash{}(key)) * 0x9e3779b97f4a7c15ULL;
+        return shards[value >> 60];
+    }
+
+  public:
+    ConcurrentCache(size_t memory_budget) : memory_budget(memory_budget) {}
+
+    /**
+     * @brief Returns the cached value or nullptr, counts a hit or a miss
+     *
+     * @param key
+     * @return std::shared_ptr<const T>
+     */
+    std::shared_ptr<const T> Get(const Key& key) {
+        auto& shard = ShardFor(key);
+        std::lock_guard lock(shard.mutex);
+
+        auto it = shard.values.find(key);
+        if (it == shard.values.end()) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        hits.fetch_add(1, std::memory_order_relaxed);
+        shard.eviction_policy.KeyRequested(key);
+        return it->second.value;
+    }
+
+    /**
+     * @brief Adds a value unless another thread loaded the key first, evicts until the shard is within its budget again
+     *
+     * @param key
+     * @param value
+     * @param size memory used by the value in bytes
+     * @return std::shared_ptr<const T> the cached value, the one loaded first when there was one already
+     */
+    std::shared_ptr<const T> Load(const Key& key, std::shared_ptr<const T> value, size_t size) {
+        auto& shard = ShardFor(key);
+        std::lock_guard lock(shard.mutex);
+
+        auto [it, inserted] = shard.values.try_emplace(key, Entry{std::move(value), size});
+        shard.eviction_policy.KeyRequested(key);
+
+        if (!inserted)
+            return it->second.value;
+
+        shard.memory_usage += size;
+        auto result = it->second.value;
+
+        // The new value is never evicted right away, a shard always keeps at least one
+        while (shard.memory_usage > memory_budget / shard_count && shard.values.size() > 1) {
+            Key victim = shard.eviction_policy.Evict();
+            if (Equal{}(victim, key)) {
+                shard.eviction_policy.KeyRequested(key);
+                continue;
+            }
+
+            auto node = shard.values.extract(victim);
+            shard.memory_usage -= node.mapped().size;
+            evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Removes every value, keeps the counters
+     *
+     */
+    void Clear() {
+        for (auto& shard : shards) {
+            std::lock_guard lock(shard.mutex);
+            shard.values.clear();
+            shard.eviction_policy = EvictionPolicy{};
+            shard.memory_usage    = 0;
+        }
+    }
+
+    Statistics GetStatistics() {
+        Statistics statistics{hits.load(), misses.load(), evictions.load(), 0, 0, memory_budget};
+
+        for (auto& shard : shards) {
+            std::lock_guard lock(shard.mutex);
+            statistics.entries += shard.values.size();
+            statistics.memory_usage += shard.memory_usage;
+        }
+
+        return statistics;
+    }
+};
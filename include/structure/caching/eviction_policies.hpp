@@ -2,6 +2,7 @@
 
 #include <list>
 #include <unordered_map>
+#include <vector>
 
 namespace CacheEvictionPolicies{
     /**
@@ -35,4 +36,68 @@ namespace CacheEvictionPolicies{
             return lru_key;
         }
     };
+
+    /**
+     * @brief A clock (second chance) eviction policy, close to least recently used but a request only sets a flag
+     * 
+     * Keys sit in a ring that a hand sweeps over when evicting, requested keys lose their flag instead of being evicted
+     * the first time the hand passes them.
+     * 
+     * @tparam Key 
+     * @tparam Hash 
+     * @tparam Equal 
+     */
+    template <typename Key, typename Hash, typename Equal>
+    class Clock {
+    private:
+        struct Slot {
+            Key key;
+            bool referenced = false;
+            bool used = false;
+        };
+
+        std::vector<Slot> ring;
+        std::vector<size_t> free_slots;
+        std::unordered_map<Key, size_t, Hash, Equal> key_slots;
+        size_t hand = 0;
+
+    public:
+        void KeyRequested(const Key& key) {
+            auto it = key_slots.find(key);
+            if (it != key_slots.end()) {
+                ring[it->second].referenced = true;
+                return;
+            }
+
+            size_t slot;
+            if (!free_slots.empty()) {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            } else {
+                slot = ring.size();
+                ring.emplace_back();
+            }
+
+            ring[slot] = {key, true, true};
+            key_slots[key] = slot;
+        }
+
+        Key Evict() {
+            while (true) {
+                auto& slot = ring[hand];
+                hand = (hand + 1) % ring.size();
+
+                if (!slot.used) continue;
+                if (slot.referenced) {
+                    slot.referenced = false;
+                    continue;
+                }
+
+                slot.used = false;
+                free_slots.push_back(&slot - ring.data());
+                key_slots.erase(slot.key);
+                return slot.key;
+            }
+        }
+    };
 }
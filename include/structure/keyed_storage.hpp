@@ -30,4 +30,19 @@ class KeyedStorage{
          * @return false if it wasnt
          */
         virtual bool Get(const Key& key, std::vector<byte>& output) = 0;
+
+        /**
+         * @brief Remove data stored under a key
+         * 
+         * @param key 
+         * @return true if data was removed
+         * @return false if there was none
+         */
+        virtual bool Delete(const Key& key) = 0;
+
+        /**
+         * @brief Writes everything saved so far so it survives a crash, blocks until it is on the disk
+         * 
+         */
+        virtual void Flush() = 0;
 };
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Packed array of small palette indexes for every position of a 64x64x64 chunk
+ *
+ * Entries are 1, 2, 4, 8 or 16 bits wide so they never cross a word, the width grows when a larger value is set.
+ * Positions are ordered like the rows of a BitField3D, z goes along the row.
+ * An array without any words holds only zeroes.
+ */
+class PaletteIndexArray {
+  private:
+    std::vector<uint64_t> words{};
+    uint32_t width_shift = 0; // log2 of the bits per entry
+
+    /**
+     * @brief Repacks the entries to a wider width
+     *
+     * @param width_shift
+     */
+    void widen(uint32_t width_shift);
+
+  public:
+    const static size_t entry_count = 64 * 64 * 64;
+
+    static size_t index(uint32_t x, uint32_t y, uint32_t z) {
+        return ((x + y * 64) << 6) | z;
+    }
+
+    uint32_t get(size_t index) const {
+        if (words.empty())
+            return 0;
+
+        uint32_t per_word_shift = 6 - width_shift;
+        uint64_t word           = words[index >> per_word_shift];
+        uint32_t offset         = (index & ((1U << per_word_shift) - 1)) << width_shift;
+
+        return (word >> offset) & ((1ULL << (1U << width_shift)) - 1);
+    }
+
+    void set(size_t index, uint32_t value) {
+        if (words.empty() && value == 0)
+            return;
+
+        if (words.empty() || value >> (1U << width_shift))
+            reserve(value);
+
+        uint32_t per_word_shift = 6 - width_shift;
+        uint64_t& word          = words[index >> per_word_shift];
+        uint32_t offset         = (index & ((1U << per_word_shift) - 1)) << width_shift;
+        uint64_t mask           = ((1ULL << (1U << width_shift)) - 1) << offset;
+
+        word = (word & ~mask) | (static_cast<uint64_t>(value) << offset);
+    }
+
+    /**
+     * @brief Sets every position of a bitfield row that has its bit set
+     *
+     * @param row index of the row (x + y * 64)
+     * @param mask the row, with z = 0 in the highest bit
+     * @param value
+     */
+    void setMasked(size_t row, uint64_t mask, uint32_t value);
+
+    /**
+     * @brief Makes the entries wide enough to hold values up to max_value
+     *
+     * @param max_value
+     */
+    void reserve(uint32_t max_value);
+
+    /**
+     * @brief Drops all entries, every position reads as zero again
+     *
+     */
+    void clear();
+
+    size_t memoryUsage() const {
+        return words.size() * sizeof(uint64_t);
+    }
+};
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <map>
+#include <optional>
+#include <vector>
 #include <unordered_map>
+#include <shared_mutex>
 
 #include <structure/caching/cache.hpp>
 #include <structure/serialization/serializer.hpp>
@@ -47,46 +50,200 @@ class RecordStore: public KeyedStorage<Key>{
         size_t capacity = 0;
     };
 
+    // Precedes the free records and the index directory written after the end, they are only valid for a header with the same end
+    struct TrailerSection{
+        size_t magic = 0;
+        size_t end = 0;
+        size_t total = 0;
+        size_t checksum = 0;
+    };
+
+    struct IndexEntry{
+        Key key;
+        size_t block = 0;
+        size_t slot = 0;
+    };
+
+    // Where a page of the index is stored in the store, the directory of all pages follows the free records
+    struct IndexPage{
+        size_t location = 0;
+        size_t capacity = 0; // In entries
+        size_t total = 0;
+        size_t checksum = 0;
+    };
+
   private:
-    const static size_t per_block_record_count = 1024ULL * 1024ULL;
     const static size_t new_allocation_padding = 1024;
     Buffer* buffer = nullptr;
 
+    size_t records_per_block;
+
+    // Slots written together when one of them changed
+    const static size_t slots_per_page = 16;
+
+    // Records keep their slot in the block, so a commit only writes the pages of slots that changed
     struct CachedBlock {
         BlockHeader header;
-        std::unordered_map<Key, Record, Hash, Equal> records;
+        std::vector<Record> records{};                        // Slots as stored, a free slot has location 0
+        std::unordered_map<Key, size_t, Hash, Equal> slots{}; // Slot of every key
+        std::vector<size_t> free_slots{};
+        std::vector<bool> dirty_pages{};
+        bool dirty = false; // Changed since it was last written
+
+        Record* find(const Key& key) {
+            auto slot = slots.find(key);
+            return slot == slots.end() ? nullptr : &records[slot->second];
+        }
+
+        bool full() const {
+            return free_slots.empty() && records.size() >= header.capacity;
+        }
+
+        void markDirty(size_t slot) {
+            size_t page = slot / slots_per_page;
+            if (page >= dirty_pages.size())
+                dirty_pages.resize(page + 1);
+
+            dirty_pages[page] = true;
+            dirty             = true;
+        }
+
+        // Takes a free slot, the block can't be full
+        Record& add(const Record& record) {
+            size_t slot = records.size();
+            if (!free_slots.empty()) {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            } else
+                records.emplace_back();
+
+            records[slot] = record;
+            slots[record.key] = slot;
+            markDirty(slot);
+            return records[slot];
+        }
+
+        void remove(const Key& key) {
+            auto slot = slots.find(key);
+            if (slot == slots.end())
+                return;
+
+            records[slot->second] = Record{};
+            free_slots.push_back(slot->second);
+            markDirty(slot->second);
+            slots.erase(slot);
+        }
     };
 
     // Free blocks in the format of size, location
     std::multimap<size_t, size_t> free_blocks;
+    // The same free blocks in the format of location, size, adjacent free blocks are always merged
+    std::map<size_t, size_t> free_extents;
+    size_t free_bytes = 0;
+
+    // Freed since the last commit, the stored blocks and index can still point at them so they are not reused before it
+    std::vector<FreeRecord> pending_free;
+    size_t pending_free_bytes = 0;
+    // Past this much pending space the store commits on its own, so a long session still reuses its freed space
+    const static size_t max_pending_free_bytes = 4ULL * 1024ULL * 1024ULL;
     
     /**
-     * @brief Finds space from free blocks (will not give blocks that are > 2 * capacity) or appends to the end to get more space
+     * @brief Takes the smallest free block that fits and splits off the rest, or appends to the end to get more space
      * 
      * @param capacity 
      * @return size_t location of newly allocated space
      */
     size_t AllocateBlock(size_t capacity);
-    // Does no checks, only registers a block as free
+    // Does no checks, registers a block as free and merges it with adjacent free blocks, space at the end is given back
     void FreeBlock(size_t location, size_t capacity);
+    // Frees a block once the next commit has written metadata that no longer points at it
+    void QuarantineBlock(size_t location, size_t capacity);
+
+    void InsertFreeExtent(size_t location, size_t capacity);
+    void EraseFreeExtent(std::map<size_t, size_t>::iterator extent);
 
     Cache<size_t, CachedBlock> block_cache{50};
 
-    void LoadBlockIntoCache(size_t location, const CachedBlock& block);
+    const static size_t free_records_magic = 0x45455246534452ULL; // "RDSFREE"
+    const static size_t index_magic        = 0x5347504449534452ULL; // "RDSIDPGS"
+
+    static size_t Checksum(const byte* data, size_t size);
+    size_t TrailerLocation() const;
+
+    // Pages are split in two once they hold this many entries on average
+    const static size_t index_page_entries = 512;
+
+    // Where a record is, its slot stays the same for as long as the key is stored
+    struct IndexedRecord {
+        size_t block = 0;
+        size_t slot  = 0;
+
+        bool operator==(const IndexedRecord&) const = default;
+    };
+
+    struct LoadedIndexPage {
+        std::unordered_map<Key, IndexedRecord, Hash, Equal> entries;
+        IndexPage stored{};
+        bool dirty = true;
+    };
+
+    // Block and slot of every key, kept whole in memory so lookups dont walk the block chain and a get of a block that
+    // isn't cached reads just the record. Keys are split into pages by their hash, a commit only writes the pages that changed
+    std::vector<LoadedIndexPage> index_pages{1};
+    size_t indexed_total = 0;
+
+    size_t IndexPageFor(const Key& key) const;
+    std::optional<IndexedRecord> FindIndexed(const Key& key) const;
+    void SetIndexed(const Key& key, IndexedRecord record);
+    bool EraseIndexed(const Key& key);
+    // Doubles the pages, every page is written again on the next commit
+    void GrowIndex();
+    void ClearIndex();
+
+    void LoadBlockIntoCache(size_t location, CachedBlock block);
 
     CachedBlock* GetRecordBlock(size_t location);
     CachedBlock* CreateNewRecordBlock(size_t capacity);
 
     void SaveFreeRecords();
+    /**
+     * @brief Loads the free records stored after the end, they are dropped if they dont match the header
+     * 
+     */
+    void LoadFreeRecords();
+    // Writes the changed pages into the store, before the free records since pages can take free space
+    void SaveIndexPages();
+    void SaveIndexDirectory();
+    /**
+     * @brief Loads the index pages listed after the free records, rebuilds the index from the block chain if they arent valid
+     * 
+     */
+    void LoadIndex();
     void FlushBlock(size_t location, CachedBlock& block);
     void SaveHeader();
 
-    void Flush();
+    /**
+     * @brief Writes the changed blocks and index pages, then releases the quarantined blocks and writes the free records,
+     * the index directory and the header
+     * 
+     */
+    void Commit();
+    // Commits and forgets everything loaded from the buffer
+    void Detach();
+    void Reset();
 
-    Record* Get(const Key& key);
+    // Gets only take it shared, they read the record straight from the store when its block isn't cached
+    mutable std::shared_mutex mutex;
 
   public:
-    RecordStore();
+    const static size_t default_records_per_block = 1024ULL * 1024ULL;
+
+    /**
+     * @brief Construct a new Record Store
+     * 
+     * @param records_per_block records of the blocks created from now on, blocks already stored keep their size
+     */
+    RecordStore(size_t records_per_block = default_records_per_block);
     ~RecordStore();
 
     /**
@@ -98,7 +255,7 @@ class RecordStore: public KeyedStorage<Key>{
      */
     void Save(const Key& key, size_t size, const byte* data) override;
     /**
-     * @brief Get the value from a key
+     * @brief Get the value from a key, can run in parallel with other gets
      * 
      * @param key 
      * @param output 
@@ -106,6 +263,32 @@ class RecordStore: public KeyedStorage<Key>{
      * @return false 
      */
     bool Get(const Key& key, std::vector<byte>& output) override;
+    /**
+     * @brief Remove the value stored at a key, its space is reused by later saves
+     * 
+     * @param key 
+     * @return true if there was a value
+     * @return false 
+     */
+    bool Delete(const Key& key) override;
+    /**
+     * @brief Commits the records and their metadata and flushes the buffer, the store stays open
+     * 
+     */
+    void Flush() override;
+
+    struct SpaceStats {
+        size_t live_bytes = 0; // Allocated to records and record blocks
+        size_t free_bytes = 0; // Free space waiting for reuse, also the space waiting for the next commit
+        size_t disk_bytes = 0; // Size of the store without the free records and index written after it
+    };
+
+    /**
+     * @brief Get how much of the store is in use
+     * 
+     * @return SpaceStats 
+     */
+    SpaceStats GetSpaceStats() const;
 
     OuterHeader& GetHeader() { return loaded_header.header; };
     const OuterHeader& GetHeader() const { return loaded_header.header; };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <bit>
+
 #include "logging.hpp"
 #include <structure/binary_search.hpp>
 #include <structure/record_store.hpp>
@@ -9,110 +11,168 @@
 
 TEMPLATE
 CLASS::~RecordStore() {
-    Flush();
+    Detach();
 }
 
 TEMPLATE
-CLASS::RecordStore() {}
-
-TEMPLATE
-CLASS::Record* CLASS::Get(const Key& key) {
-    if (loaded_header.first_block == 0)
-        return nullptr;
-
-
-    CachedBlock* block = GetRecordBlock(loaded_header.first_block);
-    while (block != nullptr) {
-        if (block->records.contains(key))
-            return &block->records.at(key);
-
-        block = GetRecordBlock(block->header.next_block);
-    }
-
-    return nullptr;
-}
+CLASS::RecordStore(size_t records_per_block) : records_per_block(records_per_block) {}
 
 TEMPLATE
 bool CLASS::Get(const Key& key, std::vector<byte>& output) {
-    if (!buffer)
-        return false;
-
-
-    auto* record = Get(key);
-
-    if (!record)
-        return false;
-
-    output.resize(record->used_size);
-    buffer->Read(record->location, record->used_size, output.data());
+    {
+        std::shared_lock lock(mutex);
+
+        if (!buffer)
+            return false;
+
+        auto indexed = FindIndexed(key);
+        if (!indexed)
+            return false;
+
+        // A cached block can have changes that arent written yet, otherwise the stored record is current
+        Record record{};
+        CachedBlock* block = block_cache.Get(indexed->block);
+        if (block) {
+            auto* cached = block->find(key);
+            if (!cached)
+                return false;
+
+            record = *cached;
+        } else {
+            auto stored = buffer->Read<Record>(indexed->block + sizeof(BlockHeader) + indexed->slot * sizeof(Record));
+            if (!stored || stored->location == 0 || !Equal{}(stored->key, key))
+                return false;
+
+            record = *stored;
+        }
 
-    return true;
+        output.resize(record.used_size);
+        return buffer->Read(record.location, record.used_size, output.data());
+    }
 }
 
 TEMPLATE
 void CLASS::Save(const Key& key, size_t size, const byte* data) {
+    std::unique_lock lock(mutex);
+
     if (!buffer)
         return;
 
-    auto existing_option = Get(key);
     size_t new_size = size + new_allocation_padding;
 
-    if (existing_option) {
-        if (existing_option->capacity < size) {
-            FreeBlock(existing_option->location, existing_option->capacity);
+    if (auto indexed = FindIndexed(key)) {
+        // A record of a block that isn't cached is changed where it is stored, like its block would be written when evicted
+        size_t stored_location = indexed->block + sizeof(BlockHeader) + indexed->slot * sizeof(Record);
+        CachedBlock* block     = block_cache.Get(indexed->block);
 
-            existing_option->location = AllocateBlock(new_size);
-            existing_option->capacity = new_size;
+        Record record{};
+        if (block)
+            record = block->records[indexed->slot];
+        else if (auto stored = buffer->Read<Record>(stored_location))
+            record = *stored;
+        else
+            return;
+
+        if (record.capacity < size) {
+            QuarantineBlock(record.location, record.capacity);
+
+            record.location = AllocateBlock(new_size);
+            record.capacity = new_size;
         }
 
         if (data) {
-            buffer->Write(existing_option->location, size, data);
-            existing_option->used_size = size;
+            buffer->Write(record.location, size, data);
+            record.used_size = size;
         }
 
+        if (block) {
+            block->records[indexed->slot] = record;
+            block->markDirty(indexed->slot);
+        } else
+            buffer->Write<Record>(stored_location, record);
+
+        if (pending_free_bytes > max_pending_free_bytes)
+            Commit();
+
         return;
     }
 
     CachedBlock* block = nullptr;
 
     if (loaded_header.first_block == 0)
-        block = CreateNewRecordBlock(per_block_record_count);
+        block = CreateNewRecordBlock(records_per_block);
     else
         block = GetRecordBlock(loaded_header.last_block);
 
-    if (block->records.size() >= block->header.capacity)
-        block = CreateNewRecordBlock(per_block_record_count);
+    if (block->full())
+        block = CreateNewRecordBlock(records_per_block);
 
     size_t location = AllocateBlock(new_size);
 
-    block->records[key] = Record{key, location, new_size, 0};
+    auto& record = block->add(Record{key, location, new_size, 0});
+    SetIndexed(key, {loaded_header.last_block, block->slots.at(key)});
 
     if (data) {
         buffer->Write(location, size, data);
-        block->records.at(key).used_size = size;
+        record.used_size = size;
     }
 }
 
 TEMPLATE
-void CLASS::LoadBlockIntoCache(size_t location, const CachedBlock& new_block) {
-    auto evicted = block_cache.Load(location, new_block);
+bool CLASS::Delete(const Key& key) {
+    std::unique_lock lock(mutex);
+
+    if (!buffer)
+        return false;
+
+    auto indexed = FindIndexed(key);
+    if (!indexed)
+        return false;
+
+    CachedBlock* block = GetRecordBlock(indexed->block);
+    EraseIndexed(key);
+
+    if (!block)
+        return false;
+
+    auto* record = block->find(key);
+    if (!record)
+        return false;
+
+    QuarantineBlock(record->location, record->capacity);
+    block->remove(key);
 
-    if (evicted)
+    if (pending_free_bytes > max_pending_free_bytes)
+        Commit();
+
+    return true;
+}
+
+TEMPLATE
+void CLASS::LoadBlockIntoCache(size_t location, CachedBlock new_block) {
+    auto evicted = block_cache.Load(location, std::move(new_block));
+
+    if (evicted && evicted->second.dirty)
         FlushBlock(evicted->first, evicted->second);
 }
 
 TEMPLATE
 void CLASS::FlushBlock(size_t location, CachedBlock& block) {
-    auto temporary_vector = std::vector<Record>();
-
     block.header.records_total = block.records.size();
-    temporary_vector.reserve(block.header.records_total);
-    for (auto& [key, record] : block.records)
-        temporary_vector.push_back(record);
-
     buffer->Write<BlockHeader>(location, block.header);
-    buffer->Write(location + sizeof(BlockHeader), temporary_vector.size() * sizeof(Record),
-                  reinterpret_cast<byte*>(temporary_vector.data()));
+
+    for (size_t page = 0; page < block.dirty_pages.size(); page++) {
+        if (!block.dirty_pages[page])
+            continue;
+
+        size_t first = page * slots_per_page;
+        size_t count = std::min(slots_per_page, block.records.size() - first);
+        buffer->Write(location + sizeof(BlockHeader) + first * sizeof(Record), count * sizeof(Record),
+                      reinterpret_cast<byte*>(block.records.data() + first));
+    }
+
+    block.dirty_pages.clear();
+    block.dirty = false;
 }
 
 TEMPLATE
@@ -133,25 +193,82 @@ CLASS::CachedBlock* CLASS::GetRecordBlock(size_t location) {
 
     auto& header = header_opt.value();
 
-    CachedBlock new_block = {header, {}};
-    auto temporary_vector = std::vector<Record>(header.records_total);
+    CachedBlock new_block = {header};
+    new_block.records.resize(header.records_total);
 
     if (!buffer->Read(location + sizeof(BlockHeader), sizeof(Record) * header.records_total,
-                      reinterpret_cast<byte*>(temporary_vector.data())))
+                      reinterpret_cast<byte*>(new_block.records.data())))
         return nullptr;
 
     for (size_t i = 0;i < header.records_total;i++){
-        new_block.records[temporary_vector[i].key] = temporary_vector[i];
+        if (new_block.records[i].location == 0)
+            new_block.free_slots.push_back(i);
+        else
+            new_block.slots[new_block.records[i].key] = i;
     }
 
-    LoadBlockIntoCache(location, new_block);
+    LoadBlockIntoCache(location, std::move(new_block));
 
     return block_cache.Get(location);
 }
 
 TEMPLATE
 void CLASS::FreeBlock(size_t location, size_t capacity) {
-    free_blocks.insert({location, capacity});
+    if (capacity == 0)
+        return;
+
+    auto next = free_extents.lower_bound(location);
+
+    if (next != free_extents.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == location) {
+            location = previous->first;
+            capacity += previous->second;
+            EraseFreeExtent(previous);
+        }
+    }
+
+    if (next != free_extents.end() && location + capacity == next->first) {
+        capacity += next->second;
+        EraseFreeExtent(next);
+    }
+
+    if (location + capacity == loaded_header.end) {
+        loaded_header.end = location;
+        return;
+    }
+
+    InsertFreeExtent(location, capacity);
+}
+
+TEMPLATE
+void CLASS::QuarantineBlock(size_t location, size_t capacity) {
+    if (capacity == 0)
+        return;
+
+    pending_free.push_back({location, capacity});
+    pending_free_bytes += capacity;
+}
+
+TEMPLATE
+void CLASS::InsertFreeExtent(size_t location, size_t capacity) {
+    free_extents[location] = capacity;
+    free_blocks.insert({capacity, location});
+    free_bytes += capacity;
+}
+
+TEMPLATE
+void CLASS::EraseFreeExtent(std::map<size_t, size_t>::iterator extent) {
+    auto [begin, end] = free_blocks.equal_range(extent->second);
+    for (auto it = begin; it != end; it++) {
+        if (it->second == extent->first) {
+            free_blocks.erase(it);
+            break;
+        }
+    }
+
+    free_bytes -= extent->second;
+    free_extents.erase(extent);
 }
 
 TEMPLATE
@@ -159,11 +276,14 @@ size_t CLASS::AllocateBlock(size_t capacity) {
     auto it = free_blocks.lower_bound(capacity);
 
     if (it != free_blocks.end()) {
-        auto [key, value] = *it;
-        if (key < capacity * 2) {
-            free_blocks.erase(it);
-            return value;
-        }
+        auto [size, location] = *it;
+        EraseFreeExtent(free_extents.find(location));
+
+        // The rest cant have free neighbours, they would have been merged with the whole block
+        if (size > capacity)
+            InsertFreeExtent(location + capacity, size - capacity);
+
+        return location;
     }
 
     size_t location = loaded_header.end;
@@ -176,33 +296,76 @@ TEMPLATE
 CLASS::CachedBlock* CLASS::CreateNewRecordBlock(size_t capacity) {
     BlockHeader header = {capacity};
     CachedBlock new_block = {header};
+    new_block.dirty = true;
 
     size_t location = AllocateBlock(sizeof(BlockHeader) + sizeof(Record) * header.capacity);
 
     auto last_block = GetRecordBlock(loaded_header.last_block);
-    if (last_block)
+    if (last_block) {
         last_block->header.next_block = location;
-    else
+        last_block->dirty             = true;
+    } else
         loaded_header.first_block = location;
 
     loaded_header.last_block = location;
-    LoadBlockIntoCache(location, new_block);
+    LoadBlockIntoCache(location, std::move(new_block));
 
     return block_cache.Get(location);
 }
 
 TEMPLATE
-void CLASS::Flush() {
-    block_cache.Clear([this](auto key, auto block) { FlushBlock(key, block); });
+void CLASS::Commit() {
+    if (!buffer)
+        return;
+
+    block_cache.ForEach([this](const size_t& location, CachedBlock& block) {
+        if (block.dirty)
+            FlushBlock(location, block);
+    });
+
+    // Nothing written points at the quarantined blocks anymore, their space can be handed out again
+    for (auto& [location, capacity] : pending_free)
+        FreeBlock(location, capacity);
+
+    pending_free.clear();
+    pending_free_bytes = 0;
+
+    SaveIndexPages();
     SaveFreeRecords();
-    free_blocks.clear();
+    SaveIndexDirectory();
     SaveHeader();
 }
 
+TEMPLATE
+void CLASS::Flush() {
+    std::unique_lock lock(mutex);
+
+    if (!buffer)
+        return;
+
+    Commit();
+    buffer->Flush();
+}
+
+TEMPLATE
+void CLASS::Detach() {
+    Commit();
+
+    block_cache.Clear([](auto, auto) {});
+    free_blocks.clear();
+    free_extents.clear();
+    free_bytes = 0;
+    pending_free.clear();
+    pending_free_bytes = 0;
+    ClearIndex();
+}
+
 TEMPLATE
 void CLASS::SetBuffer(Buffer* buffer) {
+    std::unique_lock lock(mutex);
+
     if (this->buffer != nullptr)
-        Flush();
+        Detach();
 
     if (buffer == nullptr) {
         this->buffer = nullptr;
@@ -214,7 +377,7 @@ void CLASS::SetBuffer(Buffer* buffer) {
     auto header_opt = buffer->Read<Header>(0);
 
     if (!header_opt)
-        ResetHeader();
+        Reset();
 
     header_opt = buffer->Read<Header>(0);
 
@@ -226,19 +389,207 @@ void CLASS::SetBuffer(Buffer* buffer) {
 
     loaded_header = header_opt.value();
 
-    if (loaded_header.free_records_total == 0)
+    // Freeing the loaded records can move the end, so the index has to be read first
+    LoadIndex();
+    LoadFreeRecords();
+}
+
+TEMPLATE
+size_t CLASS::Checksum(const byte* data, size_t size) {
+    size_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<size_t>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+TEMPLATE
+size_t CLASS::TrailerLocation() const {
+    return loaded_header.end + sizeof(TrailerSection) + sizeof(FreeRecord) * loaded_header.free_records_total;
+}
+
+TEMPLATE
+void CLASS::LoadFreeRecords() {
+    auto section_opt = buffer->Read<TrailerSection>(loaded_header.end);
+    if (!section_opt || section_opt->magic != free_records_magic || section_opt->end != loaded_header.end ||
+        section_opt->total != loaded_header.free_records_total) {
+        // Older stores and stores that were not closed properly, the space stays unused but is never handed out twice
+        if (loaded_header.free_records_total != 0)
+            LogError("Free records of the record store are missing, their space will not be reused.");
         return;
+    }
 
-    auto free_records = std::vector<FreeRecord>(loaded_header.free_records_total);
-    buffer->Read(loaded_header.end, sizeof(FreeRecord) * loaded_header.free_records_total,
-                 reinterpret_cast<byte*>(free_records.data()));
+    auto free_records = std::vector<FreeRecord>(section_opt->total);
+    size_t size       = sizeof(FreeRecord) * free_records.size();
+
+    if (!buffer->Read(loaded_header.end + sizeof(TrailerSection), size, reinterpret_cast<byte*>(free_records.data())) ||
+        Checksum(reinterpret_cast<byte*>(free_records.data()), size) != section_opt->checksum) {
+        LogError("Free records of the record store are corrupted, their space will not be reused.");
+        return;
+    }
 
     for (auto& [location, capacity] : free_records)
-        FreeRecord(location, capacity);
+        FreeBlock(location, capacity);
+}
+
+TEMPLATE
+void CLASS::LoadIndex() {
+    ClearIndex();
+
+    size_t directory_location = TrailerLocation();
+
+    auto section_opt = buffer->Read<TrailerSection>(directory_location);
+    bool loaded      = false;
+
+    // The directory has a power of two pages, keys are assigned to them by the top bits of their mixed hash
+    if (section_opt && section_opt->magic == index_magic && section_opt->end == loaded_header.end && section_opt->total != 0 &&
+        (section_opt->total & (section_opt->total - 1)) == 0) {
+        auto directory = std::vector<IndexPage>(section_opt->total);
+        size_t size    = sizeof(IndexPage) * directory.size();
+
+        if (buffer->Read(directory_location + sizeof(TrailerSection), size, reinterpret_cast<byte*>(directory.data())) &&
+            Checksum(reinterpret_cast<byte*>(directory.data()), size) == section_opt->checksum) {
+            index_pages.resize(directory.size());
+            loaded = true;
+
+            std::vector<IndexEntry> entries{};
+            for (size_t i = 0; i < directory.size(); i++) {
+                // The page keeps its space whether it can be read or not
+                auto& page      = directory[i];
+                auto& stored    = index_pages[i].stored;
+                stored.location = page.location;
+                stored.capacity = page.capacity;
+
+                entries.resize(page.total);
+                size_t page_size = sizeof(IndexEntry) * entries.size();
+                if (!buffer->Read(page.location, page_size, reinterpret_cast<byte*>(entries.data())) ||
+                    Checksum(reinterpret_cast<byte*>(entries.data()), page_size) != page.checksum) {
+                    loaded = false;
+                    continue;
+                }
+
+                // A key on another page than its hash picks can't be found, the index is rebuilt then
+                for (auto& [key, block, slot] : entries) {
+                    if (IndexPageFor(key) != i) {
+                        loaded = false;
+                        break;
+                    }
+                    index_pages[i].entries[key] = {block, slot};
+                }
+
+                indexed_total += index_pages[i].entries.size();
+                index_pages[i].dirty = false;
+                stored               = page;
+            }
+        }
+    }
+
+    if (loaded)
+        return;
+
+    // Stores written before the index existed or not closed properly, walks the chain once
+    for (auto& page : index_pages) {
+        page.entries.clear();
+        page.dirty = true;
+    }
+    indexed_total = 0;
+
+    size_t location = loaded_header.first_block;
+    while (location != 0) {
+        CachedBlock* block = GetRecordBlock(location);
+        if (!block)
+            break;
+
+        for (auto& [key, slot] : block->slots)
+            SetIndexed(key, {location, slot});
+
+        location = block->header.next_block;
+    }
+}
+
+TEMPLATE
+size_t CLASS::IndexPageFor(const Key& key) const {
+    if (index_pages.size() == 1)
+        return 0;
+
+    // Key hashes like IVec3Hash leave most low bits the same, so the page is picked from the top bits of a mixed hash
+    size_t mixed = Hash{}(key) * 0x9E3779B97F4A7C15ULL;
+    return mixed >> (64 - std::countr_zero(index_pages.size()));
+}
+
+TEMPLATE
+std::optional<typename CLASS::IndexedRecord> CLASS::FindIndexed(const Key& key) const {
+    auto& entries = index_pages[IndexPageFor(key)].entries;
+
+    auto entry = entries.find(key);
+    if (entry == entries.end())
+        return std::nullopt;
+
+    return entry->second;
+}
+
+TEMPLATE
+void CLASS::SetIndexed(const Key& key, IndexedRecord record) {
+    auto& page = index_pages[IndexPageFor(key)];
+
+    auto [entry, inserted] = page.entries.try_emplace(key, record);
+    if (!inserted && entry->second == record)
+        return;
+
+    entry->second = record;
+    page.dirty    = true;
+
+    if (inserted && ++indexed_total > index_pages.size() * index_page_entries)
+        GrowIndex();
+}
+
+TEMPLATE
+bool CLASS::EraseIndexed(const Key& key) {
+    auto& page = index_pages[IndexPageFor(key)];
+    if (page.entries.erase(key) == 0)
+        return false;
+
+    page.dirty = true;
+    indexed_total--;
+    return true;
+}
+
+TEMPLATE
+void CLASS::GrowIndex() {
+    auto old_pages = std::move(index_pages);
+
+    index_pages = std::vector<LoadedIndexPage>(old_pages.size() * 2);
+    for (auto& page : old_pages) {
+        QuarantineBlock(page.stored.location, page.stored.capacity * sizeof(IndexEntry));
+
+        for (auto& [key, record] : page.entries)
+            index_pages[IndexPageFor(key)].entries.emplace(key, record);
+    }
+}
+
+TEMPLATE
+void CLASS::ClearIndex() {
+    index_pages   = std::vector<LoadedIndexPage>(1);
+    indexed_total = 0;
 }
 
 TEMPLATE
 void CLASS::ResetHeader() {
+    std::unique_lock lock(mutex);
+    Reset();
+}
+
+TEMPLATE
+void CLASS::Reset() {
+    block_cache.Clear([](auto, auto) {});
+    free_blocks.clear();
+    free_extents.clear();
+    free_bytes = 0;
+    pending_free.clear();
+    pending_free_bytes = 0;
+    ClearIndex();
+
     loaded_header = {};
     loaded_header.end = sizeof(Header);
     SaveHeader();
@@ -246,19 +597,89 @@ void CLASS::ResetHeader() {
 
 TEMPLATE
 void CLASS::SaveFreeRecords() {
-    loaded_header.free_records_total = free_blocks.size();
-
-    if (loaded_header.free_records_total == 0)
+    if (!buffer)
         return;
 
+    loaded_header.free_records_total = free_extents.size();
+
     auto free_records = std::vector<FreeRecord>();
     free_records.reserve(loaded_header.free_records_total);
 
-    for (auto& [location, capacity] : free_blocks)
+    for (auto& [location, capacity] : free_extents)
         free_records.push_back({location, capacity});
 
-    buffer->Write(loaded_header.end, sizeof(FreeRecord) * loaded_header.free_records_total,
-                  reinterpret_cast<byte*>(free_records.data()));
+    size_t size = sizeof(FreeRecord) * free_records.size();
+
+    TrailerSection section = {free_records_magic, loaded_header.end, free_records.size(),
+                              Checksum(reinterpret_cast<byte*>(free_records.data()), size)};
+
+    buffer->Write<TrailerSection>(loaded_header.end, section);
+    buffer->Write(loaded_header.end + sizeof(TrailerSection), size, reinterpret_cast<byte*>(free_records.data()));
+}
+
+TEMPLATE
+void CLASS::SaveIndexPages() {
+    if (!buffer)
+        return;
+
+    std::vector<IndexEntry> entries{};
+    for (auto& page : index_pages) {
+        if (!page.dirty)
+            continue;
+
+        entries.clear();
+        for (auto& [key, record] : page.entries)
+            entries.push_back({key, record.block, record.slot});
+
+        // Moved to a larger space with room to grow, the old space is free once this commit is written
+        auto& stored = page.stored;
+        if (stored.capacity < entries.size()) {
+            QuarantineBlock(stored.location, stored.capacity * sizeof(IndexEntry));
+
+            stored.capacity = entries.size() + entries.size() / 2 + 64;
+            stored.location = AllocateBlock(stored.capacity * sizeof(IndexEntry));
+        }
+
+        size_t size     = sizeof(IndexEntry) * entries.size();
+        stored.total    = entries.size();
+        stored.checksum = Checksum(reinterpret_cast<byte*>(entries.data()), size);
+
+        buffer->Write(stored.location, size, reinterpret_cast<byte*>(entries.data()));
+        page.dirty = false;
+    }
+}
+
+TEMPLATE
+void CLASS::SaveIndexDirectory() {
+    if (!buffer)
+        return;
+
+    auto directory = std::vector<IndexPage>();
+    directory.reserve(index_pages.size());
+
+    for (auto& page : index_pages)
+        directory.push_back(page.stored);
+
+    size_t size = sizeof(IndexPage) * directory.size();
+
+    TrailerSection section = {index_magic, loaded_header.end, directory.size(),
+                              Checksum(reinterpret_cast<byte*>(directory.data()), size)};
+
+    buffer->Write<TrailerSection>(TrailerLocation(), section);
+    buffer->Write(TrailerLocation() + sizeof(TrailerSection), size, reinterpret_cast<byte*>(directory.data()));
+}
+
+TEMPLATE
+CLASS::SpaceStats CLASS::GetSpaceStats() const {
+    std::shared_lock lock(mutex);
+
+    SpaceStats stats{};
+
+    stats.disk_bytes = loaded_header.end;
+    stats.free_bytes = free_bytes + pending_free_bytes;
+    stats.live_bytes = loaded_header.end - stats.free_bytes - sizeof(Header);
+
+    return stats;
 }
 
 TEMPLATE
@@ -29,6 +29,22 @@ class SegregatedList{
             list.insert(list.end(), values.begin(), values.end());
         }
 
+        /**
+         * @brief Appends space for a number of elements under a key and returns a pointer to it, to be written right away
+         * 
+         * @param key 
+         * @param count 
+         * @return T* 
+         */
+        T* Extend(const K& key, size_t count){
+            auto& list = groups[key];
+
+            size_t start = list.size();
+            list.resize(start + count);
+
+            return list.data() + start;
+        }
+
         /**
          * @brief Check if key exists
          * 
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <structure/bytearray.hpp>
+
+/**
+ * @brief Encodes the rows of a 64x64x64 bit field for storage, picking the smallest of several encodings for every field
+ *
+ * Every encoded field starts with a byte recording its encoding, followed by the byte size of the payload and the payload.
+ * Rows are indexed the same way as in the BitField3D (x + y * 64), with z going from the highest bit.
+ */
+class FieldCodec {
+  public:
+    using Rows = std::array<uint64_t, 64 * 64>;
+
+    /**
+     * @brief Version of the chunk format that uses the codec, written in front of every serialized block array
+     *
+     * Older block arrays start with a bool, so any value above 1 marks the new format.
+     */
+    const static uint8_t format_version = 2;
+
+    enum Method : uint8_t {
+        ROWS      = 0, // The original row scheme of BitField3D::compress, only all zero and all one rows are collapsed
+        AXIS_RUNS = 1, // Run lengths of the bits along one axis
+        ROW_RUNS  = 2, // Run lengths of identical rows
+    };
+
+    const static uint8_t method_mask = 0b111;
+    const static uint8_t axis_shift  = 3;     // Two bits of the axis the runs go along, for AXIS_RUNS
+    const static uint8_t lz_flag     = 1 << 7; // The payload is additionally LZ compressed
+
+    /**
+     * @brief Appends the smallest encoding of the rows
+     *
+     * @param rows
+     * @param output
+     */
+    static void encode(const Rows& rows, ByteArray& output);
+
+    /**
+     * @brief Reads an encoded field
+     *
+     * @param input
+     * @param rows overwritten completely
+     * @return true
+     * @return false if the data is corrupted
+     */
+    static bool decode(ByteArray& input, Rows& rows);
+
+    /*
+        The individual stages, public so they can be measured separately
+    */
+    static void encodeAxisRuns(const Rows& rows, int axis, std::vector<uint8_t>& output);
+    static bool decodeAxisRuns(const std::vector<uint8_t>& input, int axis, Rows& rows);
+
+    static void encodeRowRuns(const Rows& rows, std::vector<uint8_t>& output);
+    static bool decodeRowRuns(const std::vector<uint8_t>& input, Rows& rows);
+
+    static void compressLZ(const std::vector<uint8_t>& input, std::vector<uint8_t>& output);
+    static bool decompressLZ(const std::vector<uint8_t>& input, std::vector<uint8_t>& output);
+};
@@ -35,6 +35,14 @@ class Buffer: public Stream{
         // Returns the buffers size
         virtual size_t Size() = 0;
 
+        /**
+         * @brief Makes everything written so far durable, buffers that only live in memory have nothing to do
+         * 
+         * @return true 
+         * @return false 
+         */
+        virtual bool Flush() { return true; }
+
         /*
             Quality of life functions
         */
@@ -7,6 +7,8 @@
 #include <functional>
 #include <filesystem>
 #include <mutex>
+#include <shared_mutex>
+#include <atomic>
 
 #include <logging.hpp>
 #include <structure/streams/buffer.hpp>
@@ -14,8 +16,11 @@
 #include <path_config.hpp>
 
 /**
- * @brief A wrapper around the original filestream that automatically creates the file, allows loading and initialization callbacks 
+ * @brief A memory mapped file that is automatically created, allows loading and initialization callbacks
  * 
+ * Reads and writes are positional and copy straight from and into the mapped pages, they only take a shared lock
+ * so they can run in parallel. Opening maps only the existing contents, writing past them grows the mapping in large steps
+ * and the file is cut back to its size when closed.
  */
 class FileStream: public Buffer{
     public:
@@ -25,22 +30,60 @@ class FileStream: public Buffer{
         std::string name;
         fs::path path;
 
-        std::fstream stream;
-        std::mutex mutex;
+#ifdef _WIN32
+        void* file = nullptr;
+        void* file_mapping = nullptr;
+#else
+        int file = -1;
+#endif
+        byte* mapping = nullptr;
+        size_t mapped_size = 0;
+
+        // Held shared while accessing the mapping, unique while it is replaced
+        std::shared_mutex mapping_mutex;
 
         Callback init;
         Callback load;
 
-        size_t filesize = 0;
+        std::atomic<size_t> filesize = 0;
+
+        const static size_t minimal_mapping_size = 1024 * 1024;
+
+        /**
+         * @brief Grows the file and maps it again so at least size bytes are mapped, needs the mapping lock held uniquely
+         * 
+         * @param size 
+         * @return true 
+         * @return false 
+         */
+        bool Remap(size_t size);
+        /**
+         * @brief Maps exactly size bytes, grows the file if it is smaller, needs the mapping lock held uniquely
+         * 
+         * @param size 
+         * @return true 
+         * @return false 
+         */
+        bool Map(size_t size);
+        void Unmap();
+        void Close();
 
     public:
         FileStream(const Callback& init = nullptr, const Callback& load = nullptr);
-        virtual ~FileStream() = default;
+        virtual ~FileStream();
 
         bool Read(size_t offset, size_t size, byte* buffer) override;
         bool Write(size_t offset, size_t size, const byte* buffer) override;
         size_t Size() override;
 
+        /**
+         * @brief Writes the changed pages to the disk, blocks until they are written
+         * 
+         * @return true 
+         * @return false 
+         */
+        bool Flush() override;
+
         void SetCallbacks(const Callback& init, const Callback& load);
         bool Open(const fs::path& path);
 };
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Sync {
+
+/**
+ * @brief Epoch based reclamation, memory unlinked from a shared structure is only freed once no reader can still see it
+ *
+ * Readers pin the domain for as long as they use pointers read from the structure, pinning is lock free.
+ * Retired memory is kept for two epochs, the epoch only advances once every reader pinned in the one before is gone.
+ */
+class EpochDomain {
+  private:
+    const static size_t stripe_count = 16;
+
+    // Readers of the even and odd epochs, spread over stripes by thread so they don't all write the same cache line
+    struct alignas(64) Stripe {
+        std::array<std::atomic<size_t>, 2> readers{};
+    };
+
+    std::array<Stripe, stripe_count> stripes{};
+    std::atomic<uint64_t> epoch = 0;
+
+    std::mutex retire_mutex;
+    std::array<std::vector<std::function<void()>>, 2> retired{}; // By the parity of the epoch they were retired in
+
+    size_t Readers(size_t parity);
+
+    // Frees what was retired two epochs ago and advances, needs the retire_mutex, fails while readers are left
+    bool TryAdvance();
+
+  public:
+    /**
+     * @brief Keeps everything reachable when it was created alive until it is destroyed
+     *
+     */
+    class Guard {
+      private:
+        std::atomic<size_t>* readers = nullptr;
+
+        Guard(std::atomic<size_t>* readers) : readers(readers) {}
+        friend class EpochDomain;
+
+      public:
+        Guard() {}
+        Guard(Guard&& other) noexcept : readers(other.readers) {
+            other.readers = nullptr;
+        }
+        Guard& operator=(Guard&& other) noexcept {
+            std::swap(readers, other.readers);
+            return *this;
+        }
+        Guard(const Guard&)            = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            if (readers)
+                readers->fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    EpochDomain() {}
+    ~EpochDomain();
+
+    /**
+     * @brief Pins the current epoch, lock free
+     *
+     * @return Guard
+     */
+    Guard Pin();
+
+    /**
+     * @brief Runs the deleter once no reader that could have seen the memory is left
+     *
+     * The memory has to be unreachable for new readers already.
+     *
+     * @param deleter
+     */
+    void Retire(std::function<void()> deleter);
+
+    template <typename T> void Retire(T* pointer) {
+        Retire([pointer]() { delete pointer; });
+    }
+
+    /**
+     * @brief Frees what no reader can see anymore without waiting, advances as far as the readers allow
+     *
+     */
+    void Collect();
+
+    /**
+     * @brief Waits until every reader pinned before the call is gone, frees everything retired before it
+     *
+     * Never call it while pinning the domain on the same thread, it would wait for itself.
+     */
+    void Synchronize();
+
+    /**
+     * @brief Returns the amount of retired memory blocks still waiting for readers
+     *
+     * @return size_t
+     */
+    size_t Pending();
+};
+
+} // namespace Sync
@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <mutex>
+#include <thread>
 
 /**
  * @brief A class that manages threadlocal elements, when the c++20 implementation is broken,
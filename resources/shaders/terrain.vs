@@ -1,15 +1,7 @@
+#version 460 core
 
-#version 330 core
-
-layout(location = 0) in vec3  aInstancePosition;
-layout(location = 1) in vec2  aInstanceSize;
-layout(location = 2) in float aInstaceType;
-layout(location = 3) in float aInstanceDirection;
-layout(location = 4) in float aTextureIndex;
-layout(location = 5) in vec4 aOcclusion;
-
-layout(location = 6) in vec3 aPos;
-layout(location = 7) in vec2 aTexCoords;
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec2 aTexCoords;
 
 uniform mat4 player_camera_projection_matrix;
 uniform mat4 player_camera_view_matrix;
@@ -24,6 +16,18 @@ out float Occlusion;
 out vec3 FragPos;
 uniform vec3 camPos;
 
+// Chunk position of every draw call
+layout(std430, binding = 0) buffer SSBO_origins {
+    ivec4 origins[];
+};
+
+// Faces packed as in include/rendering/packed_face.hpp
+layout(std430, binding = 1) buffer SSBO_instances {
+    uint instances[];
+};
+
+uniform float DrawOffset;
+
 const vec3 Normals[6] = vec3[6](
     vec3( 0, 1, 0),
     vec3( 0,-1, 0),
@@ -35,8 +39,31 @@ const vec3 Normals[6] = vec3[6](
 
 void main()
 {
-    float width = aInstanceSize.x;
-    float height = aInstanceSize.y;
+    uint index = uint(gl_BaseInstance + gl_InstanceID) * 2;
+
+    uint first_portion  = instances[index];
+    uint second_portion = instances[index + 1];
+
+    const uint mask2 = 3;
+    const uint mask6 = 63;
+    const uint mask7 = 127;
+
+    vec3 instance_position = vec3(
+        first_portion & mask7,
+        (first_portion >> 7 ) & mask7,
+        (first_portion >> 14) & mask7
+    );
+
+    uint width_bits  = (first_portion >> 21) & mask6;
+    uint height_bits = second_portion & mask6;
+
+    float width  = width_bits  > 0 ? float(width_bits)  : 64.0;
+    float height = height_bits > 0 ? float(height_bits) : 64.0;
+
+    int face_type = int((first_portion >> 27) & mask2);
+    int direction = int((first_portion >> 29) & 1);
+
+    ivec3 origin = origins[int(DrawOffset) + gl_DrawID].xyz;
 
     vec3 Size[4] = vec3[4](
         vec3(1    ,height,width ),
@@ -45,25 +72,24 @@ void main()
         vec3(1,1,1)
     );
 
-    vec3 pos = aPos * Size[int(aInstaceType)] + aInstancePosition;
+    vec3 pos = aPos * Size[face_type] + instance_position + vec3(origin) * 64;
 
     vec4 viewPos = player_camera_view_matrix * player_camera_model_matrix * vec4(pos, 1.0);
     FragPos = viewPos.xyz;
     gl_Position = player_camera_projection_matrix * viewPos;
 
-    int index = int(aInstaceType) * 2 + int(aInstanceDirection);
-
-    Normal = Normals[index];
+    Normal = Normals[face_type * 2 + direction];
 
     vec2 TextCoordList[4] = vec2[4](
-        aInstanceSize,
+        vec2(width, height),
         vec2(height, width),
-        aInstanceSize,
-        aInstanceSize
+        vec2(width, height),
+        vec2(width, height)
     );
 
-    TexCoords = aTexCoords * TextCoordList[int(aInstaceType)];
-    TexIndex = aTextureIndex;
+    TexCoords = aTexCoords * TextCoordList[face_type];
+    TexIndex = float(second_portion >> 14);
 
-    Occlusion = aOcclusion[gl_VertexID % 4];
+    // Already in GL_TRIANGLE_STRIP order
+    Occlusion = float((second_portion >> (6 + (gl_VertexID % 4) * 2)) & mask2);
 }
@@ -1,4 +1,5 @@
 #include <bitarray.hpp>
+#include <structure/bitworks.hpp>
 #include <memory>
 #include <mutex>
 
@@ -51,9 +52,40 @@ bool BitField3D::setRow(uint x, uint y, uint64_t value) {
         return false;
 
     auto lock = guard.Unique();
+    transposed_cache_version_pointer = nullptr; // Only single bits are mirrored, rebuild it when asked for next time
     return BitField::setRow(x, y, value);
 }
 
+bool BitField3D::setRowMask(uint x, uint y, uint64_t mask) {
+    if (!inBounds(x, y))
+        return false;
+
+    auto lock = guard.Unique();
+    transposed_cache_version_pointer = nullptr;
+    return BitField::setRowMask(x, y, mask);
+}
+
+bool BitField3D::resetRowMask(uint x, uint y, uint64_t mask) {
+    if (!inBounds(x, y))
+        return false;
+
+    auto lock = guard.Unique();
+    transposed_cache_version_pointer = nullptr;
+    return BitField::resetRowMask(x, y, mask);
+}
+
+void BitField3D::setMask(const BitField& mask) {
+    auto lock = guard.Unique();
+    transposed_cache_version_pointer = nullptr;
+    BitField::setMask(mask);
+}
+
+void BitField3D::resetMask(const BitField& mask) {
+    auto lock = guard.Unique();
+    transposed_cache_version_pointer = nullptr;
+    BitField::resetMask(mask);
+}
+
 uint64_t BitField3D::getRow(uint x, uint y) {
     if (!inBounds(x, y))
         return 0ULL;
@@ -75,34 +107,72 @@ BitField3D* BitField3D::getTransposed() {
         }
     }
 
+    TCacheMember* transposed = nullptr;
+    {
+        auto lock  = guard.Shared();
+        transposed = BitFieldCache::get().next(id, &data());
+    }
+
     /*
-        TODO: implement transposing
+        Every y slice is a 64x64 bit matrix (x rows of z bits), transposing each in place swaps x and z
     */
+    auto& transposed_data = transposed->field.data();
+    for (int y = 0; y < 64; y++)
+        transpose_bit_matrix_64(transposed_data.data() + calculateIndex(0, y));
 
-    auto transposed = std::make_unique<BitField>();
+    auto lock = guard.Unique();
+    transposed_cache_version_pointer = transposed;
 
+    return &transposed_cache_version_pointer->field;
+}
+
+void BitFieldSnapshot::capture(BitField3D& field) {
     {
-        auto lock = guard.Shared();
-        for (int z = 0; z < 64; z++) {
-            for (int y = 0; y < 64; y++) {
-                uint64_t value = BitField::getRow(z, y);
+        auto lock = field.Guard().Shared();
+        rows_data = field.data();
+    }
 
-                for (int x = 0; x < 64; x++) {
-                    uint64_t mask = 1ULL << (63 - x);
+    transposed_data = rows_data;
+    for (int y = 0; y < 64; y++)
+        transpose_bit_matrix_64(transposed_data.data() + y * 64);
+}
 
-                    if (!(value & mask))
-                        continue;
+void BitFieldSnapshot::clear() {
+    rows_data.fill(0);
+    transposed_data.fill(0);
+}
 
-                    transposed->setRow(x, y, transposed->getRow(x, y) | (1ULL << (63 - z)));
-                }
-            }
-        }
-    }
+void BitFieldBorder::captureX(BitField3D& field, uint x) {
+    auto lock        = field.Guard().Shared();
+    const auto& data = field.data();
+    for (uint row = 0; row < 64; row++)
+        x_plane[row] = data[x + row * 64];
+}
 
-    auto lock = guard.Unique();
-    transposed_cache_version_pointer = BitFieldCache::get().next(id, &transposed->data());
+void BitFieldBorder::captureY(BitField3D& field, uint y) {
+    auto lock        = field.Guard().Shared();
+    const auto& data = field.data();
+    for (uint row = 0; row < 64; row++)
+        y_plane[row] = data[row + y * 64];
+}
 
-    return &transposed_cache_version_pointer->field;
+void BitFieldBorder::captureZ(BitField3D& field, uint z) {
+    auto lock        = field.Guard().Shared();
+    const auto& data = field.data();
+
+    const uint shift = 63 - z;
+    for (uint y = 0; y < 64; y++) {
+        uint64_t row = 0;
+        for (uint x = 0; x < 64; x++)
+            row |= ((data[x + y * 64] >> shift) & 1ULL) << (63 - x);
+        z_plane[y] = row;
+    }
+}
+
+void BitFieldBorder::clear() {
+    x_plane.fill(0);
+    y_plane.fill(0);
+    z_plane.fill(0);
 }
 
 const static std::array<uint64_t, 6> column_masks = {0xAAAAAAAAAAAAAAAA, // 1010
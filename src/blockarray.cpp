@@ -1,18 +1,34 @@
 #include <blockarray.hpp>
 
+#include <bit>
+
+#include <structure/synchronization/threadlocal.hpp>
+
 void SparseBlockArray::setBlock(glm::ivec3 position, const Block& block, bool dont_check){
     altered = true;
 
-    if(!dont_check){
-        auto* block_here = getBlock(position);
-        if(block_here != &airBlock){
-            getLayer(block_here->id).field().reset(position.x,position.y,position.z);
+    bool in_bounds = position.x >= 0 && position.y >= 0 && position.z >= 0 && position.x < 64 && position.y < 64 && position.z < 64;
+    size_t palette_index = in_bounds ? PaletteIndexArray::index(position.x, position.y, position.z) : 0;
+
+    // The index names the layer of the block here, so it is always cleared to keep the index and the layers the same.
+    // Air has nothing to set on top, it clears the block whatever the caller knows
+    if(!dont_check || layout == PALETTE || block.id == BLOCK_AIR_INDEX){
+        if(layout == PALETTE){
+            uint32_t entry = in_bounds ? palette_indexes.get(palette_index) : 0;
+            if(entry != 0) layers[entry - 1].field().reset(position.x,position.y,position.z);
+        }
+        else{
+            auto* block_here = getBlock(position);
+            if(block_here != &airBlock){
+                getLayer(block_here->id).field().reset(position.x,position.y,position.z);
+            }
         }
     }
 
     if(block.id == BLOCK_AIR_INDEX){
         if(interactable_blocks.contains(position)) interactable_blocks.erase(position);
         solid_field.get()->reset(position.x,position.y,position.z);
+        if(layout == PALETTE && in_bounds) palette_indexes.set(palette_index, 0);
         return;
     }
 
@@ -20,8 +36,9 @@ void SparseBlockArray::setBlock(glm::ivec3 position, const Block& block, bool do
         createLayer(block.id, {});
     }
 
-    auto& layer = getLayer(block.id);
-    layer.field().set(position.x,position.y,position.z);
+    size_t layer_index = type_indexes[block.id];
+    layers[layer_index].field().set(position.x,position.y,position.z);
+    if(layout == PALETTE && in_bounds) palette_indexes.set(palette_index, layer_index + 1);
 
     auto* block_definition = BlockRegistry::get().getPrototype(block.id);
     if(!block_definition) return;
@@ -33,10 +50,111 @@ void SparseBlockArray::setBlock(glm::ivec3 position, const Block& block, bool do
     if(block_definition->interface) interactable_blocks.emplace(position,Block{block.id, block_definition->interface->createMetadata()});
 }
 
+void SparseBlockArray::setRows(const BitField& mask, const Block& block, bool dont_check){
+    altered = true;
+
+    auto& rows = mask.data();
+    auto in_mask = [&rows](const glm::ivec3& position){
+        if(position.x < 0 || position.y < 0 || position.z < 0 || position.x >= 64 || position.y >= 64 || position.z >= 64) return false;
+        return (rows[position.x + position.y * 64] & (1ULL << (63 - position.z))) != 0;
+    };
+
+    // Like in setBlock, blocks under an index or under air are always cleared
+    if(!dont_check || layout == PALETTE || block.id == BLOCK_AIR_INDEX){
+        for(auto& layer: layers) layer.field().resetMask(mask);
+    }
+
+    if(!interactable_blocks.empty()){
+        std::erase_if(interactable_blocks, [&in_mask](auto& entry){ return in_mask(entry.first); });
+    }
+
+    if(block.id == BLOCK_AIR_INDEX){
+        solid_field.get()->resetMask(mask);
+        if(layout == PALETTE){
+            for(size_t row = 0;row < rows.size();row++) palette_indexes.setMasked(row, rows[row], 0);
+        }
+        return;
+    }
+
+    if(!hasLayerOfType(block.id)){
+        createLayer(block.id, {});
+    }
+
+    size_t layer_index = type_indexes[block.id];
+    layers[layer_index].field().setMask(mask);
+    if(layout == PALETTE){
+        for(size_t row = 0;row < rows.size();row++) palette_indexes.setMasked(row, rows[row], layer_index + 1);
+    }
+
+    auto* block_definition = BlockRegistry::get().getPrototype(block.id);
+    if(!block_definition) return;
+
+    if(!block_definition->transparent) solid_field.get()->setMask(mask);
+    else solid_field.get()->resetMask(mask);
+
+    if(!block_definition->interface) return;
+
+    for(size_t row = 0;row < rows.size();row++){
+        for(uint64_t bits = rows[row];bits != 0;){
+            int z = std::countl_zero(bits);
+            bits &= ~(1ULL << (63 - z));
+            interactable_blocks.emplace(glm::ivec3(row % 64, row / 64, z), Block{block.id, block_definition->interface->createMetadata()});
+        }
+    }
+}
+
+// Moves the bits of a field by offset into the output, bits that end up outside are dropped, returns whether any are left
+static bool ShiftField(BitField3D& field, const glm::ivec3& offset, BitField& output){
+    auto& output_rows = output.data();
+    output_rows.fill(0);
+
+    glm::ivec3 begin = glm::max(offset, glm::ivec3(0));
+    glm::ivec3 end = glm::min(offset + 64, glm::ivec3(64));
+
+    auto lock = field.Guard().Shared();
+    auto& rows = field.data();
+
+    bool any = false;
+    for(int y = begin.y;y < end.y;y++)
+    for(int x = begin.x;x < end.x;x++){
+        uint64_t row = rows[(x - offset.x) + (y - offset.y) * 64];
+
+        // z = 0 is the highest bit, moving towards larger z shifts right
+        row = offset.z >= 0 ? row >> offset.z : row << -offset.z;
+        output_rows[x + y * 64] = row;
+        any |= row != 0;
+    }
+
+    return any;
+}
+
+bool SparseBlockArray::paste(SparseBlockArray& source, const glm::ivec3& offset){
+    if(offset.x <= -64 || offset.y <= -64 || offset.z <= -64 || offset.x >= 64 || offset.y >= 64 || offset.z >= 64) return false;
+
+    static ThreadLocal<BitField> mask_scratch{};
+    auto& mask = mask_scratch.Get();
+
+    bool any = false;
+
+    // Earlier layers win where layers overlap when looking up blocks, so they are pasted last
+    for(size_t i = source.layers.size();i-- > 0;){
+        auto& layer = source.layers[i];
+        if(!ShiftField(layer.field(), offset, mask)) continue;
+
+        setRows(mask, layer.internal_block);
+        any = true;
+    }
+
+    return any;
+}
+
 void SparseBlockArray::fill(const Block& block){
     altered = true;
 
     layers.clear();
+    present_types.clear();
+    type_indexes.clear();
+    setLayout(LAYERED);
 
     if(block.id == BLOCK_AIR_INDEX){
         solid_field.get()->fill(0);
@@ -57,7 +175,17 @@ void SparseBlockArray::fill(const Block& block){
 }
 
 Block* SparseBlockArray::getBlock(glm::ivec3 position){
-    if(interactable_blocks.contains(position)) return &interactable_blocks.at(position);
+    if(!interactable_blocks.empty()){
+        auto interactable = interactable_blocks.find(position);
+        if(interactable != interactable_blocks.end()) return &interactable->second;
+    }
+
+    if(layout == PALETTE){
+        if(position.x < 0 || position.y < 0 || position.z < 0 || position.x >= 64 || position.y >= 64 || position.z >= 64) return &airBlock;
+
+        uint32_t entry = palette_indexes.get(PaletteIndexArray::index(position.x, position.y, position.z));
+        return entry == 0 ? &airBlock : &layers[entry - 1].internal_block;
+    }
 
     for(auto& layer: layers){
         if(!layer.field().get(position.x,position.y,position.z)) continue;
@@ -66,4 +194,47 @@ Block* SparseBlockArray::getBlock(glm::ivec3 position){
     }
 
     return &airBlock;
-}
\ No newline at end of file
+}
+void SparseBlockArray::setLayout(Layout new_layout){
+    if(new_layout == layout) return;
+
+    layout = new_layout;
+    palette_indexes.clear();
+    if(layout == LAYERED) return;
+
+    // Size the index for all layers right away so it is not repacked while they are added
+    palette_indexes.reserve(layers.size());
+
+    for(size_t i = 0;i < layers.size();i++){
+        indexLayer(i, layers[i].field());
+    }
+}
+
+void SparseBlockArray::selectLayout(){
+    if(layers.size() < palette_min_layers){
+        setLayout(LAYERED);
+        return;
+    }
+
+    size_t blocks = 0;
+    for(auto& layer: layers){
+        for(uint64_t row: layer.field().data()) blocks += std::popcount(row);
+    }
+
+    setLayout(blocks >= palette_min_blocks ? PALETTE : LAYERED);
+}
+
+void SparseBlockArray::indexLayer(size_t layer_index, const BitField3D& field){
+    auto& rows = field.data();
+    for(size_t row = 0;row < rows.size();row++){
+        // Earlier layers win when multiple have the same block, like when checking them in order
+        uint64_t free = 0;
+        for(uint64_t bits = rows[row];bits != 0;){
+            int z = std::countl_zero(bits);
+            bits &= ~(1ULL << (63 - z));
+            if(palette_indexes.get((row << 6) | z) == 0) free |= 1ULL << (63 - z);
+        }
+
+        palette_indexes.setMasked(row, free, layer_index + 1);
+    }
+}
@@ -0,0 +1,108 @@
+#include <game/entity_grid.hpp>
+
+#include <game/entity.hpp>
+
+#include <algorithm>
+
+void EntityGrid::bounds(const Entity& entity, glm::ivec3& cell_min, glm::ivec3& cell_max) {
+    auto& collider = entity.getCollider();
+    glm::vec3 min  = entity.getPosition() + glm::vec3{collider.x, collider.y, collider.z};
+    glm::vec3 max  = min + glm::vec3{collider.width, collider.height, collider.depth};
+
+    cell_min = cellOf(min);
+    cell_max = cellOf(max);
+}
+
+void EntityGrid::link(Entity* entity, size_t order, const glm::ivec3& cell_min, const glm::ivec3& cell_max) {
+    for (int x = cell_min.x; x <= cell_max.x; x++)
+        for (int y = cell_min.y; y <= cell_max.y; y++)
+            for (int z = cell_min.z; z <= cell_max.z; z++)
+                cells[{x, y, z}].emplace_back(order, entity);
+}
+
+void EntityGrid::unlink(Entity* entity, const glm::ivec3& cell_min, const glm::ivec3& cell_max) {
+    for (int x = cell_min.x; x <= cell_max.x; x++) {
+        for (int y = cell_min.y; y <= cell_max.y; y++) {
+            for (int z = cell_min.z; z <= cell_max.z; z++) {
+                auto iterator = cells.find({x, y, z});
+                if (iterator == cells.end())
+                    continue;
+
+                auto& members = iterator->second;
+                auto member   = std::find_if(members.begin(), members.end(), [entity](auto& member) { return member.second == entity; });
+                if (member != members.end()) {
+                    *member = members.back();
+                    members.pop_back();
+                }
+
+                if (members.empty())
+                    cells.erase(iterator);
+            }
+        }
+    }
+}
+
+void EntityGrid::clear() {
+    records.clear();
+    cells.clear();
+    next_order = 0;
+}
+
+void EntityGrid::update(Entity* entity) {
+    glm::ivec3 cell_min, cell_max;
+    bounds(*entity, cell_min, cell_max);
+
+    auto iterator = records.find(entity);
+    if (iterator == records.end()) {
+        records.emplace(entity, Record{next_order, cell_min, cell_max});
+        link(entity, next_order++, cell_min, cell_max);
+        return;
+    }
+
+    auto& record = iterator->second;
+    if (record.cell_min == cell_min && record.cell_max == cell_max)
+        return;
+
+    unlink(entity, record.cell_min, record.cell_max);
+    link(entity, record.order, cell_min, cell_max);
+
+    record.cell_min = cell_min;
+    record.cell_max = cell_max;
+}
+
+void EntityGrid::remove(Entity* entity) {
+    auto iterator = records.find(entity);
+    if (iterator == records.end())
+        return;
+
+    unlink(entity, iterator->second.cell_min, iterator->second.cell_max);
+    records.erase(iterator);
+}
+
+void EntityGrid::query(const glm::vec3& min, const glm::vec3& max, std::vector<Entity*>& output) {
+    output.clear();
+    found.clear();
+
+    glm::ivec3 cell_min = cellOf(min);
+    glm::ivec3 cell_max = cellOf(max);
+
+    for (int x = cell_min.x; x <= cell_max.x; x++) {
+        for (int y = cell_min.y; y <= cell_max.y; y++) {
+            for (int z = cell_min.z; z <= cell_max.z; z++) {
+                auto iterator = cells.find({x, y, z});
+                if (iterator == cells.end())
+                    continue;
+
+                found.insert(found.end(), iterator->second.begin(), iterator->second.end());
+            }
+        }
+    }
+
+    // Entities spanning multiple cells are found multiple times
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    output.reserve(found.size());
+    for (auto& [order, entity] : found)
+        output.push_back(entity);
+}
@@ -4,6 +4,7 @@ GameState::GameState(const std::string& path, int worldSeed) : save_structure(pa
     Entity player = Entity(glm::vec3(0, 30, 0), glm::vec3(0.6, 1.8, 0.6));
     player.addTag("player");
     entities.push_back(player);
+    entity_grid.update(&entities.back());
 
     world_storage = std::make_shared<SegmentStore>();
     world_saver   = std::make_shared<WorldStream>(world_storage);
@@ -71,19 +72,24 @@ void GameState::loadEntities() {
         return;
     }
 
+    std::lock_guard lock(entity_mutex);
+
     entities.clear();
+    entity_grid.clear();
 
     size_t count = count_opt.value();
     for (size_t i = 0; i < count; i++) {
         Entity entity{};
         Serializer::Deserialize<Entity>(entity, array);
         entities.emplace_back(entity);
+        entity_grid.update(&entities.back());
     }
 
     if (entities.size() == 0) { // Player entity cannot be missing
         Entity player = Entity(glm::vec3(0, 30, 0), glm::vec3(0.6, 1.8, 0.6));
         player.addTag("player");
         entities.push_back(player);
+        entity_grid.update(&entities.back());
     }
 }
 
@@ -105,7 +111,20 @@ bool GameState::entityCollision(Entity& checked_entity, const glm::vec3& offset)
         return true;
     }
 
-    for (auto& entity : entities) {
+    std::lock_guard lock(entity_mutex);
+
+    // Only entities in the grid cells around the collider can touch it, they come in the order of the entity list
+    glm::vec3 box_min = position + glm::vec3{checked_collider.x, checked_collider.y, checked_collider.z};
+    glm::vec3 box_max = box_min + glm::vec3{checked_collider.width, checked_collider.height, checked_collider.depth};
+
+    // Taken out while iterating, a collision callback could check collisions again
+    auto candidates = std::move(collision_candidates);
+    entity_grid.query(box_min, box_max, candidates);
+
+    bool collided = false;
+    for (auto* candidate : candidates) {
+        auto& entity = *candidate;
+
         if (entity.shouldGetDestroyed())
             continue;
         if (&entity == &checked_entity)
@@ -123,12 +142,15 @@ bool GameState::entityCollision(Entity& checked_entity, const glm::vec3& offset)
             if (entity.onCollision)
                 entity.onCollision(&entity, &checked_entity);
 
-            if (entity.isSolid())
-                return true;
+            if (entity.isSolid()) {
+                collided = true;
+                break;
+            }
         }
     }
 
-    return false;
+    collision_candidates = std::move(candidates);
+    return collided;
 }
 
 void GameState::loadChunk(const glm::ivec3& position) {
@@ -136,6 +158,10 @@ void GameState::loadChunk(const glm::ivec3& position) {
     if (chunk)
         return;
 
+    // Unloaded but not saved yet
+    if (terrain.reclaimChunk(position))
+        return;
+
     if (world_stream && world_saver->HasChunkAt(position)) {
         terrain.addChunk(position, world_saver->Load(position));
         return;
@@ -143,25 +169,37 @@ void GameState::loadChunk(const glm::ivec3& position) {
 }
 
 void GameState::unloadChunk(const glm::ivec3& position) {
-    auto chunk = terrain.takeChunk(position);
-    if (!chunk)
-        return;
+    terrain.releaseChunk(position);
+
+    // Chunks still in use are saved by a later unload
+    saveReleasedChunks();
+}
 
-    if (world_stream)
-        world_saver->Save(std::move(chunk));
+void GameState::saveReleasedChunks() {
+    for (auto& chunk : terrain.collectReleasedChunks()) {
+        if (world_stream)
+            world_saver->Save(std::move(chunk));
+    }
 }
 
 void GameState::unload() {
-    for (auto it = terrain.chunks.begin(); it != terrain.chunks.end();) {
-        // Extract the node - this removes it from the map
-        auto node = terrain.chunks.extract(it++);
+    terrain.releaseAllChunks();
 
-        if (world_stream)
-            world_saver->Save(std::move(node.mapped()));
+    // Threads still using chunks only have them for a moment
+    saveReleasedChunks();
+    while (terrain.releasedChunksTotal() != 0) {
+        std::this_thread::yield();
+        saveReleasedChunks();
     }
 
+    // Writes the segments and the record store metadata, then flushes the world file to the disk
+    world_saver->Flush();
+
     savePlayer();
     saveEntities();
+
+    player_stream->Flush();
+    entity_stream->Flush();
 }
 
 void GameState::updateEntity(Entity& entity, float deltatime) {
@@ -195,14 +233,23 @@ void GameState::updateEntity(Entity& entity, float deltatime) {
 }
 
 void GameState::updateEntities(float deltatime) {
+    std::lock_guard lock(entity_mutex);
+
+    // Rebuilt in the order of the list, so the grid orders collisions like a pass over the list
+    entity_grid.clear();
+    for (auto& entity : entities)
+        entity_grid.update(&entity);
+
     std::list<Entity>::iterator i = entities.begin();
     while (i != entities.end()) {
         updateEntity(*i, deltatime);
         if (i->shouldGetDestroyed()) {
+            entity_grid.remove(&*i);
             i = entities.erase(i);
             continue;
         }
 
+        entity_grid.update(&*i);
         ++i;
     }
 }
\ No newline at end of file
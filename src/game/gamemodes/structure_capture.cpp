@@ -127,7 +127,7 @@ void GameModeStructureCapture::MouseEvent(int button, int action, int mods) {
                 if (selected_structure) {
                     auto positions = selected_structure->place(cursor_state.blockUnderCursorPosition, state.game_state->GetTerrain());
                     for (auto& position : positions)
-                        state.regenerateChunkMesh(state.game_state->GetTerrain().getChunk(position), {1, 1, 1});
+                        state.regenerateWholeChunkMesh(state.game_state->GetTerrain().getChunk(position));
                 }
             }
         }
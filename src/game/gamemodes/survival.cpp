@@ -230,10 +230,11 @@ void GameModeSurvival::TeleportPlayerTo(const glm::vec2& horizontal_position) {
     auto& game_state = *state.game_state;
 
     auto current_position = glm::ivec3{horizontal_position.x, 0, horizontal_position.y};
+    Terrain::Cursor cursor{game_state.GetTerrain()};
 
     for (int i = 255; i > 0; i--) {
         current_position = glm::ivec3{horizontal_position.x, i, horizontal_position.y};
-        auto* block      = game_state.GetTerrain().getBlock(current_position);
+        auto* block      = cursor.getBlock(current_position);
 
         if (block && block->id != 0)
             break;
@@ -14,6 +14,7 @@ void MainScene::initialize() {
     terrain_manager.createMesh = [this](){
         return std::make_unique<InstancedMesh>();
     };
+    terrain_manager.getMeshGenerator().setUploadBudget(upload_budget_milliseconds);
 
     resetMeshLoader();
 
@@ -368,6 +369,10 @@ void MainScene::render() {
         updateVisibility = 1;
     }
 
+    // Edits made since the last frame are usually meshed by now, give them a moment so they show up in this one
+    if (terrain_manager.getPendingEditCount() > 0)
+        terrain_manager.waitForEdits(edit_wait_budget);
+
     if (terrain_manager.getMeshGenerator().loadMeshFromQueue(mesh_registry, 10))
         updateVisibility = 1;
 
@@ -547,34 +552,38 @@ void MainScene::physicsUpdate() {
 
 
 void MainScene::regenerateChunkMesh(Chunk* chunk) {
-    terrain_manager.getMeshGenerator().syncGenerateSyncUploadMesh(chunk, mesh_registry, terrain_manager.createMesh(), BitField3D::NONE);
-}
+    if (!chunk)
+        return;
 
-#define regenMesh(position)                                                                                                           \
-{                                                                                                                                 \
-    Chunk* temp = game_state->GetTerrain().getChunk(position);                                                                    \
-    if (temp)                                                                                                                     \
-        regenerateChunkMesh(temp);                                                                                                \
+    DirtyPlanes dirty{};
+    dirty.markAll();
+    terrain_manager.remeshEdit(chunk->getWorldPosition(), dirty);
 }
 
 void MainScene::regenerateChunkMesh(Chunk* chunk, glm::vec3 blockCoords) {
-    regenerateChunkMesh(chunk);
-    if (blockCoords.x == 0)
-        regenMesh(chunk->getWorldPosition() - glm::ivec3(1, 0, 0));
-    if (blockCoords.x == CHUNK_SIZE - 1)
-        regenMesh(chunk->getWorldPosition() + glm::ivec3(1, 0, 0));
-
-    if (blockCoords.y == 0)
-        regenMesh(chunk->getWorldPosition() - glm::ivec3(0, 1, 0));
-    if (blockCoords.y == CHUNK_SIZE - 1)
-        regenMesh(chunk->getWorldPosition() + glm::ivec3(0, 1, 0));
-
-    if (blockCoords.z == 0)
-        regenMesh(chunk->getWorldPosition() - glm::ivec3(0, 0, 1));
-    if (blockCoords.z == CHUNK_SIZE - 1)
-        regenMesh(chunk->getWorldPosition() + glm::ivec3(0, 0, 1));
+    glm::ivec3 position = blockCoords;
+
+    // Only the planes around the block change, neighbours only mesh the faces across their -X, -Y and -Z borders
+    DirtyPlanes dirty{};
+    dirty.markBlock(position);
+    terrain_manager.remeshEdit(chunk->getWorldPosition(), dirty);
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (position[axis] != CHUNK_SIZE - 1)
+            continue;
+
+        glm::ivec3 offset(0);
+        offset[axis] = 1;
+
+        glm::ivec3 neighbour = chunk->getWorldPosition() + offset;
+        if (!game_state->GetTerrain().getChunk(neighbour))
+            continue;
+
+        DirtyPlanes border{};
+        border.markBorder(axis);
+        terrain_manager.remeshEdit(neighbour, border);
+    }
 }
-#undef regenMesh
 
 void UILoading::getRenderingInformation(UIRenderBatch& batch) {
     if (!values)
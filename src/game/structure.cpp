@@ -7,7 +7,7 @@ std::tuple<SparseBlockArray*, glm::ivec3> Structure::getBlockArrayForPosition(gl
         position.z < 0 || position.z > static_cast<int>(depth)
     ) return {nullptr,{0,0,0}};
 
-    glm::ivec3 chunk_position = glm::floor(glm::vec3(position) / 64.0f);
+    glm::ivec3 chunk_position = ChunkCoordinates::ToChunk(position);
     //std::cout << chunk_position.x << " " << chunk_position.y << " " << chunk_position.z << std::endl;
     return {&block_arrays[chunk_position], chunk_position};
 }
@@ -25,30 +25,32 @@ Block* Structure::getBlock(glm::ivec3 position){
     static std::shared_mutex mutex;
     std::shared_lock lock(mutex);
 
-    glm::ivec3 chunk_position = glm::floor(glm::vec3(position) / 64.0f);
-    if(!block_arrays.contains(chunk_position)) return nullptr;
+    glm::ivec3 chunk_position = ChunkCoordinates::ToChunk(position);
+    auto block_array = block_arrays.find(chunk_position);
+    if(block_array == block_arrays.end()) return nullptr;
 
-    glm::ivec3 block_position = position - (chunk_position * 64);
-    return block_arrays.at(chunk_position).getBlock(block_position);
+    return block_array->second.getBlock(ChunkCoordinates::ToLocal(position));
 }   
 
 Structure::PositionSet Structure::place(const glm::ivec3& position ,Terrain& world){
     PositionSet visited{};
 
-    for(auto& [chunk_position, block_array]: block_arrays){
-        for(int x = 0;x < 64;x++)
-        for(int y = 0;y < 64;y++)
-        for(int z = 0;z < 64;z++){
-            glm::ivec3 block_position = glm::ivec3{x,y,z} + (chunk_position * 64);
-            
-            Block* block = getBlock(block_position);
-            if(!block || block->id == 0) continue;
+    auto guard = world.pin();
 
-            glm::ivec3 block_world_position = position + block_position; 
-            glm::ivec3 chunk_position = world.blockToChunkPosition(block_world_position);
-            if(!visited.contains(chunk_position)) visited.emplace(chunk_position);
+    for(auto& [array_position, block_array]: block_arrays){
+        // An array spans up to two chunks along each axis, its layers are pasted into every chunk they overlap
+        glm::ivec3 origin = position + array_position * 64;
+        glm::ivec3 first_chunk = world.blockToChunkPosition(origin);
 
-            world.setBlock(block_world_position, *block);
+        for(int x = 0;x < 2;x++)
+        for(int y = 0;y < 2;y++)
+        for(int z = 0;z < 2;z++){
+            glm::ivec3 chunk_position = first_chunk + glm::ivec3{x,y,z};
+
+            Chunk* chunk = world.getChunk(chunk_position);
+            if(!chunk) continue;
+
+            if(chunk->paste(block_array, origin - chunk_position * 64)) visited.emplace(chunk_position);
         }
     }
 
@@ -57,13 +59,14 @@ Structure::PositionSet Structure::place(const glm::ivec3& position ,Terrain& wor
 
 Structure Structure::capture(const glm::ivec3& position, const glm::uvec3& size, const Terrain& world){
     Structure output{size.x,size.y,size.z};
+    Terrain::Cursor cursor{world};
 
     for(uint x = 0;x < size.x ;x++)
     for(uint y = 0;y < size.y;y++)
     for(uint z = 0;z < size.z;z++){
         glm::ivec3 block_position = {x,y,z};
 
-        Block* block = world.getBlock(position + block_position);
+        Block* block = cursor.getBlock(position + block_position);
         if(!block) continue;
         output.setBlock(block_position, *block);
     }
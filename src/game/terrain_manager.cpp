@@ -2,146 +2,314 @@
 #include <game/terrain_manager.hpp>
 #include <thread>
 
+static float ColumnPriority(const glm::ivec2& column_position) {
+    return glm::length(glm::vec2(column_position));
+}
+
 TerrainManager::TerrainManager(std::shared_ptr<Generator> generator) : world_generator(generator) {
     service_manager = std::make_unique<Service>();
 
-    service_manager->AddModule("mesher", [this](std::atomic<bool>& should_stop) {
-        if (!game_state || !game_state->world_saver)
-            return;
+    mesh_generator.setUploadCallback([this](const glm::ivec3& position) { OnMeshUploaded(position); });
 
-        glm::ivec3 around = glm::ivec3{around_x.load(), around_y.load(), around_z.load()};
+    service_manager->AddModule("unloader", [this](std::atomic<bool>& should_stop) {
+        std::unordered_set<glm::ivec2, IVec2Hash, IVec2Equal> wave_copy;
+        {
+            std::lock_guard lock(loaded_column_mutex);
+            wave_copy = loaded_columns;
+        }
 
-        SpiralIndexer meshing_indexer = {};
-        auto& terrain                 = game_state->GetTerrain();
+        glm::ivec2 center_position = {around_x.load(), around_z.load()};
+
+        int distance = render_distance.load();
 
-        size_t max         = pow((render_distance + 1) * 2, 2);
-        int safe_offset = 3;
+        glm::ivec2 min = center_position - distance;
+        glm::ivec2 max = center_position + distance;
 
-        while (generated_count < max) {
+        for (auto& position : wave_copy) {
             if (should_stop)
-                return;
+                break;
+            if (position.x > min.x && position.x < max.x && position.y > min.y && position.y < max.y)
+                continue;
+            
+            UnloadChunkColumn({position.x, position.y});
+
+            {
+                std::lock_guard lock(loaded_column_mutex);
+                loaded_columns.erase(position);
+            }
+        }
+    });
+}
+
+TerrainManager::~TerrainManager() {
+    service_manager->StopAll();
+    StopJobs();
+    StopEdits();
+}
+
+void TerrainManager::StopJobs() {
+    if (current_schedule)
+        current_schedule->cancelled = true;
+
+    jobs.cancel();
+    jobs.wait();
 
-            safe_offset = sqrt(generated_count.load()) * 2;
-            while (meshing_indexer.getTotal() < (((size_t)safe_offset < generated_count) ? (generated_count - safe_offset) : 0)) {
-                glm::ivec2 column_position = meshing_indexer.get();
-                meshing_indexer.next();
+    current_schedule = nullptr;
+}
 
-                for (int i = bottom_y; i < top_y; i++) {
-                    if (should_stop)
-                        return;
+void TerrainManager::StopEdits() {
+    edit_jobs.cancel();
+    edit_jobs.wait();
 
-                    glm::ivec3 chunkPosition = glm::ivec3{column_position.x, i, column_position.y} + around;
+    {
+        std::lock_guard lock(edit_mutex);
+        pending_edits.clear();
+        edits_in_flight = 0;
+    }
+    edits_finished.notify_all();
+}
 
-                    auto* chunk = terrain.getChunk(chunkPosition);
-                    if (!chunk)
-                        continue;
+void TerrainManager::remeshEdit(const glm::ivec3& position, const DirtyPlanes& dirty) {
+    {
+        std::lock_guard lock(edit_mutex);
 
-                    auto level = calculateSimplificationLevel(around, chunkPosition);
-                    
-                    mesh_generator.syncGenerateAsyncUploadMesh(chunk, createMesh(), level);
-                }
+        auto [iterator, inserted] = pending_edits.try_emplace(position, dirty);
+        if (!inserted) {
+            iterator->second.merge(dirty);
+            return;
+        }
+
+        edits_in_flight++;
+    }
+
+    // A single worker runs the edits in order, so two remeshes of the same chunk never overlap
+    edit_jobs.submit(0, [this, position]() {
+        DirtyPlanes dirty{};
+        {
+            std::lock_guard lock(edit_mutex);
+
+            auto iterator = pending_edits.find(position);
+            if (iterator != pending_edits.end()) {
+                dirty = iterator->second;
+                pending_edits.erase(iterator);
             }
+        }
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (game_state) {
+            auto guard  = game_state->GetTerrain().pin();
+            auto* chunk = game_state->GetTerrain().getChunk(position);
+            if (chunk)
+                mesh_generator.syncUpdateAsyncUploadMesh(chunk, createMesh(), dirty);
         }
+
+        {
+            std::lock_guard lock(edit_mutex);
+            if (edits_in_flight > 0)
+                edits_in_flight--;
+        }
+        edits_finished.notify_all();
     });
+}
 
-    service_manager->AddModule("generator", [this](std::atomic<bool>& should_stop) {
-        if (!game_state || !game_state->world_saver)
-            return;
+bool TerrainManager::waitForEdits(std::chrono::microseconds timeout) {
+    std::unique_lock lock(edit_mutex);
+    return edits_finished.wait_for(lock, timeout, [this]() { return edits_in_flight == 0; });
+}
 
-        auto& terrain     = game_state->GetTerrain();
-        auto& world_saver = *game_state->world_saver;
+size_t TerrainManager::getPendingEditCount() {
+    return edits_in_flight;
+}
 
-        SpiralIndexer generation_indexer = {};
+void TerrainManager::ScheduleRegion(const std::shared_ptr<RegionSchedule>& schedule) {
+    SpiralIndexer indexer = {};
 
-        glm::ivec3 around = glm::ivec3{around_x.load(), around_y.load(), around_z.load()};
-        int max           = pow(render_distance * 2, 2);
-        int safe_offset   = render_distance * 2 * 4;
+    size_t meshed_count    = pow(render_distance * 2, 2);
+    size_t generated_count = meshed_count + render_distance * 2 * 4; // One more ring so the outer meshes have neighbours
 
-        while (generation_indexer.getTotal() < static_cast<size_t>(max + safe_offset)) {
-            if (should_stop)
+    std::vector<glm::ivec2> columns{};
+    {
+        std::lock_guard lock(schedule->mutex);
+
+        while (indexer.getTotal() < generated_count) {
+            glm::ivec2 column_position = indexer.get();
+            bool gets_mesh             = indexer.getTotal() < meshed_count;
+            indexer.next();
+
+            for (int i = bottom_y; i < top_y; i++)
+                schedule->chunks[glm::ivec3{column_position.x, i, column_position.y} + schedule->around] = {ChunkStage::Absent, gets_mesh};
+
+            columns.push_back(column_position);
+        }
+    }
+
+    for (auto& column_position : columns) {
+        jobs.submit(ColumnPriority(column_position), [this, schedule, column_position]() {
+            if (schedule->cancelled)
                 return;
 
-            glm::ivec2 column_position = generation_indexer.get();
-            generation_indexer.next();
+            GenerateColumn(*schedule, column_position);
+            OnColumnGenerated(schedule, column_position);
+        });
+    }
+}
 
-            for (int i = bottom_y; i < top_y; i++) {
-                glm::ivec3 chunkPosition = glm::ivec3{column_position.x, i, column_position.y} + around;
+void TerrainManager::GenerateColumn(RegionSchedule& schedule, const glm::ivec2& column_position) {
+    auto& terrain     = game_state->GetTerrain();
+    auto& world_saver = *game_state->world_saver;
 
-                auto* chunk = terrain.getChunk(chunkPosition);
-                auto level  = calculateSimplificationLevel(around, chunkPosition);
-                auto step = calculateGenerationStep(around, chunkPosition);
+    glm::ivec3 around = schedule.around;
 
-                if(chunk && chunk->generated_simplification_step != step && chunk->generated_simplification_step != 1){
-                    terrain.takeChunk(chunkPosition);
-                }
-                else if (chunk) {
-                    chunk->current_simplification = level;
-                    //if(chunk->generated_simplification_step != step) 
-                    //    world_generator->GenerateTerrainChunk(chunk, chunkPosition, step);
+    for (int i = bottom_y; i < top_y; i++) {
+        glm::ivec3 chunkPosition = glm::ivec3{column_position.x, i, column_position.y} + around;
 
-                    continue;
-                }
-
-                if (world_saver.HasChunkAt(chunkPosition)) {
-                    auto loaded = world_saver.Load(chunkPosition);
-                    if(loaded) {
-                        terrain.addChunk(chunkPosition, std::move(loaded));
-                        continue;
-                    }
-                }
-                auto uchunk = std::make_unique<Chunk>();
-                uchunk->current_simplification = level;
-                uchunk->setWorldPosition(chunkPosition);
-
-                world_generator->GenerateTerrainChunk(uchunk.get(), chunkPosition, step);
-                terrain.addChunk(chunkPosition, std::move(uchunk));
-            }
+        auto level = calculateSimplificationLevel(around, chunkPosition);
+        auto step  = calculateGenerationStep(around, chunkPosition);
 
-            {
-                std::lock_guard lock(loaded_column_mutex);
-                loaded_columns.emplace(glm::ivec2{column_position.x + around.x, column_position.y + around.z});
+        // A chunk that was unloaded but not saved yet is newer than the stored one
+        terrain.reclaimChunk(chunkPosition);
+
+        {
+            auto guard  = terrain.pin();
+            auto* chunk = terrain.getChunk(chunkPosition);
+
+            if (chunk && chunk->generated_simplification_step != step && chunk->generated_simplification_step != 1) {
+                terrain.removeChunk(chunkPosition);
+            } else if (chunk) {
+                chunk->current_simplification = level;
+                continue;
             }
-            generated_count++;
         }
-    });
 
-    service_manager->AddModule("unloader", [this](std::atomic<bool>& should_stop) {
-        std::unordered_set<glm::ivec2, IVec2Hash, IVec2Equal> wave_copy;
-        {
-            std::lock_guard lock(loaded_column_mutex);
-            wave_copy = loaded_columns;
+        if (world_saver.HasChunkAt(chunkPosition)) {
+            auto loaded = world_saver.Load(chunkPosition);
+            if (loaded) {
+                terrain.addChunk(chunkPosition, std::move(loaded));
+                continue;
+            }
         }
+        auto uchunk                    = std::make_unique<Chunk>();
+        uchunk->current_simplification = level;
+        uchunk->setWorldPosition(chunkPosition);
 
-        glm::ivec2 center_position = {around_x.load(), around_z.load()};
+        world_generator->GenerateTerrainChunk(uchunk.get(), chunkPosition, step);
+        terrain.addChunk(chunkPosition, std::move(uchunk));
+    }
 
-        int distance = render_distance.load();
+    {
+        std::lock_guard lock(loaded_column_mutex);
+        loaded_columns.emplace(glm::ivec2{column_position.x + around.x, column_position.y + around.z});
+    }
+}
 
-        glm::ivec2 min = center_position - distance;
-        glm::ivec2 max = center_position + distance;
+bool TerrainManager::AreNeighboursReady(RegionSchedule& schedule, const glm::ivec3& position) {
+    for (auto& offset : {glm::ivec3{1, 0, 0}, glm::ivec3{0, 1, 0}, glm::ivec3{0, 0, 1}}) {
+        auto iterator = schedule.chunks.find(position - offset);
+        if (iterator != schedule.chunks.end() && iterator->second.stage == ChunkStage::Absent)
+            return false;
+    }
 
-        for (auto& position : wave_copy) {
-            if (should_stop)
-                break;
-            if (position.x > min.x && position.x < max.x && position.y > min.y && position.y < max.y)
-                continue;
-            
-            UnloadChunkColumn({position.x, position.y});
+    return true;
+}
 
-            {
-                std::lock_guard lock(loaded_column_mutex);
-                loaded_columns.erase(position);
+void TerrainManager::OnColumnGenerated(const std::shared_ptr<RegionSchedule>& schedule, const glm::ivec2& column_position) {
+    std::vector<glm::ivec3> ready{};
+    {
+        std::lock_guard lock(schedule->mutex);
+
+        for (int i = bottom_y; i < top_y; i++) {
+            glm::ivec3 position = glm::ivec3{column_position.x, i, column_position.y} + schedule->around;
+
+            auto& status = schedule->chunks[position];
+            if (status.stage == ChunkStage::Absent)
+                status.stage = ChunkStage::Generated;
+
+            // The chunk itself and the ones that have it as their -X, -Y or -Z neighbour
+            for (auto& offset : {glm::ivec3{0, 0, 0}, glm::ivec3{1, 0, 0}, glm::ivec3{0, 1, 0}, glm::ivec3{0, 0, 1}}) {
+                auto iterator = schedule->chunks.find(position + offset);
+                if (iterator == schedule->chunks.end() || !iterator->second.gets_mesh)
+                    continue;
+
+                // Meshing only starts after the -X, -Y and -Z neighbours are generated, so a started mesh never misses them
+                auto& dependent = iterator->second;
+                if (dependent.stage != ChunkStage::Generated || !AreNeighboursReady(*schedule, position + offset))
+                    continue;
+
+                dependent.stage = ChunkStage::NeighboursReady;
+                ready.push_back(position + offset);
             }
         }
+    }
+
+    for (auto& position : ready)
+        SubmitMeshJob(schedule, position);
+}
+
+void TerrainManager::SubmitMeshJob(const std::shared_ptr<RegionSchedule>& schedule, const glm::ivec3& position) {
+    glm::ivec2 column_position = {position.x - schedule->around.x, position.z - schedule->around.z};
+
+    jobs.submit(ColumnPriority(column_position), [this, schedule, position]() {
+        if (schedule->cancelled)
+            return;
+
+        bool meshed = false;
+        bool found  = false;
+        {
+            // Keeps the chunk and its neighbours alive while meshing, even if they get unloaded meanwhile
+            auto guard  = game_state->GetTerrain().pin();
+            auto* chunk = game_state->GetTerrain().getChunk(position);
+            auto level  = calculateSimplificationLevel(schedule->around, position);
+
+            found  = chunk != nullptr;
+            meshed = chunk && mesh_generator.syncGenerateAsyncUploadMesh(chunk, createMesh(), level);
+        }
+
+        std::lock_guard lock(schedule->mutex);
+        auto& status = schedule->chunks[position];
+
+        // The mesh is already queued, it might have been uploaded before this lock was taken
+        if (!meshed)
+            status.stage = found ? ChunkStage::Generated : ChunkStage::Absent;
+        else if (status.stage == ChunkStage::NeighboursReady)
+            status.stage = ChunkStage::Meshed;
     });
 }
 
+void TerrainManager::OnMeshUploaded(const glm::ivec3& position) {
+    // Runs on the render thread, same as everything that replaces the schedule
+    if (!current_schedule)
+        return;
+
+    std::lock_guard lock(current_schedule->mutex);
+
+    // The meshing job marks the chunk Meshed only after queueing it, so the upload can come first
+    auto iterator = current_schedule->chunks.find(position);
+    if (iterator == current_schedule->chunks.end())
+        return;
+
+    auto& stage = iterator->second.stage;
+    if (stage == ChunkStage::NeighboursReady || stage == ChunkStage::Meshed)
+        stage = ChunkStage::Uploaded;
+}
+
+TerrainManager::ChunkStage TerrainManager::getChunkStage(const glm::ivec3& position) {
+    if (!current_schedule)
+        return ChunkStage::Absent;
+
+    std::lock_guard lock(current_schedule->mutex);
+
+    auto iterator = current_schedule->chunks.find(position);
+    if (iterator == current_schedule->chunks.end())
+        return ChunkStage::Absent;
+
+    return iterator->second.stage;
+}
+
 bool TerrainManager::loadRegion(glm::ivec3 around, int render_distance) {
     if (!game_state || !game_state->world_saver)
         return false;
 
     service_manager->StopAll();
+    StopJobs();
 
     {
         std::lock_guard lock(loaded_column_mutex);
@@ -149,7 +317,6 @@ bool TerrainManager::loadRegion(glm::ivec3 around, int render_distance) {
     }
 
     mesh_generator.clear();
-    generated_count = 0;
 
     around_x              = around.x;
     around_y              = around.y;
@@ -170,6 +337,10 @@ bool TerrainManager::loadRegion(glm::ivec3 around, int render_distance) {
 
         reset_loader();
     }*/
+    current_schedule         = std::make_shared<RegionSchedule>();
+    current_schedule->around = around;
+    ScheduleRegion(current_schedule);
+
     service_manager->StartAll();
 
     return true;
@@ -211,6 +382,8 @@ std::optional<glm::ivec3> TerrainManager::nextUnloadPosition(){
 }
 void TerrainManager::unloadAll() {
     service_manager->StopAll();
+    StopJobs();
+    StopEdits();
     world_generator->Clear();
     
     should_mesh_loader_reset = true;
@@ -41,4 +41,116 @@ void SleepyThread::stop(){
     }
     var.notify_one();
     thread.join();
-}
\ No newline at end of file
+}
+
+JobSystem::JobSystem(size_t worker_count){
+    if(worker_count == 0){
+        size_t cores = std::thread::hardware_concurrency();
+        worker_count = cores > 1 ? cores - 1 : 1; // Leave one core for the render thread
+    }
+
+    // All workers exist before any of them starts looking for work to steal
+    for(size_t i = 0;i < worker_count;i++) workers.push_back(std::make_unique<Worker>());
+    for(size_t i = 0;i < worker_count;i++) workers[i]->thread = std::thread(&JobSystem::run, this, i);
+}
+
+JobSystem::~JobSystem(){
+    cancel();
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+
+    for(auto& worker: workers) worker->thread.join();
+}
+
+int JobSystem::currentWorkerIndex() const {
+    auto id = std::this_thread::get_id();
+    for(size_t i = 0;i < workers.size();i++)
+        if(workers[i]->thread.get_id() == id) return i;
+
+    return -1;
+}
+
+void JobSystem::submit(float priority, const JobFunction& function){
+    int index = currentWorkerIndex();
+    if(index < 0) index = next_worker++ % workers.size();
+
+    auto& worker = *workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.jobs.push_back({priority, next_sequence++, function});
+        std::push_heap(worker.jobs.begin(), worker.jobs.end(), JobOrder{});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex); // So a worker going to sleep cannot miss the notification
+        queued++;
+    }
+    work_available.notify_one();
+}
+
+bool JobSystem::popFrom(Worker& worker, Job& output){
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if(worker.jobs.empty()) return false;
+
+    std::pop_heap(worker.jobs.begin(), worker.jobs.end(), JobOrder{});
+    output = std::move(worker.jobs.back());
+    worker.jobs.pop_back();
+
+    // Counted as running before it stops being queued so wait() never sees both at zero in between
+    running++;
+    queued--;
+    return true;
+}
+
+bool JobSystem::popJob(size_t index, Job& output){
+    if(popFrom(*workers[index], output)) return true;
+
+    // Own queue is empty, go around the others and steal their best job
+    for(size_t i = 1;i < workers.size();i++)
+        if(popFrom(*workers[(index + i) % workers.size()], output)) return true;
+
+    return false;
+}
+
+void JobSystem::run(size_t index){
+    Job job;
+
+    while(true){
+        if(!popJob(index, job)){
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            work_available.wait(lock, [this] { return queued > 0 || stopping; });
+
+            if(stopping) break;
+            continue;
+        }
+
+        job.function();
+        job.function = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            running--;
+        }
+        work_finished.notify_all();
+    }
+}
+
+void JobSystem::cancel(){
+    for(auto& worker: workers){
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        {
+            std::lock_guard<std::mutex> sleep_lock(sleep_mutex);
+            queued -= worker->jobs.size();
+        }
+        worker->jobs.clear();
+    }
+    work_finished.notify_all();
+}
+
+void JobSystem::wait(){
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    work_finished.wait(lock, [this] { return queued == 0 && running == 0; });
+}
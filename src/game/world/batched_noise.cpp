@@ -0,0 +1,348 @@
+#include <game/world/batched_noise.hpp>
+
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCHED_NOISE_X86
+#include <immintrin.h>
+#endif
+
+/*
+    The kernels are FastNoiseLite::GetNoise for 2D OpenSimplex2 written out for vector lanes, every step is the same
+    float operation in the same order so each lane rounds exactly like the scalar code:
+
+        transform: x *= frequency, y *= frequency, t = (x + y) * F2, x += t, y += t
+        simplex:   sum of the three corners of the skewed cell, (a * a) * (a * a) * gradient for each corner
+        fbm:       sum += noise * amp, amp *= lerp(1, min(noise + 1, 2) * 0.5, weighted_strength) * gain, x, y *= lacunarity
+
+    Branches on corner contributions and on the triangle of the cell become masks and blends.
+*/
+static const float SKEW_SQRT3 = (float)1.7320508075688772935274463415059;
+static const float F2         = 0.5f * (SKEW_SQRT3 - 1);
+
+static const float SQRT3 = 1.7320508075688772935274463415059f;
+static const float G2    = (3 - SQRT3) / 6;
+
+static const float LAST_CORNER_T      = (float)(2 * (1 - 2 * G2) * (1 / G2 - 2));
+static const float LAST_CORNER_BASE   = (float)(-2 * (1 - 2 * G2) * (1 - 2 * G2));
+static const float LAST_CORNER_OFFSET = 2 * (float)G2 - 1;
+
+static const float SIMPLEX_SCALE = 99.83685446303647f;
+
+static const int PRIME_X = 501125321;
+static const int PRIME_Y = 1136930381;
+
+static const int HASH_MULTIPLIER = 0x27d4eb2d;
+
+// Same as FastNoiseLite::Lookup<float>::Gradients2D, which is private
+alignas(64) static const float Gradients2D[] = {
+    0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+    0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+    0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+    -0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+    -0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+    -0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+    0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+    0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+    0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+    -0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+    -0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+    -0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+    0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+    0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+    0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+    -0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+    -0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+    -0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+    0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+    0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+    0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+    -0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+    -0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+    -0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+    0.130526192220052f, 0.99144486137381f, 0.38268343236509f, 0.923879532511287f, 0.608761429008721f, 0.793353340291235f, 0.793353340291235f, 0.608761429008721f,
+    0.923879532511287f, 0.38268343236509f, 0.99144486137381f, 0.130526192220051f, 0.99144486137381f, -0.130526192220051f, 0.923879532511287f, -0.38268343236509f,
+    0.793353340291235f, -0.60876142900872f, 0.608761429008721f, -0.793353340291235f, 0.38268343236509f, -0.923879532511287f, 0.130526192220052f, -0.99144486137381f,
+    -0.130526192220052f, -0.99144486137381f, -0.38268343236509f, -0.923879532511287f, -0.608761429008721f, -0.793353340291235f, -0.793353340291235f, -0.608761429008721f,
+    -0.923879532511287f, -0.38268343236509f, -0.99144486137381f, -0.130526192220052f, -0.99144486137381f, 0.130526192220051f, -0.923879532511287f, 0.38268343236509f,
+    -0.793353340291235f, 0.608761429008721f, -0.608761429008721f, 0.793353340291235f, -0.38268343236509f, 0.923879532511287f, -0.130526192220052f, 0.99144486137381f,
+    0.38268343236509f, 0.923879532511287f, 0.923879532511287f, 0.38268343236509f, 0.923879532511287f, -0.38268343236509f, 0.38268343236509f, -0.923879532511287f,
+    -0.38268343236509f, -0.923879532511287f, -0.923879532511287f, -0.38268343236509f, -0.923879532511287f, 0.38268343236509f, -0.38268343236509f, 0.923879532511287f,
+};
+
+static void NoiseKernelScalar(const BatchedNoise& noise, const float* x, const float* y, size_t count, float* output) {
+    for (size_t i = 0; i < count; i++)
+        output[i] = noise.sample(x[i], y[i]);
+}
+
+#ifdef BATCHED_NOISE_X86
+__attribute__((target("sse4.1"))) static inline __m128 GatherSSE41(__m128i indices) {
+    alignas(16) int32_t values[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(values), indices);
+
+    return _mm_setr_ps(Gradients2D[values[0]], Gradients2D[values[1]], Gradients2D[values[2]], Gradients2D[values[3]]);
+}
+
+__attribute__((target("sse4.1"))) static inline __m128 GradientSSE41(__m128i seed, __m128i x_primed, __m128i y_primed, __m128 xd, __m128 yd) {
+    __m128i hash = _mm_mullo_epi32(_mm_xor_si128(_mm_xor_si128(seed, x_primed), y_primed), _mm_set1_epi32(HASH_MULTIPLIER));
+    hash         = _mm_and_si128(_mm_xor_si128(hash, _mm_srai_epi32(hash, 15)), _mm_set1_epi32(127 << 1));
+
+    __m128 xg = GatherSSE41(hash);
+    __m128 yg = GatherSSE41(_mm_or_si128(hash, _mm_set1_epi32(1)));
+
+    return _mm_add_ps(_mm_mul_ps(xd, xg), _mm_mul_ps(yd, yg));
+}
+
+__attribute__((target("sse4.1"))) static inline __m128 SimplexSSE41(__m128i seed, __m128 x, __m128 y) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    // FastFloor truncates and subtracts one from negative values, the comparison mask is -1 for them
+    __m128i i = _mm_add_epi32(_mm_cvttps_epi32(x), _mm_castps_si128(_mm_cmplt_ps(x, zero)));
+    __m128i j = _mm_add_epi32(_mm_cvttps_epi32(y), _mm_castps_si128(_mm_cmplt_ps(y, zero)));
+
+    __m128 xi = _mm_sub_ps(x, _mm_cvtepi32_ps(i));
+    __m128 yi = _mm_sub_ps(y, _mm_cvtepi32_ps(j));
+
+    __m128 t  = _mm_mul_ps(_mm_add_ps(xi, yi), _mm_set1_ps(G2));
+    __m128 x0 = _mm_sub_ps(xi, t);
+    __m128 y0 = _mm_sub_ps(yi, t);
+
+    i = _mm_mullo_epi32(i, _mm_set1_epi32(PRIME_X));
+    j = _mm_mullo_epi32(j, _mm_set1_epi32(PRIME_Y));
+
+    __m128 a  = _mm_sub_ps(_mm_sub_ps(half, _mm_mul_ps(x0, x0)), _mm_mul_ps(y0, y0));
+    __m128 a2 = _mm_mul_ps(a, a);
+    __m128 n0 = _mm_and_ps(_mm_mul_ps(_mm_mul_ps(a2, a2), GradientSSE41(seed, i, j, x0, y0)), _mm_cmpgt_ps(a, zero));
+
+    __m128 c  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(LAST_CORNER_T), t), _mm_add_ps(_mm_set1_ps(LAST_CORNER_BASE), a));
+    __m128 x2 = _mm_add_ps(x0, _mm_set1_ps(LAST_CORNER_OFFSET));
+    __m128 y2 = _mm_add_ps(y0, _mm_set1_ps(LAST_CORNER_OFFSET));
+    __m128 c2 = _mm_mul_ps(c, c);
+    __m128 n2 = _mm_and_ps(
+        _mm_mul_ps(_mm_mul_ps(c2, c2),
+                   GradientSSE41(seed, _mm_add_epi32(i, _mm_set1_epi32(PRIME_X)), _mm_add_epi32(j, _mm_set1_epi32(PRIME_Y)), x2, y2)),
+        _mm_cmpgt_ps(c, zero));
+
+    // The middle corner depends on the triangle of the cell the point is in
+    __m128 upper    = _mm_cmpgt_ps(y0, x0);
+    __m128i upper_i = _mm_castps_si128(upper);
+
+    __m128 x1 = _mm_add_ps(x0, _mm_blendv_ps(_mm_set1_ps((float)G2 - 1), _mm_set1_ps((float)G2), upper));
+    __m128 y1 = _mm_add_ps(y0, _mm_blendv_ps(_mm_set1_ps((float)G2), _mm_set1_ps((float)G2 - 1), upper));
+
+    __m128i i1 = _mm_add_epi32(i, _mm_andnot_si128(upper_i, _mm_set1_epi32(PRIME_X)));
+    __m128i j1 = _mm_add_epi32(j, _mm_and_si128(upper_i, _mm_set1_epi32(PRIME_Y)));
+
+    __m128 b  = _mm_sub_ps(_mm_sub_ps(half, _mm_mul_ps(x1, x1)), _mm_mul_ps(y1, y1));
+    __m128 b2 = _mm_mul_ps(b, b);
+    __m128 n1 = _mm_and_ps(_mm_mul_ps(_mm_mul_ps(b2, b2), GradientSSE41(seed, i1, j1, x1, y1)), _mm_cmpgt_ps(b, zero));
+
+    return _mm_mul_ps(_mm_add_ps(_mm_add_ps(n0, n1), n2), _mm_set1_ps(SIMPLEX_SCALE));
+}
+
+__attribute__((target("sse4.1"))) static void NoiseKernelSSE41(const BatchedNoise& noise, const float* x, const float* y, size_t count, float* output) {
+    const size_t lanes = 4;
+    size_t i           = 0;
+
+    auto& settings = noise.getSettings();
+
+    const __m128 one               = _mm_set1_ps(1.0f);
+    const __m128 two               = _mm_set1_ps(2.0f);
+    const __m128 half              = _mm_set1_ps(0.5f);
+    const __m128 frequency         = _mm_set1_ps(settings.frequency);
+    const __m128 lacunarity        = _mm_set1_ps(settings.lacunarity);
+    const __m128 gain              = _mm_set1_ps(settings.gain);
+    const __m128 weighted_strength = _mm_set1_ps(settings.weighted_strength);
+
+    for (; i + lanes <= count; i += lanes) {
+        __m128 px = _mm_mul_ps(_mm_loadu_ps(x + i), frequency);
+        __m128 py = _mm_mul_ps(_mm_loadu_ps(y + i), frequency);
+
+        __m128 t = _mm_mul_ps(_mm_add_ps(px, py), _mm_set1_ps(F2));
+        px       = _mm_add_ps(px, t);
+        py       = _mm_add_ps(py, t);
+
+        if (!settings.fractal) {
+            _mm_storeu_ps(output + i, SimplexSSE41(_mm_set1_epi32(settings.seed), px, py));
+            continue;
+        }
+
+        __m128 sum = _mm_setzero_ps();
+        __m128 amp = _mm_set1_ps(noise.getFractalBounding());
+
+        for (int octave = 0; octave < settings.octaves; octave++) {
+            __m128 value = SimplexSSE41(_mm_set1_epi32(settings.seed + octave), px, py);
+            sum          = _mm_add_ps(sum, _mm_mul_ps(value, amp));
+
+            __m128 weight = _mm_mul_ps(_mm_min_ps(_mm_add_ps(value, one), two), half);
+            amp           = _mm_mul_ps(amp, _mm_add_ps(one, _mm_mul_ps(weighted_strength, _mm_sub_ps(weight, one))));
+
+            px  = _mm_mul_ps(px, lacunarity);
+            py  = _mm_mul_ps(py, lacunarity);
+            amp = _mm_mul_ps(amp, gain);
+        }
+
+        _mm_storeu_ps(output + i, sum);
+    }
+
+    NoiseKernelScalar(noise, x + i, y + i, count - i, output + i);
+}
+
+__attribute__((target("avx2"))) static inline __m256 GradientAVX2(__m256i seed, __m256i x_primed, __m256i y_primed, __m256 xd, __m256 yd) {
+    __m256i hash = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_xor_si256(seed, x_primed), y_primed), _mm256_set1_epi32(HASH_MULTIPLIER));
+    hash         = _mm256_and_si256(_mm256_xor_si256(hash, _mm256_srai_epi32(hash, 15)), _mm256_set1_epi32(127 << 1));
+
+    __m256 xg = _mm256_i32gather_ps(Gradients2D, hash, 4);
+    __m256 yg = _mm256_i32gather_ps(Gradients2D, _mm256_or_si256(hash, _mm256_set1_epi32(1)), 4);
+
+    return _mm256_add_ps(_mm256_mul_ps(xd, xg), _mm256_mul_ps(yd, yg));
+}
+
+__attribute__((target("avx2"))) static inline __m256 SimplexAVX2(__m256i seed, __m256 x, __m256 y) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+
+    __m256i i = _mm256_add_epi32(_mm256_cvttps_epi32(x), _mm256_castps_si256(_mm256_cmp_ps(x, zero, _CMP_LT_OQ)));
+    __m256i j = _mm256_add_epi32(_mm256_cvttps_epi32(y), _mm256_castps_si256(_mm256_cmp_ps(y, zero, _CMP_LT_OQ)));
+
+    __m256 xi = _mm256_sub_ps(x, _mm256_cvtepi32_ps(i));
+    __m256 yi = _mm256_sub_ps(y, _mm256_cvtepi32_ps(j));
+
+    __m256 t  = _mm256_mul_ps(_mm256_add_ps(xi, yi), _mm256_set1_ps(G2));
+    __m256 x0 = _mm256_sub_ps(xi, t);
+    __m256 y0 = _mm256_sub_ps(yi, t);
+
+    i = _mm256_mullo_epi32(i, _mm256_set1_epi32(PRIME_X));
+    j = _mm256_mullo_epi32(j, _mm256_set1_epi32(PRIME_Y));
+
+    __m256 a  = _mm256_sub_ps(_mm256_sub_ps(half, _mm256_mul_ps(x0, x0)), _mm256_mul_ps(y0, y0));
+    __m256 a2 = _mm256_mul_ps(a, a);
+    __m256 n0 = _mm256_and_ps(_mm256_mul_ps(_mm256_mul_ps(a2, a2), GradientAVX2(seed, i, j, x0, y0)), _mm256_cmp_ps(a, zero, _CMP_GT_OQ));
+
+    __m256 c  = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(LAST_CORNER_T), t), _mm256_add_ps(_mm256_set1_ps(LAST_CORNER_BASE), a));
+    __m256 x2 = _mm256_add_ps(x0, _mm256_set1_ps(LAST_CORNER_OFFSET));
+    __m256 y2 = _mm256_add_ps(y0, _mm256_set1_ps(LAST_CORNER_OFFSET));
+    __m256 c2 = _mm256_mul_ps(c, c);
+    __m256 n2 = _mm256_and_ps(
+        _mm256_mul_ps(
+            _mm256_mul_ps(c2, c2),
+            GradientAVX2(seed, _mm256_add_epi32(i, _mm256_set1_epi32(PRIME_X)), _mm256_add_epi32(j, _mm256_set1_epi32(PRIME_Y)), x2, y2)),
+        _mm256_cmp_ps(c, zero, _CMP_GT_OQ));
+
+    __m256 upper    = _mm256_cmp_ps(y0, x0, _CMP_GT_OQ);
+    __m256i upper_i = _mm256_castps_si256(upper);
+
+    __m256 x1 = _mm256_add_ps(x0, _mm256_blendv_ps(_mm256_set1_ps((float)G2 - 1), _mm256_set1_ps((float)G2), upper));
+    __m256 y1 = _mm256_add_ps(y0, _mm256_blendv_ps(_mm256_set1_ps((float)G2), _mm256_set1_ps((float)G2 - 1), upper));
+
+    __m256i i1 = _mm256_add_epi32(i, _mm256_andnot_si256(upper_i, _mm256_set1_epi32(PRIME_X)));
+    __m256i j1 = _mm256_add_epi32(j, _mm256_and_si256(upper_i, _mm256_set1_epi32(PRIME_Y)));
+
+    __m256 b  = _mm256_sub_ps(_mm256_sub_ps(half, _mm256_mul_ps(x1, x1)), _mm256_mul_ps(y1, y1));
+    __m256 b2 = _mm256_mul_ps(b, b);
+    __m256 n1 = _mm256_and_ps(_mm256_mul_ps(_mm256_mul_ps(b2, b2), GradientAVX2(seed, i1, j1, x1, y1)), _mm256_cmp_ps(b, zero, _CMP_GT_OQ));
+
+    return _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(n0, n1), n2), _mm256_set1_ps(SIMPLEX_SCALE));
+}
+
+__attribute__((target("avx2"))) static void NoiseKernelAVX2(const BatchedNoise& noise, const float* x, const float* y, size_t count, float* output) {
+    const size_t lanes = 8;
+    size_t i           = 0;
+
+    auto& settings = noise.getSettings();
+
+    const __m256 one               = _mm256_set1_ps(1.0f);
+    const __m256 two               = _mm256_set1_ps(2.0f);
+    const __m256 half              = _mm256_set1_ps(0.5f);
+    const __m256 frequency         = _mm256_set1_ps(settings.frequency);
+    const __m256 lacunarity        = _mm256_set1_ps(settings.lacunarity);
+    const __m256 gain              = _mm256_set1_ps(settings.gain);
+    const __m256 weighted_strength = _mm256_set1_ps(settings.weighted_strength);
+
+    for (; i + lanes <= count; i += lanes) {
+        __m256 px = _mm256_mul_ps(_mm256_loadu_ps(x + i), frequency);
+        __m256 py = _mm256_mul_ps(_mm256_loadu_ps(y + i), frequency);
+
+        __m256 t = _mm256_mul_ps(_mm256_add_ps(px, py), _mm256_set1_ps(F2));
+        px       = _mm256_add_ps(px, t);
+        py       = _mm256_add_ps(py, t);
+
+        if (!settings.fractal) {
+            _mm256_storeu_ps(output + i, SimplexAVX2(_mm256_set1_epi32(settings.seed), px, py));
+            continue;
+        }
+
+        __m256 sum = _mm256_setzero_ps();
+        __m256 amp = _mm256_set1_ps(noise.getFractalBounding());
+
+        for (int octave = 0; octave < settings.octaves; octave++) {
+            __m256 value = SimplexAVX2(_mm256_set1_epi32(settings.seed + octave), px, py);
+            sum          = _mm256_add_ps(sum, _mm256_mul_ps(value, amp));
+
+            __m256 weight = _mm256_mul_ps(_mm256_min_ps(_mm256_add_ps(value, one), two), half);
+            amp           = _mm256_mul_ps(amp, _mm256_add_ps(one, _mm256_mul_ps(weighted_strength, _mm256_sub_ps(weight, one))));
+
+            px  = _mm256_mul_ps(px, lacunarity);
+            py  = _mm256_mul_ps(py, lacunarity);
+            amp = _mm256_mul_ps(amp, gain);
+        }
+
+        _mm256_storeu_ps(output + i, sum);
+    }
+
+    NoiseKernelScalar(noise, x + i, y + i, count - i, output + i);
+}
+#endif
+
+struct SelectedNoiseKernel {
+    BatchedNoise::Kernel kernel;
+    const char* name;
+};
+
+static const SelectedNoiseKernel& GetSelectedKernel() {
+    static const SelectedNoiseKernel selected = []() -> SelectedNoiseKernel {
+#ifdef BATCHED_NOISE_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+            return {NoiseKernelAVX2, "AVX2"};
+        if (__builtin_cpu_supports("sse4.1"))
+            return {NoiseKernelSSE41, "SSE4.1"};
+#endif
+        return {NoiseKernelScalar, "scalar"};
+    }();
+
+    return selected;
+}
+
+const char* BatchedNoise::KernelName() {
+    return GetSelectedKernel().name;
+}
+
+void BatchedNoise::configure(const NoiseSettings& settings) {
+    this->settings = settings;
+
+    reference.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+    reference.SetSeed(settings.seed);
+    reference.SetFrequency(settings.frequency);
+    reference.SetFractalType(settings.fractal ? FastNoiseLite::FractalType_FBm : FastNoiseLite::FractalType_None);
+    reference.SetFractalOctaves(settings.octaves);
+    reference.SetFractalLacunarity(settings.lacunarity);
+    reference.SetFractalGain(settings.gain);
+    reference.SetFractalWeightedStrength(settings.weighted_strength);
+
+    // Same as FastNoiseLite::CalculateFractalBounding
+    float gain        = settings.gain < 0 ? -settings.gain : settings.gain;
+    float amp         = gain;
+    float amp_fractal = 1.0f;
+    for (int i = 1; i < settings.octaves; i++) {
+        amp_fractal += amp;
+        amp *= gain;
+    }
+    fractal_bounding = 1 / amp_fractal;
+}
+
+void BatchedNoise::sample(const float* x, const float* y, size_t count, float* output) const {
+    GetSelectedKernel().kernel(*this, x, y, count, output);
+}
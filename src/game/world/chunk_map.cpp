@@ -0,0 +1,216 @@
+#include <game/world/chunk_map.hpp>
+
+#include <vec_hash.hpp>
+
+ChunkMap::~ChunkMap() {
+    for (auto& shard : shards) {
+        Table* table = shard.table.load();
+        if (!table)
+            continue;
+
+        for (auto& entry : table->entries)
+            delete entry.chunk;
+        delete table;
+    }
+}
+
+size_t ChunkMap::hash(const glm::ivec3& position) {
+    // IVec3Hash barely mixes the coordinates, the shard is picked from the high bits so they have to be mixed in
+    uint64_t value = IVec3Hash{}(position);
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+ChunkMap::Table* ChunkMap::rebuild(const Table* table, const glm::ivec3& position, Chunk* chunk) {
+    size_t needed   = (table ? table->count : 0) + 1;
+    size_t capacity = 8;
+    while (capacity < needed * 2)
+        capacity <<= 1;
+
+    auto* result = new Table();
+    result->entries.resize(capacity);
+
+    auto place = [&](const glm::ivec3& entry_position, Chunk* entry_chunk) {
+        size_t slot = hash(entry_position) & (capacity - 1);
+        while (result->entries[slot].chunk)
+            slot = (slot + 1) & (capacity - 1);
+
+        result->entries[slot] = {entry_position, entry_chunk};
+        result->count++;
+    };
+
+    if (table) {
+        for (auto& entry : table->entries) {
+            if (entry.chunk && entry.position != position)
+                place(entry.position, entry.chunk);
+        }
+    }
+
+    if (chunk)
+        place(position, chunk);
+
+    return result;
+}
+
+Chunk* ChunkMap::find(const glm::ivec3& position) const {
+    size_t position_hash = hash(position);
+
+    const Table* table = shards[position_hash >> (64 - shard_bits)].table.load(std::memory_order_acquire);
+    if (!table)
+        return nullptr;
+
+    size_t mask = table->entries.size() - 1;
+    for (size_t slot = position_hash & mask;; slot = (slot + 1) & mask) {
+        auto& entry = table->entries[slot];
+        if (!entry.chunk)
+            return nullptr;
+
+        if (entry.position == position)
+            return entry.chunk;
+    }
+}
+
+Chunk* ChunkMap::link(const glm::ivec3& position, Chunk* chunk) {
+    auto& shard = shardFor(hash(position));
+    std::lock_guard lock(shard.mutex);
+
+    if (Chunk* existing = find(position))
+        return existing;
+
+    // Set before the chunk is published, readers check it without a lock
+    chunk->generation = next_generation++;
+
+    Table* old_table = shard.table.load();
+    Table* new_table = rebuild(old_table, position, chunk);
+
+    shard.table.store(new_table, std::memory_order_release);
+    count++;
+
+    if (old_table)
+        epochs.Retire(old_table);
+
+    return chunk;
+}
+
+Chunk* ChunkMap::insert(const glm::ivec3& position, std::unique_ptr<Chunk> chunk) {
+    Chunk* result = link(position, chunk.get());
+    if (result == chunk.get())
+        chunk.release();
+
+    return result;
+}
+
+Chunk* ChunkMap::unlink(const glm::ivec3& position) {
+    auto& shard = shardFor(hash(position));
+    std::lock_guard lock(shard.mutex);
+
+    Chunk* chunk = find(position);
+    if (!chunk)
+        return nullptr;
+
+    Table* old_table = shard.table.load();
+    shard.table.store(rebuild(old_table, position, nullptr), std::memory_order_release);
+    count--;
+
+    epochs.Retire(old_table);
+    return chunk;
+}
+
+void ChunkMap::retireReleased(const glm::ivec3& position, Chunk* chunk) {
+    uint64_t generation = chunk->generation;
+    {
+        std::lock_guard lock(released_mutex);
+        released.emplace(position, Released{std::unique_ptr<Chunk>(chunk)});
+    }
+
+    // A reclaimed chunk gets a new generation, it isnt marked by what was retired before
+    epochs.Retire([this, position, generation]() {
+        std::lock_guard lock(released_mutex);
+
+        auto [begin, end] = released.equal_range(position);
+        for (auto it = begin; it != end; it++) {
+            if (it->second.chunk->generation == generation)
+                it->second.readers_gone = true;
+        }
+    });
+}
+
+void ChunkMap::release(const glm::ivec3& position) {
+    Chunk* chunk = unlink(position);
+    if (chunk)
+        retireReleased(position, chunk);
+}
+
+void ChunkMap::releaseAll() {
+    for (auto& shard : shards) {
+        std::lock_guard lock(shard.mutex);
+
+        Table* table = shard.table.exchange(nullptr);
+        if (!table)
+            continue;
+
+        for (auto& entry : table->entries) {
+            if (entry.chunk)
+                retireReleased(entry.position, entry.chunk);
+        }
+        count -= table->count;
+
+        epochs.Retire(table);
+    }
+}
+
+std::vector<std::unique_ptr<Chunk>> ChunkMap::collectReleased() {
+    epochs.Collect();
+
+    std::vector<std::unique_ptr<Chunk>> result{};
+
+    std::lock_guard lock(released_mutex);
+    for (auto it = released.begin(); it != released.end();) {
+        if (!it->second.readers_gone) {
+            it++;
+            continue;
+        }
+
+        result.push_back(std::move(it->second.chunk));
+        it = released.erase(it);
+    }
+
+    return result;
+}
+
+Chunk* ChunkMap::reclaim(const glm::ivec3& position) {
+    std::unique_ptr<Chunk> chunk = nullptr;
+    {
+        std::lock_guard lock(released_mutex);
+
+        auto it = released.find(position);
+        if (it == released.end())
+            return nullptr;
+
+        chunk = std::move(it->second.chunk);
+        released.erase(it);
+    }
+
+    Chunk* result = link(position, chunk.get());
+    if (result == chunk.get())
+        return chunk.release();
+
+    // Another chunk was added at the position meanwhile, readers might still use this one
+    retireReleased(position, chunk.release());
+    return result;
+}
+
+size_t ChunkMap::releasedCount() {
+    std::lock_guard lock(released_mutex);
+    return released.size();
+}
+
+void ChunkMap::erase(const glm::ivec3& position) {
+    Chunk* chunk = unlink(position);
+    if (chunk)
+        epochs.Retire(chunk);
+}
@@ -0,0 +1,156 @@
+#include <game/world/face_masks.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FACE_MASKS_X86
+#include <immintrin.h>
+#endif
+
+/*
+    Every kernel does the same thing as ProcessFaceRowValues, just for 'count' rows at once:
+
+        forward[i], backward[i] = ProcessFaceRowValues(solid[i], solid[i + next], field[i], field[i + next])
+
+    The rows are consecutive in memory so they can be loaded straight into vector registers.
+*/
+static void FaceMaskKernelScalar(const uint64_t* solid,
+                                 const uint64_t* field,
+                                 size_t next,
+                                 size_t count,
+                                 uint64_t* forward,
+                                 uint64_t* backward,
+                                 bool transparent) {
+    if (transparent) {
+        for (size_t i = 0; i < count; i++) {
+            uint64_t faces = (field[i] ^ field[i + next]) & ~(solid[i] | solid[i + next]);
+            forward[i]     = field[i] & faces;
+            backward[i]    = field[i + next] & faces;
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t possible = solid[i] ^ solid[i + next];
+        forward[i]        = field[i] & possible;
+        backward[i]       = field[i + next] & possible;
+    }
+}
+
+#ifdef FACE_MASKS_X86
+__attribute__((target("sse2"))) static void FaceMaskKernelSSE2(const uint64_t* solid,
+                                                                const uint64_t* field,
+                                                                size_t next,
+                                                                size_t count,
+                                                                uint64_t* forward,
+                                                                uint64_t* backward,
+                                                                bool transparent) {
+    const size_t lanes = 2;
+    size_t i           = 0;
+
+    for (; i + lanes <= count; i += lanes) {
+        __m128i solid_forward  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(solid + i));
+        __m128i solid_backward = _mm_loadu_si128(reinterpret_cast<const __m128i*>(solid + i + next));
+        __m128i field_forward  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(field + i));
+        __m128i field_backward = _mm_loadu_si128(reinterpret_cast<const __m128i*>(field + i + next));
+
+        __m128i faces = transparent ? _mm_andnot_si128(_mm_or_si128(solid_forward, solid_backward),
+                                                       _mm_xor_si128(field_forward, field_backward))
+                                    : _mm_xor_si128(solid_forward, solid_backward);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(forward + i), _mm_and_si128(field_forward, faces));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(backward + i), _mm_and_si128(field_backward, faces));
+    }
+
+    FaceMaskKernelScalar(solid + i, field + i, next, count - i, forward + i, backward + i, transparent);
+}
+
+__attribute__((target("avx2"))) static void FaceMaskKernelAVX2(const uint64_t* solid,
+                                                                const uint64_t* field,
+                                                                size_t next,
+                                                                size_t count,
+                                                                uint64_t* forward,
+                                                                uint64_t* backward,
+                                                                bool transparent) {
+    const size_t lanes = 4;
+    size_t i           = 0;
+
+    for (; i + lanes <= count; i += lanes) {
+        __m256i solid_forward  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(solid + i));
+        __m256i solid_backward = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(solid + i + next));
+        __m256i field_forward  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(field + i));
+        __m256i field_backward = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(field + i + next));
+
+        __m256i faces = transparent ? _mm256_andnot_si256(_mm256_or_si256(solid_forward, solid_backward),
+                                                          _mm256_xor_si256(field_forward, field_backward))
+                                    : _mm256_xor_si256(solid_forward, solid_backward);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(forward + i), _mm256_and_si256(field_forward, faces));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(backward + i), _mm256_and_si256(field_backward, faces));
+    }
+
+    FaceMaskKernelScalar(solid + i, field + i, next, count - i, forward + i, backward + i, transparent);
+}
+#endif
+
+struct SelectedFaceMaskKernel {
+    FaceMaskBuffer::Kernel kernel;
+    const char* name;
+};
+
+static const SelectedFaceMaskKernel& GetSelectedKernel() {
+    static const SelectedFaceMaskKernel selected = []() -> SelectedFaceMaskKernel {
+#ifdef FACE_MASKS_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+            return {FaceMaskKernelAVX2, "AVX2"};
+        if (__builtin_cpu_supports("sse2"))
+            return {FaceMaskKernelSSE2, "SSE2"};
+#endif
+        return {FaceMaskKernelScalar, "scalar"};
+    }();
+
+    return selected;
+}
+
+const char* FaceMaskBuffer::KernelName() {
+    return GetSelectedKernel().name;
+}
+
+void FaceMaskBuffer::compute(const BitFieldSnapshot& solid, const BitFieldSnapshot& field, bool transparent) {
+    auto kernel = GetSelectedKernel().kernel;
+
+    /*
+        X layers are neighbours in memory (x + y * 64), Y layers are a whole row of 64 apart
+        and Z layers are neighbours in the transposed version.
+
+        The last row has no next layer so its skipped, masks that wrap into the next row are never read.
+    */
+    kernel(solid.rows(), field.rows(), 1, 64 * 64 - 1, masks[X_FORWARD].data(), masks[X_BACKWARD].data(), transparent);
+    kernel(solid.rows(), field.rows(), 64, 64 * 64 - 64, masks[Y_FORWARD].data(), masks[Y_BACKWARD].data(), transparent);
+    kernel(solid.transposedRows(),
+           field.transposedRows(),
+           1,
+           64 * 64 - 1,
+           masks[Z_FORWARD].data(),
+           masks[Z_BACKWARD].data(),
+           transparent);
+}
+
+bool FaceMaskBuffer::getPlane(Plane plane, int layer, BitPlane<64>& output) const {
+    auto& source = masks[plane];
+
+    uint64_t any = 0;
+    if (plane == Y_FORWARD || plane == Y_BACKWARD) {
+        for (int row = 0; row < 64; row++) {
+            output[row] = source[row + layer * 64];
+            any |= output[row];
+        }
+    } else {
+        for (int row = 0; row < 64; row++) {
+            output[row] = source[layer + row * 64];
+            any |= output[row];
+        }
+    }
+
+    return any != 0;
+}
@@ -1,38 +1,82 @@
 
+#include <chrono>
 #include <cstdint>
+#include <span>
 #include <game/world/mesh_generation.hpp>
 
 void ChunkMeshGenerator::clear() {
     std::lock_guard<std::mutex> lock(meshLoadingMutex);
     meshLoadingQueue = {};
+    editLoadingQueue = {};
+    edit_versions.clear();
 }
-void ChunkMeshGenerator::addToChunkMeshLoadingQueue(glm::ivec3 position, std::unique_ptr<MeshInterface> mesh) {
+void ChunkMeshGenerator::addToChunkMeshLoadingQueue(glm::ivec3 position, std::unique_ptr<MeshInterface> mesh, size_t edit_version) {
     std::lock_guard<std::mutex> lock(meshLoadingMutex);
-    meshLoadingQueue.push({position, std::move(mesh)});
+    meshLoadingQueue.push({position, std::move(mesh), edit_version});
+}
+void ChunkMeshGenerator::addToEditMeshLoadingQueue(glm::ivec3 position, std::unique_ptr<MeshInterface> mesh) {
+    std::lock_guard<std::mutex> lock(meshLoadingMutex);
+    editLoadingQueue.push({position, std::move(mesh), ++edit_versions[position]});
+}
+size_t ChunkMeshGenerator::getEditVersion(const glm::ivec3& position) {
+    std::lock_guard<std::mutex> lock(meshLoadingMutex);
+
+    auto iterator = edit_versions.find(position);
+    return iterator != edit_versions.end() ? iterator->second : 0;
 }
 bool ChunkMeshGenerator::loadMeshFromQueue(RegionCuller& buffer, size_t limit) {
+    frame_stats        = {};
+    frame_stats.meshed = meshed_since_frame.exchange(0);
+
     if (!meshes_pending)
         return false;
 
+    auto start = std::chrono::steady_clock::now();
+
     std::lock_guard<std::mutex> lock(meshLoadingMutex);
 
-    if (meshLoadingQueue.empty()) {
-        meshes_pending = false;
-        return false;
-    }
+    while (frame_stats.uploaded < limit) {
+        bool edit   = !editLoadingQueue.empty();
+        auto& queue = edit ? editLoadingQueue : meshLoadingQueue;
+        if (queue.empty())
+            break;
 
-    for (size_t i = 0; i < std::min(limit, meshLoadingQueue.size()); i++) {
-        auto& [position, mesh] = meshLoadingQueue.front();
+        auto& [position, mesh, edit_version] = queue.front();
 
-        if (buffer.addMesh(mesh.get(), position)) {
-            meshLoadingQueue.pop();
+        // An edit was queued after this mesh started generating, the edit mesh is newer and was already uploaded
+        if (!edit) {
+            auto iterator = edit_versions.find(position);
+            if (iterator != edit_versions.end() && iterator->second != edit_version) {
+                queue.pop();
+                frame_stats.dropped++;
+                continue;
+            }
         }
+
+        if (!buffer.addMesh(mesh.get(), position))
+            break;
+
+        if (upload_callback)
+            upload_callback(position);
+
+        queue.pop();
+
+        frame_stats.uploaded++;
+        if (edit)
+            frame_stats.uploaded_edits++;
+
+        frame_stats.upload_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (frame_stats.upload_milliseconds >= upload_budget_milliseconds)
+            break;
     }
 
-    if (meshLoadingQueue.empty())
+    frame_stats.queued_edits = editLoadingQueue.size();
+    frame_stats.queued       = meshLoadingQueue.size() + editLoadingQueue.size();
+
+    if (frame_stats.queued == 0)
         meshes_pending = false;
 
-    return true;
+    return frame_stats.uploaded > 0;
 }
 
 bool ChunkMeshGenerator::syncGenerateAsyncUploadMesh(Chunk* chunk,
@@ -41,12 +85,14 @@ bool ChunkMeshGenerator::syncGenerateAsyncUploadMesh(Chunk* chunk,
     //auto start = std::chrono::high_resolution_clock::now();
 
     auto world_position = chunk->getWorldPosition();
+    auto edit_version   = getEditVersion(world_position);
     bool result         = generateChunkMesh(world_position, mesh.get(), chunk, simplification_level);
 
     if (!result)
         return false;
 
-    addToChunkMeshLoadingQueue(world_position, std::move(mesh));
+    addToChunkMeshLoadingQueue(world_position, std::move(mesh), edit_version);
+    meshed_since_frame++;
     meshes_pending = true;
 
     return true;
@@ -66,10 +112,73 @@ bool ChunkMeshGenerator::syncGenerateSyncUploadMesh(Chunk* chunk,
     return true;
 }
 
+std::unique_ptr<ChunkMeshSegments> ChunkMeshGenerator::takeSegments(Chunk* chunk) {
+    std::lock_guard<std::mutex> lock(edited_segments_mutex);
+
+    for (auto it = edited_segments.begin(); it != edited_segments.end(); it++) {
+        if ((*it)->position != chunk->getWorldPosition())
+            continue;
+
+        auto segments = std::move(*it);
+        edited_segments.erase(it);
+
+        // A chunk that was replaced at the position could have been allocated at the same address, the generation differs
+        if (segments->generation != chunk->getGeneration() || segments->simplification_level != BitField3D::NONE)
+            return nullptr;
+        return segments;
+    }
+
+    return nullptr;
+}
+
+void ChunkMeshGenerator::storeSegments(std::unique_ptr<ChunkMeshSegments> segments) {
+    std::lock_guard<std::mutex> lock(edited_segments_mutex);
+
+    edited_segments.push_front(std::move(segments));
+    if (edited_segments.size() > max_edited_segments)
+        edited_segments.pop_back();
+}
+
+void ChunkMeshGenerator::dropSegments(const glm::ivec3& position) {
+    std::lock_guard<std::mutex> lock(edited_segments_mutex);
+
+    edited_segments.remove_if([&](const std::unique_ptr<ChunkMeshSegments>& segments) { return segments->position == position; });
+}
+
+bool ChunkMeshGenerator::syncUpdateAsyncUploadMesh(Chunk* chunk, std::unique_ptr<MeshInterface> mesh, const DirtyPlanes& dirty) {
+    auto world_position = chunk->getWorldPosition();
+    auto segments       = takeSegments(chunk);
+
+    bool result = false;
+    if (segments)
+        result = generateChunkMesh(world_position, nullptr, chunk, BitField3D::NONE, segments.get(), &dirty);
+    else {
+        segments           = std::make_unique<ChunkMeshSegments>();
+        segments->generation = chunk->getGeneration();
+        segments->position   = world_position;
+
+        result = generateChunkMesh(world_position, nullptr, chunk, BitField3D::NONE, segments.get(), nullptr);
+    }
+
+    if (!result)
+        return false;
+
+    segments->replay(mesh.get());
+    mesh->shrink();
+
+    storeSegments(std::move(segments));
+
+    addToEditMeshLoadingQueue(world_position, std::move(mesh));
+    meshed_since_frame++;
+    meshes_pending = true;
+
+    return true;
+}
+
 /*
     Generate greedy meshed faces from a plane of bits
 */
-std::vector<ChunkMeshGenerator::Face>& ChunkMeshGenerator::greedyMeshPlane(BitPlane<64> rows, int start_row, int end_row) {
+std::vector<ChunkMeshGenerator::Face>& ChunkMeshGenerator::greedyMeshPlane(BitPlane<64>& rows) {
     const int size = 64;
 
     static ThreadLocal<std::vector<ChunkMeshGenerator::Face>> greedy_mesh_plane_threadlocal{};
@@ -91,9 +200,9 @@ std::vector<ChunkMeshGenerator::Face>& ChunkMeshGenerator::greedyMeshPlane(BitPl
     }
     */
 
-    int currentRow = start_row;
+    int currentRow = 0;
 
-    while (currentRow < end_row) {
+    while (currentRow < size) {
         uint64_t row = rows[currentRow];
         /*
             0b00001101
@@ -134,7 +243,7 @@ std::vector<ChunkMeshGenerator::Face>& ChunkMeshGenerator::greedyMeshPlane(BitPl
         mask &= row;
 
         int height = 0;
-        while (currentRow + height < end_row && (mask & rows[currentRow + height]) == mask) {
+        while (currentRow + height < size && (mask & rows[currentRow + height]) == mask) {
             rows[currentRow + height] &= ~mask; // Remove this face part from the rows
             height++;
         }
@@ -151,71 +260,35 @@ std::vector<ChunkMeshGenerator::Face>& ChunkMeshGenerator::greedyMeshPlane(BitPl
     return greedy_mesh_plane_out;
 }
 
-std::tuple<ChunkMeshGenerator::OccludedPlane, bool, ChunkMeshGenerator::OccludedPlane, bool> ChunkMeshGenerator::segregatePlane(
-    OccludedPlane& source_plane, OcclusionPlane& occlusion_plane, std::array<bool, 4> affects, glm::ivec2 lookup_offset) {
-    OccludedPlane true_plane  = {source_plane.occlusion};
-    OccludedPlane false_plane = {source_plane.occlusion};
-
-    true_plane.occlusion[0] += affects[0];
-    true_plane.occlusion[1] += affects[1];
-    true_plane.occlusion[2] += affects[2];
-    true_plane.occlusion[3] += affects[3];
-
-    bool true_plane_empty  = true;
-    bool false_plane_empty = true;
-
-    for (int i = source_plane.start; i < source_plane.end; i++) {
-        if (source_plane.plane[i] == 0)
-            continue;
-
-        int lookup_y = (i + lookup_offset.y) + 1; // occlusion plane is offset relative to source plane so +1
-
-        uint64_t occlusion_row = occlusion_plane.rows[lookup_y];
-
-        // occlusion_row =
-        //     (lookup_offset.x > 0) ?
-        //         (occlusion_row <<  lookup_offset.x):
-        //         (occlusion_row >> -lookup_offset.x);
-
-        if (lookup_offset.x > 0) {
-            occlusion_row <<= lookup_offset.x;
-
-            if (lookup_y == 0)
-                occlusion_row |= occlusion_plane.top_right_corner;
-            else if (lookup_y == 65)
-                occlusion_row |= occlusion_plane.bottom_right_corner;
-            else
-                occlusion_row |= ((occlusion_plane.right >> (lookup_y - 1)) & 1ULL);
-        } else {
-            occlusion_row >>= -lookup_offset.x;
-
-            if (lookup_y == 0)
-                occlusion_row |= occlusion_plane.top_left_corner;
-            else if (lookup_y == 65)
-                occlusion_row |= occlusion_plane.bottom_left_corner;
-            else
-                occlusion_row |= ((occlusion_plane.left >> (lookup_y - 1)) & 1ULL);
-        }
-
-        true_plane.plane[i]  = source_plane.plane[i] & occlusion_row;
-        false_plane.plane[i] = source_plane.plane[i] & ~occlusion_row;
-
-        if (true_plane.plane[i] != 0ULL) {
-            true_plane.end   = i + 1;
-            true_plane_empty = false;
-        }
-        if (false_plane.plane[i] != 0ULL) {
-            false_plane.end   = i + 1;
-            false_plane_empty = false;
-        }
-
-        if (true_plane_empty)
-            true_plane.start = i;
-        if (false_plane_empty)
-            false_plane.start = i;
+/*
+    Returns the row of the occlusion plane that affects the source plane row at the offset
+*/
+static inline uint64_t getOcclusionRow(const ChunkMeshGenerator::OcclusionPlane& occlusion_plane, int row, glm::ivec2 lookup_offset) {
+    int lookup_y = (row + lookup_offset.y) + 1; // occlusion plane is offset relative to source plane so +1
+
+    uint64_t occlusion_row = occlusion_plane.rows[lookup_y];
+
+    if (lookup_offset.x > 0) {
+        occlusion_row <<= lookup_offset.x;
+
+        if (lookup_y == 0)
+            occlusion_row |= occlusion_plane.top_right_corner;
+        else if (lookup_y == 65)
+            occlusion_row |= occlusion_plane.bottom_right_corner;
+        else
+            occlusion_row |= ((occlusion_plane.right >> (lookup_y - 1)) & 1ULL);
+    } else {
+        occlusion_row >>= -lookup_offset.x;
+
+        if (lookup_y == 0)
+            occlusion_row |= occlusion_plane.top_left_corner;
+        else if (lookup_y == 65)
+            occlusion_row |= occlusion_plane.bottom_left_corner;
+        else
+            occlusion_row |= ((occlusion_plane.left >> (lookup_y - 1)) & 1ULL);
     }
 
-    return {true_plane, true_plane_empty, false_plane, false_plane_empty};
+    return occlusion_row;
 }
 
 struct OcclusionOffset {
@@ -234,36 +307,198 @@ const static std::array<OcclusionOffset, 8> occlusion_offsets = {
     OcclusionOffset{{1, -1}, {0, 1, 0, 0}},
     OcclusionOffset{{-1, -1}, {1, 0, 0, 0}}};
 
-std::vector<ChunkMeshGenerator::OccludedPlane>& ChunkMeshGenerator::calculatePlaneAmbientOcclusion(BitPlane<64>& source_plane,
-                                                                                                   OcclusionPlane& occlusion_plane) {
+// For every offset all the keys that have its bit set
+const static std::array<std::bitset<256>, 8> keys_with_offset = []() {
+    std::array<std::bitset<256>, 8> output{};
+    for (int key = 0; key < 256; key++)
+        for (int offset = 0; offset < 8; offset++)
+            if (key & (1 << offset))
+                output[offset].set(key);
+    return output;
+}();
+
+static inline std::array<float, 4> getKeyOcclusion(uint8_t key) {
+    std::array<float, 4> occlusion = {0, 0, 0, 0};
+
+    for (int offset = 0; offset < 8; offset++) {
+        if (!(key & (1 << offset)))
+            continue;
 
-    static ThreadLocal<std::vector<ChunkMeshGenerator::OccludedPlane>> occluded_planes_threadlocal{};
+        auto& affects = occlusion_offsets[offset].affects;
+        occlusion[0] += affects[0];
+        occlusion[1] += affects[1];
+        occlusion[2] += affects[2];
+        occlusion[3] += affects[3];
+    }
 
-    auto& occluded_planes_out = occluded_planes_threadlocal.Get();
-    occluded_planes_out.clear();
-    occluded_planes_out.push_back({{0, 0, 0, 0}, source_plane});
+    return occlusion;
+}
 
-    for (auto& [offset, affects] : occlusion_offsets) {
-        for (auto& plane : occluded_planes_out) {
-            auto [plane_1, plane_1_empty, plane_2, plane_2_empty] = segregatePlane(plane, occlusion_plane, affects, offset);
+ChunkMeshGenerator::OcclusionFaces& ChunkMeshGenerator::calculatePlaneAmbientOcclusion(BitPlane<64>& source_plane,
+                                                                                       OcclusionPlane& occlusion_plane) {
+    struct KeyedFace {
+        Face face;
+        uint8_t key;
+    };
+    static ThreadLocal<OcclusionFaces> occlusion_faces_threadlocal{};
+    static ThreadLocal<std::vector<KeyedFace>> swept_faces_threadlocal{};
+
+    auto& occlusion_faces = occlusion_faces_threadlocal.Get();
+    occlusion_faces.present.reset();
+    occlusion_faces.order_count = 0;
+
+    auto& swept_faces = swept_faces_threadlocal.Get();
+    swept_faces.clear();
+
+    struct RowPart {
+        uint8_t key;
+        uint64_t bits;
+    };
+    std::array<RowPart, 64> parts; // A row cannot be split into more parts than it has bits
+
+    // Faces that reached the previous row, they all cover it so their columns never overlap
+    struct OpenFace {
+        uint64_t mask;
+        uint32_t index;
+        uint8_t key;
+    };
+    std::array<OpenFace, 64> open;
+    size_t open_count = 0;
+
+    std::array<uint64_t, 256> row_bits{}; // Bits of the current row by key, only the keys of its parts are set
+
+    for (int row = 0; row < 64; row++) {
+        size_t part_count = 0;
+
+        if (source_plane[row] != 0) {
+            /*
+                Split the row by every offset, bits affected by the offset get its bit in the key.
+                Only parts that actually have bits are kept, usually a row ends up in just a few of them.
+            */
+            part_count = 1;
+            parts[0]   = {0, source_plane[row]};
+
+            for (int offset = 0; offset < 8; offset++) {
+                uint64_t occlusion_row = getOcclusionRow(occlusion_plane, row, occlusion_offsets[offset].offset);
+                size_t count           = part_count;
+
+                for (size_t i = 0; i < count; i++) {
+                    uint64_t affected   = parts[i].bits & occlusion_row;
+                    uint64_t unaffected = parts[i].bits & ~occlusion_row;
+
+                    if (affected == 0)
+                        continue;
+
+                    if (unaffected != 0)
+                        parts[part_count++] = {parts[i].key, unaffected};
+
+                    parts[i] = {static_cast<uint8_t>(parts[i].key | (1 << offset)), affected};
+                }
+            }
 
-            if (plane_1_empty) {
-                plane = plane_2;
+            for (size_t i = 0; i < part_count; i++) {
+                row_bits[parts[i].key] = parts[i].bits;
+                occlusion_faces.present.set(parts[i].key);
+            }
+        }
+
+        /*
+            A face only grows while all of its columns have its key. Faces that started higher up take their bits first,
+            same as greedy meshing the plane of the key would, and since they don't overlap the order between them doesn't matter.
+        */
+        size_t kept = 0;
+        for (size_t i = 0; i < open_count; i++) {
+            auto& face = open[i];
+            if ((row_bits[face.key] & face.mask) != face.mask)
                 continue;
+
+            row_bits[face.key] &= ~face.mask;
+            swept_faces[face.index].face.height++;
+            open[kept++] = face;
+        }
+        open_count = kept;
+
+        // What is left of the row starts new faces, left to right within every key
+        for (size_t i = 0; i < part_count; i++) {
+            uint8_t key   = parts[i].key;
+            uint64_t bits = row_bits[key];
+            row_bits[key] = 0;
+
+            while (bits != 0) {
+                int start = count_leading_zeros(bits);
+                int width = std::countl_one(bits << start);
+
+                uint64_t mask = ~0ULL >> start;
+                if ((start + width) != 64)
+                    mask &= ~(~0ULL >> (start + width));
+                bits &= ~mask;
+
+                open[open_count++] = {mask, static_cast<uint32_t>(swept_faces.size()), key};
+                swept_faces.push_back({{start, row, width, 1}, key});
             }
+        }
+    }
 
-            plane = plane_1;
+    if (swept_faces.empty())
+        return occlusion_faces;
 
-            if (plane_2_empty)
+    /*
+        Faces used to be generated by splitting the whole plane by each offset in turn, keeping the affected half in place
+        and appending the unaffected half at the end. Doing the same with just the sets of keys gives the same order
+        without touching any rows.
+    */
+    struct KeyGroup {
+        uint8_t key;
+        std::bitset<256> keys;
+    };
+    std::array<KeyGroup, 256> groups;
+    size_t group_count = 1;
+    groups[0]          = {0, occlusion_faces.present};
+
+    for (int offset = 0; offset < 8; offset++) {
+        size_t count = group_count;
+
+        for (size_t i = 0; i < count; i++) {
+            auto affected   = groups[i].keys & keys_with_offset[offset];
+            auto unaffected = groups[i].keys & ~keys_with_offset[offset];
+
+            if (affected.none())
                 continue;
-            occluded_planes_out.push_back(plane_2);
+
+            if (unaffected.any())
+                groups[group_count++] = {groups[i].key, unaffected};
+
+            groups[i] = {static_cast<uint8_t>(groups[i].key | (1 << offset)), affected};
         }
     }
 
-    return occluded_planes_out;
+    for (size_t i = 0; i < group_count; i++)
+        occlusion_faces.order[occlusion_faces.order_count++] = groups[i].key;
+
+    // Group the faces by key, within a key they stay in the order they were started in which is the order greedy meshing finds them
+    auto& count = occlusion_faces.count;
+    auto& first = occlusion_faces.first;
+
+    for (size_t i = 0; i < occlusion_faces.order_count; i++)
+        count[occlusion_faces.order[i]] = 0;
+    for (auto& swept : swept_faces)
+        count[swept.key]++;
+
+    uint32_t offset = 0;
+    for (size_t i = 0; i < occlusion_faces.order_count; i++) {
+        first[occlusion_faces.order[i]] = offset;
+        offset += count[occlusion_faces.order[i]];
+    }
+
+    std::array<uint32_t, 256> next = first;
+    occlusion_faces.faces.resize(swept_faces.size());
+    for (auto& swept : swept_faces)
+        occlusion_faces.faces[next[swept.key]++] = swept.face;
+
+    return occlusion_faces;
 }
 
-static inline void processFaces(const std::vector<ChunkMeshGenerator::Face>& faces,
+static inline void processFaces(std::span<const ChunkMeshGenerator::Face> faces,
                                 MeshInterface::FaceType face_type,
                                 MeshInterface::Direction direction,
                                 BlockRegistry::BlockPrototype* type,
@@ -271,42 +506,59 @@ static inline void processFaces(const std::vector<ChunkMeshGenerator::Face>& fac
                                 glm::vec3 world_position,
                                 int layer,
                                 std::array<float, 4>& occlusion) {
-    glm::ivec3 face_position;
+    static ThreadLocal<std::vector<MeshInterface::QuadFace>> quad_faces_threadlocal{};
+
+    if (faces.empty())
+        return;
+
     int texture = 0;
 
     bool texture_index = direction == MeshInterface::Backward;
 
-    mesh->preallocate(faces.size(), face_type);
-    for (auto& face : faces) {
-        int faceWidth  = face.width;
-        int faceHeight = face.height;
+    switch (face_type) {
+    case MeshInterface::X_ALIGNED:
+        texture = type->single_texture ? type->textures[0] : type->textures[4 + texture_index];
+        break;
+    case MeshInterface::Y_ALIGNED:
+        texture = type->single_texture ? type->textures[0] : type->textures[texture_index];
+        break;
+    case MeshInterface::Z_ALIGNED:
+        texture = type->single_texture ? type->textures[0] : type->textures[2 + texture_index];
+        break;
+    case MeshInterface::BILLBOARD:
+        break;
+    }
+
+    auto& quad_faces = quad_faces_threadlocal.Get();
+    quad_faces.resize(faces.size());
 
-        switch (face_type) {
-        case MeshInterface::X_ALIGNED:
-            face_position = glm::vec3(layer + 1, face.y + face.height, face.x);
+    for (size_t i = 0; i < faces.size(); i++) {
+        auto& face = faces[i];
+        auto& quad = quad_faces[i];
 
-            texture = type->single_texture ? type->textures[0] : type->textures[4 + texture_index];
+        quad.width  = face.width;
+        quad.height = face.height;
 
+        switch (face_type) {
+        case MeshInterface::X_ALIGNED:
+            quad.position = glm::ivec3(layer + 1, face.y + face.height, face.x);
             break;
         case MeshInterface::Y_ALIGNED:
-            face_position = glm::vec3(face.y, layer + 1, face.x);
-
-            faceWidth  = face.height;
-            faceHeight = face.width;
+            quad.position = glm::ivec3(face.y, layer + 1, face.x);
 
-            texture = type->single_texture ? type->textures[0] : type->textures[texture_index];
+            quad.width  = face.height;
+            quad.height = face.width;
             break;
         case MeshInterface::Z_ALIGNED:
-            face_position = glm::vec3(face.x, face.y + face.height, layer + 1);
-
-            texture = type->single_texture ? type->textures[0] : type->textures[2 + texture_index];
+            quad.position = glm::ivec3(face.x, face.y + face.height, layer + 1);
             break;
         case MeshInterface::BILLBOARD:
+            quad.position = glm::ivec3(0);
             break;
         }
-
-        mesh->addQuadFace(face_position, faceWidth, faceHeight, texture, face_type, direction, occlusion, world_position);
     }
+
+    mesh->emitFaces(quad_faces, texture, face_type, direction, occlusion, world_position);
 }
 
 void ChunkMeshGenerator::proccessOccludedFaces(BitPlane<64>& source_plane,
@@ -317,39 +569,22 @@ void ChunkMeshGenerator::proccessOccludedFaces(BitPlane<64>& source_plane,
                                                MeshInterface* mesh,
                                                glm::vec3 world_position,
                                                int layer) {
-    auto& processed_planes = calculatePlaneAmbientOcclusion(source_plane, occlusion_plane);
+    auto& occlusion_faces = calculatePlaneAmbientOcclusion(source_plane, occlusion_plane);
+    std::span<const Face> faces{occlusion_faces.faces};
 
-    for (auto& plane : processed_planes) {
-        processFaces(greedyMeshPlane(plane.plane, plane.start, plane.end),
+    for (size_t i = 0; i < occlusion_faces.order_count; i++) {
+        uint8_t key    = occlusion_faces.order[i];
+        auto occlusion = getKeyOcclusion(key);
+
+        processFaces(faces.subspan(occlusion_faces.first[key], occlusion_faces.count[key]),
                      face_type,
                      direction,
                      type,
                      mesh,
                      world_position,
                      layer,
-                     plane.occlusion);
-    }
-}
-
-std::tuple<uint64_t, uint64_t> ProcessFaceRowValues(
-    uint64_t solid_forward, uint64_t solid_backward, uint64_t field_forward, uint64_t field_backward, bool transparent) {
-
-    if (transparent) {
-        uint64_t allFacesX = (field_forward ^ field_backward) & ~(solid_forward | solid_backward);
-        return {field_forward & allFacesX, field_backward & allFacesX};
+                     occlusion);
     }
-    uint64_t possible_mask = solid_forward ^ solid_backward;
-
-    return std::tuple<uint64_t, uint64_t>{field_forward & possible_mask, field_backward & possible_mask};
-}
-
-std::tuple<uint64_t, uint64_t> ProcessFaceRow(int layer,
-                                              int row,
-                                              const std::function<uint64_t(int layer, int row)>& solid_getter,
-                                              const std::function<uint64_t(int layer, int row)>& field_getter,
-                                              bool transparent) {
-    return ProcessFaceRowValues(
-        solid_getter(layer, row), solid_getter(layer + 1, row), field_getter(layer, row), field_getter(layer + 1, row), transparent);
 }
 
 #define AGREGATE_TYPES(axis)                                                                                                          \
@@ -360,6 +595,17 @@ bool ChunkMeshGenerator::generateChunkMesh(const glm::ivec3& worldPosition,
                                            MeshInterface* solidMesh,
                                            Chunk* chunk,
                                            BitField3D::SimplificationLevel simplification_level) {
+    dropSegments(worldPosition); // The chunk might have changed without an edit
+
+    return generateChunkMesh(worldPosition, solidMesh, chunk, simplification_level, nullptr, nullptr);
+}
+
+bool ChunkMeshGenerator::generateChunkMesh(const glm::ivec3& worldPosition,
+                                           MeshInterface* output,
+                                           Chunk* chunk,
+                                           BitField3D::SimplificationLevel simplification_level,
+                                           ChunkMeshSegments* segments,
+                                           const DirtyPlanes* dirty) {
     if (!chunk) {
         LogError("Missing chunk when generating mesh.");
         return false;
@@ -378,27 +624,38 @@ bool ChunkMeshGenerator::generateChunkMesh(const glm::ivec3& worldPosition,
     glm::vec3 world_position = worldPosition * CHUNK_SIZE;
     int size                 = CHUNK_SIZE;
 
+    // When meshing into segments every plane is recorded separately and only the dirty ones are meshed again
+    MeshInterface* solidMesh = segments ? segments : output;
+
+    std::vector<ChunkMeshSegments::OrderEntry> layer_order{};
+    std::vector<BlockID> border_order{};
+
     // Occlusion planes have to reach into other chunks
     std::array<OcclusionPlane, 64> occlusionPlanesX{};
     std::array<OcclusionPlane, 64> occlusionPlanesY{};
     std::array<OcclusionPlane, 64> occlusionPlanesZ{};
 
-    { // Scope becuse transposed field doesnt neccesairly remain valid when new
-        // ones are created
-        auto& solidField   = *chunk->getSolidField().getSimplifiedWithNone(simplification_level);
-        auto* solidRotated = solidField.getTransposed();
-        // 64 planes internal 65th external
-
-        auto slock  = solidField.Guard().Shared();
-        auto srlock = solidRotated->Guard().Shared();
-
-        for (int x = 0; x < 64; x++)
-            for (int y = 0; y < 64; y++) {
-                occlusionPlanesX[x].rows[y + 1] = solidField.getRow(x, y);
-                occlusionPlanesY[y].rows[x + 1] = solidField.getRow(x, y);
-                occlusionPlanesZ[x].rows[y + 1] = solidRotated->getRow(x, y);
-            }
-    }
+    /*
+        Frozen copies of the fields, taken once under their guards so the loops below read them without any locking
+        and dont depend on the transposed cache staying valid
+    */
+    static ThreadLocal<BitFieldSnapshot> solid_snapshot_threadlocal{};
+    static ThreadLocal<BitFieldSnapshot> field_snapshot_threadlocal{};
+    static ThreadLocal<FaceMaskBuffer> face_masks_threadlocal{};
+
+    auto& solid_snapshot = solid_snapshot_threadlocal.Get();
+    auto& field_snapshot = field_snapshot_threadlocal.Get();
+    auto& face_masks     = face_masks_threadlocal.Get();
+
+    solid_snapshot.capture(*chunk->getSolidField().getSimplifiedWithNone(simplification_level));
+
+    // 64 planes internal 65th external
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 64; y++) {
+            occlusionPlanesX[x].rows[y + 1] = solid_snapshot.getRow(x, y);
+            occlusionPlanesY[y].rows[x + 1] = solid_snapshot.getRow(x, y);
+            occlusionPlanesZ[x].rows[y + 1] = solid_snapshot.getTransposedRow(x, y);
+        }
     // timer.timestamp("Generated occlusion planes");
 
     // std::cout << "Scale: " << scale << " size: " << size << std::endl;
@@ -406,14 +663,16 @@ bool ChunkMeshGenerator::generateChunkMesh(const glm::ivec3& worldPosition,
         Mesh chunk faces
     */
 
-    BitPlane planeXforward  = {};
-    BitPlane planeXbackward = {};
+    std::array<BitPlane<64>, 6> planes{};
 
-    BitPlane planeYforward  = {};
-    BitPlane planeYbackward = {};
+    auto& planeXforward  = planes[0];
+    auto& planeXbackward = planes[1];
 
-    BitPlane planeZforward  = {};
-    BitPlane planeZbackward = {};
+    auto& planeYforward  = planes[2];
+    auto& planeYbackward = planes[3];
+
+    auto& planeZforward  = planes[4];
+    auto& planeZbackward = planes[5];
 
     /**
      * @brief Generate faces for each block type
@@ -423,27 +682,25 @@ bool ChunkMeshGenerator::generateChunkMesh(const glm::ivec3& worldPosition,
     for (auto& field_layer : chunk->getLayers()) {
         auto& [type, block, _field] = field_layer;
 
-        auto& field        = *field_layer.field().getSimplifiedWithNone(simplification_level);
-        auto* rotatedField = field.getTransposed();
-
-        auto& solidField   = *chunk->getSolidField().getSimplifiedWithNone(simplification_level);
-        auto* solidRotated = solidField.getTransposed();
-
-        auto l1 = field.Guard().Shared();
-        auto l2 = rotatedField->Guard().Shared();
-        auto l3 = solidField.Guard().Shared();
-        auto l4 = solidRotated->Guard().Shared();
-
         auto* definition = BlockRegistry::get().getPrototype(type);
         if (!definition || definition->render_type != BlockRegistry::FULL_BLOCK) {
 
             if (!definition || definition->render_type != BlockRegistry::BILLBOARD || simplification_level != BitField3D::NONE)
                 continue;
 
+            if (segments) {
+                segments->selectBillboards(type);
+                layer_order.push_back({type, true});
+            }
+
+            field_snapshot.capture(field_layer.field());
+
             for (int x = 0; x < size; x++)
-                for (int y = 0; y < size; y++)
+                for (int y = 0; y < size; y++) {
+                    uint64_t row = field_snapshot.getRow(x, y);
+
                     for (int z = 0; z < size; z++) {
-                        if (!field.get(x, y, z))
+                        if (!(row & (1ULL << (63 - z))))
                             continue;
 
                         glm::vec3 position = glm::vec3{x, y, z};
@@ -451,92 +708,95 @@ bool ChunkMeshGenerator::generateChunkMesh(const glm::ivec3& worldPosition,
                         solidMesh->addQuadFace(
                             position, 1, 1, definition->textures[0], MeshInterface::BILLBOARD, MeshInterface::Forward, {0, 0, 0, 0}, world_position);
                     }
+                }
 
             continue;
         }
 
+        if (segments)
+            layer_order.push_back({type, false});
+
+        field_snapshot.capture(*field_layer.field().getSimplifiedWithNone(simplification_level));
+        face_masks.compute(solid_snapshot, field_snapshot, definition->transparent);
+
         /**
-         * @brief For each layer create planes from every row for potential faces then mesh them
+         * @brief For each layer take the planes of potential faces calculated for the whole field and mesh them
          * 
          */
         for (int layer = 0; layer < size - 1; layer++) {
-            for (int row = 0; row < size; row++) {
-                std::tie(planeXforward[row], planeXbackward[row]) = ProcessFaceRow(
-                    layer,
-                    row,
-                    [&solidField](int layer, int row) { return solidField.getRow(layer, row); },
-                    [&field](int layer, int row) { return field.getRow(layer, row); },
-                    definition->transparent);
-
-                std::tie(planeYforward[row], planeYbackward[row]) = ProcessFaceRow(
-                    layer,
-                    row,
-                    [&solidField](int layer, int row) { return solidField.getRow(row, layer); },
-                    [&field](int layer, int row) { return field.getRow(row, layer); },
-                    definition->transparent);
-
-                std::tie(planeZforward[row], planeZbackward[row]) = ProcessFaceRow(
-                    layer,
-                    row,
-                    [solidRotated](int layer, int row) { return solidRotated->getRow(layer, row); },
-                    [rotatedField](int layer, int row) { return rotatedField->getRow(layer, row); },
-                    definition->transparent);
-            }
-
             // std::cout << "Solving plane: " << getBlockTypeName(type) <<
             // std::endl; for(int j = 0;j < 64;j++) std::cout <<
             // std::bitset<64>(planes[i][j]) << std::endl;
 
-            proccessOccludedFaces(planeXforward,
-                                  occlusionPlanesX[layer + 1],
-                                  MeshInterface::X_ALIGNED,
-                                  MeshInterface::Forward,
-                                  definition,
-                                  solidMesh,
-                                  world_position,
-                                  layer);
-            proccessOccludedFaces(planeXbackward,
-                                  occlusionPlanesX[layer],
-                                  MeshInterface::X_ALIGNED,
-                                  MeshInterface::Backward,
-                                  definition,
-                                  solidMesh,
-                                  world_position,
-                                  layer);
-
-            proccessOccludedFaces(planeYforward,
-                                  occlusionPlanesY[layer + 1],
-                                  MeshInterface::Y_ALIGNED,
-                                  MeshInterface::Forward,
-                                  definition,
-                                  solidMesh,
-                                  world_position,
-                                  layer);
-            proccessOccludedFaces(planeYbackward,
-                                  occlusionPlanesY[layer],
-                                  MeshInterface::Y_ALIGNED,
-                                  MeshInterface::Backward,
-                                  definition,
-                                  solidMesh,
-                                  world_position,
-                                  layer);
-
-            proccessOccludedFaces(planeZforward,
-                                  occlusionPlanesZ[layer + 1],
-                                  MeshInterface::Z_ALIGNED,
-                                  MeshInterface::Forward,
-                                  definition,
-                                  solidMesh,
-                                  world_position,
-                                  layer);
-            proccessOccludedFaces(planeZbackward,
-                                  occlusionPlanesZ[layer],
-                                  MeshInterface::Z_ALIGNED,
-                                  MeshInterface::Backward,
-                                  definition,
-                                  solidMesh,
-                                  world_position,
-                                  layer);
+            if (!dirty || dirty->isDirty(0, layer)) {
+                if (segments)
+                    segments->selectPlane(type, 0, layer);
+
+                if (face_masks.getPlane(FaceMaskBuffer::X_FORWARD, layer, planeXforward))
+                    proccessOccludedFaces(planeXforward,
+                                          occlusionPlanesX[layer + 1],
+                                          MeshInterface::X_ALIGNED,
+                                          MeshInterface::Forward,
+                                          definition,
+                                          solidMesh,
+                                          world_position,
+                                          layer);
+                if (face_masks.getPlane(FaceMaskBuffer::X_BACKWARD, layer, planeXbackward))
+                    proccessOccludedFaces(planeXbackward,
+                                          occlusionPlanesX[layer],
+                                          MeshInterface::X_ALIGNED,
+                                          MeshInterface::Backward,
+                                          definition,
+                                          solidMesh,
+                                          world_position,
+                                          layer);
+            }
+            if (!dirty || dirty->isDirty(1, layer)) {
+                if (segments)
+                    segments->selectPlane(type, 1, layer);
+
+                if (face_masks.getPlane(FaceMaskBuffer::Y_FORWARD, layer, planeYforward))
+                    proccessOccludedFaces(planeYforward,
+                                          occlusionPlanesY[layer + 1],
+                                          MeshInterface::Y_ALIGNED,
+                                          MeshInterface::Forward,
+                                          definition,
+                                          solidMesh,
+                                          world_position,
+                                          layer);
+                if (face_masks.getPlane(FaceMaskBuffer::Y_BACKWARD, layer, planeYbackward))
+                    proccessOccludedFaces(planeYbackward,
+                                          occlusionPlanesY[layer],
+                                          MeshInterface::Y_ALIGNED,
+                                          MeshInterface::Backward,
+                                          definition,
+                                          solidMesh,
+                                          world_position,
+                                          layer);
+            }
+            if (!dirty || dirty->isDirty(2, layer)) {
+                if (segments)
+                    segments->selectPlane(type, 2, layer);
+
+                if (face_masks.getPlane(FaceMaskBuffer::Z_FORWARD, layer, planeZforward))
+                    proccessOccludedFaces(planeZforward,
+                                          occlusionPlanesZ[layer + 1],
+                                          MeshInterface::Z_ALIGNED,
+                                          MeshInterface::Forward,
+                                          definition,
+                                          solidMesh,
+                                          world_position,
+                                          layer);
+                if (face_masks.getPlane(FaceMaskBuffer::Z_BACKWARD, layer, planeZbackward))
+                    proccessOccludedFaces(planeZbackward,
+                                          occlusionPlanesZ[layer],
+                                          MeshInterface::Z_ALIGNED,
+                                          MeshInterface::Backward,
+                                          definition,
+                                          solidMesh,
+                                          world_position,
+                                          layer);
+            }
         }
     }
 
@@ -553,6 +813,10 @@ bool ChunkMeshGenerator::generateChunkMesh(const glm::ivec3& worldPosition,
 
     if (!nextX || !nextY || !nextZ) {
         // LogError("Mesh generating when chunks are missing?");
+        if (segments) {
+            segments->clearBorder();
+            segments->setOrder(std::move(layer_order), {}, world_position);
+        }
         return true;
     }
 
@@ -567,12 +831,20 @@ bool ChunkMeshGenerator::generateChunkMesh(const glm::ivec3& worldPosition,
     fullAgregate.insert(agregateTypesY.begin(), agregateTypesY.end());
     fullAgregate.insert(agregateTypesZ.begin(), agregateTypesZ.end());
 
-    auto& solidField       = *chunk->getSolidField().getSimplifiedWithNone(simplification_level);
-    BitField3D& nextXSolid = *nextX->getSolidField().getSimplifiedWithNone(nextX->current_simplification);
-    BitField3D& nextYSolid = *nextY->getSolidField().getSimplifiedWithNone(nextY->current_simplification);
+    /*
+        The neighbours are read through per thread copies of their border planes, like the snapshots above
+    */
+    static ThreadLocal<BitFieldBorder> next_solid_border_threadlocal{};
+    static ThreadLocal<BitFieldBorder> local_layer_border_threadlocal{};
+    static ThreadLocal<BitFieldBorder> next_layer_border_threadlocal{};
+
+    auto& next_solid_border  = next_solid_border_threadlocal.Get();
+    auto& local_layer_border = local_layer_border_threadlocal.Get();
+    auto& next_layer_border  = next_layer_border_threadlocal.Get();
 
-    auto* solidRotated      = solidField.getTransposed();
-    auto* nextZSolidRotated = nextZ->getSolidField().getSimplifiedWithNone(nextZ->current_simplification)->getTransposed();
+    next_solid_border.captureX(*nextX->getSolidField().getSimplifiedWithNone(nextX->current_simplification), size - 1);
+    next_solid_border.captureY(*nextY->getSolidField().getSimplifiedWithNone(nextY->current_simplification), size - 1);
+    next_solid_border.captureZ(*nextZ->getSolidField().getSimplifiedWithNone(nextZ->current_simplification), size - 1);
 
     /**
      * @brief Mesh three of the neighbouring layers, same logic just across chunks
@@ -584,96 +856,115 @@ bool ChunkMeshGenerator::generateChunkMesh(const glm::ivec3& worldPosition,
         if (!definition || definition->render_type != BlockRegistry::FULL_BLOCK)
             continue;
 
-        auto* layer_field = chunk->getLayer(type).field().getSimplifiedWithNone(simplification_level);
+        if (segments)
+            border_order.push_back(type);
+
+        // Only read the layer, getLayer would create an empty one while neighbouring chunks are being meshed from other threads
+        local_layer_border.clear();
+        if (chunk->hasLayerOfType(type)) {
+            auto& field = *chunk->getLayer(type).field().getSimplifiedWithNone(simplification_level);
+            local_layer_border.captureX(field, 0);
+            local_layer_border.captureY(field, 0);
+            local_layer_border.captureZ(field, 0);
+        }
+
+        next_layer_border.clear();
+        if (nextX->hasLayerOfType(type))
+            next_layer_border.captureX(*nextX->getLayer(type).field().getSimplifiedWithNone(nextX->current_simplification), size - 1);
+        if (nextY->hasLayerOfType(type))
+            next_layer_border.captureY(*nextY->getLayer(type).field().getSimplifiedWithNone(nextY->current_simplification), size - 1);
+        if (nextZ->hasLayerOfType(type))
+            next_layer_border.captureZ(*nextZ->getLayer(type).field().getSimplifiedWithNone(nextZ->current_simplification), size - 1);
 
         for (int row = 0; row < size; row++) {
-            const uint64_t localMaskRowX = chunk->hasLayerOfType(type) ? layer_field->getRow(0, row) : 0ULL;
-            const uint64_t otherMaskRowX =
-                nextX->hasLayerOfType(type)
-                    ? nextX->getLayer(type).field().getSimplifiedWithNone(nextX->current_simplification)->getRow(size - 1, row)
-                    : 0ULL;
-
-            const uint64_t localMaskRowY = chunk->hasLayerOfType(type) ? layer_field->getRow(row, 0) : 0ULL;
-            const uint64_t otherMaskRowY =
-                nextY->hasLayerOfType(type)
-                    ? nextY->getLayer(type).field().getSimplifiedWithNone(nextY->current_simplification)->getRow(row, size - 1)
-                    : 0ULL;
-
-            uint64_t localMaskRowZ = chunk->hasLayerOfType(type) ? layer_field->getTransposed()->getRow(0, row) : 0ULL;
-            uint64_t otherMaskRowZ = nextZ->hasLayerOfType(type) ? nextZ->getLayer(type)
-                                                                       .field()
-                                                                       .getSimplifiedWithNone(nextZ->current_simplification)
-                                                                       ->getTransposed()
-                                                                       ->getRow(size - 1, row)
-                                                                 : 0ULL;
-            ;
-
-            std::tie(planeXforward[row], planeXbackward[row]) = ProcessFaceRowValues(
-                solidField.getRow(0, row), nextXSolid.getRow(63, row), localMaskRowX, otherMaskRowX, definition->transparent);
-
-            std::tie(planeYforward[row], planeYbackward[row]) = ProcessFaceRowValues(
-                solidField.getRow(row, 0), nextYSolid.getRow(row, 63), localMaskRowY, otherMaskRowY, definition->transparent);
-
-            std::tie(planeZforward[row], planeZbackward[row]) = ProcessFaceRowValues(solidRotated->getRow(0, row),
-                                                                                     nextZSolidRotated->getRow(63, row),
-                                                                                     localMaskRowZ,
-                                                                                     otherMaskRowZ,
+            std::tie(planeXforward[row], planeXbackward[row]) = ProcessFaceRowValues(solid_snapshot.getRow(0, row),
+                                                                                     next_solid_border.getXRow(row),
+                                                                                     local_layer_border.getXRow(row),
+                                                                                     next_layer_border.getXRow(row),
                                                                                      definition->transparent);
-        }
 
-        processFaces(greedyMeshPlane(planeXforward),
-                     MeshInterface::X_ALIGNED,
-                     MeshInterface::Backward,
-                     definition,
-                     solidMesh,
-                     world_position,
-                     -1,
-                     occlusion);
-        processFaces(greedyMeshPlane(planeXbackward),
-                     MeshInterface::X_ALIGNED,
-                     MeshInterface::Forward,
-                     definition,
-                     solidMesh,
-                     world_position,
-                     -1,
-                     occlusion);
+            std::tie(planeYforward[row], planeYbackward[row]) = ProcessFaceRowValues(solid_snapshot.getRow(row, 0),
+                                                                                     next_solid_border.getYRow(row),
+                                                                                     local_layer_border.getYRow(row),
+                                                                                     next_layer_border.getYRow(row),
+                                                                                     definition->transparent);
 
-        processFaces(greedyMeshPlane(planeYforward),
-                     MeshInterface::Y_ALIGNED,
-                     MeshInterface::Backward,
-                     definition,
-                     solidMesh,
-                     world_position,
-                     -1,
-                     occlusion);
-        processFaces(greedyMeshPlane(planeYbackward),
-                     MeshInterface::Y_ALIGNED,
-                     MeshInterface::Forward,
-                     definition,
-                     solidMesh,
-                     world_position,
-                     -1,
-                     occlusion);
+            std::tie(planeZforward[row], planeZbackward[row]) = ProcessFaceRowValues(solid_snapshot.getTransposedRow(0, row),
+                                                                                     next_solid_border.getZRow(row),
+                                                                                     local_layer_border.getZRow(row),
+                                                                                     next_layer_border.getZRow(row),
+                                                                                     definition->transparent);
+        }
 
-        processFaces(greedyMeshPlane(planeZforward),
-                     MeshInterface::Z_ALIGNED,
-                     MeshInterface::Backward,
-                     definition,
-                     solidMesh,
-                     world_position,
-                     -1,
-                     occlusion);
-        processFaces(greedyMeshPlane(planeZbackward),
-                     MeshInterface::Z_ALIGNED,
-                     MeshInterface::Forward,
-                     definition,
-                     solidMesh,
-                     world_position,
-                     -1,
-                     occlusion);
+        if (!dirty || dirty->isDirty(0, -1)) {
+            if (segments)
+                segments->selectPlane(type, 0, -1);
+
+            processFaces(greedyMeshPlane(planeXforward),
+                         MeshInterface::X_ALIGNED,
+                         MeshInterface::Backward,
+                         definition,
+                         solidMesh,
+                         world_position,
+                         -1,
+                         occlusion);
+            processFaces(greedyMeshPlane(planeXbackward),
+                         MeshInterface::X_ALIGNED,
+                         MeshInterface::Forward,
+                         definition,
+                         solidMesh,
+                         world_position,
+                         -1,
+                         occlusion);
+        }
+        if (!dirty || dirty->isDirty(1, -1)) {
+            if (segments)
+                segments->selectPlane(type, 1, -1);
+
+            processFaces(greedyMeshPlane(planeYforward),
+                         MeshInterface::Y_ALIGNED,
+                         MeshInterface::Backward,
+                         definition,
+                         solidMesh,
+                         world_position,
+                         -1,
+                         occlusion);
+            processFaces(greedyMeshPlane(planeYbackward),
+                         MeshInterface::Y_ALIGNED,
+                         MeshInterface::Forward,
+                         definition,
+                         solidMesh,
+                         world_position,
+                         -1,
+                         occlusion);
+        }
+        if (!dirty || dirty->isDirty(2, -1)) {
+            if (segments)
+                segments->selectPlane(type, 2, -1);
+
+            processFaces(greedyMeshPlane(planeZforward),
+                         MeshInterface::Z_ALIGNED,
+                         MeshInterface::Backward,
+                         definition,
+                         solidMesh,
+                         world_position,
+                         -1,
+                         occlusion);
+            processFaces(greedyMeshPlane(planeZbackward),
+                         MeshInterface::Z_ALIGNED,
+                         MeshInterface::Forward,
+                         definition,
+                         solidMesh,
+                         world_position,
+                         -1,
+                         occlusion);
+        }
     }
     // std::cout << "Vertices:" << solidMesh->getIndices().size() << std::endl;
 
+    if (segments)
+        segments->setOrder(std::move(layer_order), std::move(border_order), world_position);
+
     solidMesh->shrink();
 
     return true;
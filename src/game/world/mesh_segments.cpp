@@ -0,0 +1,140 @@
+#include <game/world/mesh_segments.hpp>
+
+void ChunkMeshSegments::selectPlane(BlockID type, int axis, int layer) {
+    current = &types[type].planes[axis][layer + 1];
+    current->clear();
+}
+
+void ChunkMeshSegments::selectBillboards(BlockID type) {
+    current = &types[type].billboards;
+    current->clear();
+}
+
+void ChunkMeshSegments::clearBorder() {
+    for (auto& [type, segments] : types)
+        for (auto& axis : segments.planes)
+            axis[0].clear();
+}
+
+void ChunkMeshSegments::setOrder(std::vector<OrderEntry>&& layers, std::vector<BlockID>&& border, const glm::vec3& world_position) {
+    layer_order          = std::move(layers);
+    border_order         = std::move(border);
+    this->world_position = world_position;
+    current              = nullptr;
+}
+
+static inline void pushFace(ChunkMeshSegments::Segment& segment, const PackedFace::Fields& fields) {
+    PackedFace face = PackedFace::Pack(fields);
+    segment.push_back(face.first);
+    segment.push_back(face.second);
+}
+
+static inline void replayFaces(const ChunkMeshSegments::Segment& segment,
+                               MeshInterface::FaceType type,
+                               MeshInterface* mesh,
+                               const glm::vec3& world_position) {
+    if (segment.empty() || mesh->appendPacked(segment, type))
+        return;
+
+    for (size_t i = 0; i < segment.size(); i += 2) {
+        auto face = PackedFace{segment[i], segment[i + 1]}.unpack();
+
+        std::array<float, 4> occlusion = {static_cast<float>(face.occlusion[0]),
+                                          static_cast<float>(face.occlusion[1]),
+                                          static_cast<float>(face.occlusion[2]),
+                                          static_cast<float>(face.occlusion[3])};
+        mesh->addQuadFace(face.position,
+                          static_cast<float>(face.width),
+                          static_cast<float>(face.height),
+                          face.texture_index,
+                          face.type,
+                          face.direction,
+                          occlusion,
+                          world_position);
+    }
+}
+
+void ChunkMeshSegments::replay(MeshInterface* mesh) const {
+    for (auto& [type, billboard] : layer_order) {
+        auto iterator = types.find(type);
+        if (iterator == types.end())
+            continue;
+
+        auto& segments = iterator->second;
+        if (billboard) {
+            replayFaces(segments.billboards, MeshInterface::BILLBOARD, mesh, world_position);
+            continue;
+        }
+
+        for (int layer = 0; layer < 63; layer++)
+            for (int axis = 0; axis < 3; axis++)
+                replayFaces(segments.planes[axis][layer + 1], static_cast<FaceType>(axis), mesh, world_position);
+    }
+
+    for (auto& type : border_order) {
+        auto iterator = types.find(type);
+        if (iterator == types.end())
+            continue;
+
+        for (int axis = 0; axis < 3; axis++)
+            replayFaces(iterator->second.planes[axis][0], static_cast<FaceType>(axis), mesh, world_position);
+    }
+}
+
+void ChunkMeshSegments::addQuadFace(const glm::ivec3& position,
+                                    float width,
+                                    float height,
+                                    int texture_index,
+                                    FaceType type,
+                                    Direction direction,
+                                    const std::array<float, 4>& occlusion,
+                                    const glm::vec3& world_position) {
+    if (!current)
+        return;
+
+    pushFace(*current,
+             {position,
+              static_cast<int>(width),
+              static_cast<int>(height),
+              texture_index,
+              type,
+              direction,
+              {static_cast<int>(occlusion[0]), static_cast<int>(occlusion[1]), static_cast<int>(occlusion[2]), static_cast<int>(occlusion[3])}});
+}
+
+void ChunkMeshSegments::emitFaces(std::span<const QuadFace> faces,
+                                  int texture_index,
+                                  FaceType type,
+                                  Direction direction,
+                                  const std::array<float, 4>& occlusion,
+                                  const glm::vec3& world_position) {
+    if (!current)
+        return;
+
+    std::array<int, 4> occlusion_values = {
+        static_cast<int>(occlusion[0]), static_cast<int>(occlusion[1]), static_cast<int>(occlusion[2]), static_cast<int>(occlusion[3])};
+
+    preallocate(faces.size(), type);
+    for (auto& face : faces)
+        pushFace(*current,
+                 {face.position, static_cast<int>(face.width), static_cast<int>(face.height), texture_index, type, direction, occlusion_values});
+}
+
+void ChunkMeshSegments::preallocate(size_t size, FaceType type) {
+    if (current && current->size() + size * 2 > current->capacity())
+        current->reserve(std::max(current->size() + size * 2, current->capacity() * 2));
+}
+
+bool ChunkMeshSegments::empty() {
+    for (auto& [type, segments] : types) {
+        if (!segments.billboards.empty())
+            return false;
+
+        for (auto& axis : segments.planes)
+            for (auto& plane : axis)
+                if (!plane.empty())
+                    return false;
+    }
+
+    return true;
+}
@@ -1,55 +1,44 @@
 #include <game/world/terrain.hpp>
 
-std::shared_mutex chunkGenLock;
-
 Chunk* Terrain::createEmptyChunk(glm::ivec3 position) {
-    {
-        std::shared_lock lock(chunkGenLock);
-        auto it = this->chunks.find(position);
-        if (it != this->chunks.end())
-            return it->second.get();
-    }
+    if (Chunk* chunk = chunks.find(position))
+        return chunk;
 
-    std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>(position);
-    std::unique_lock lock(chunkGenLock);
-    this->chunks.emplace(position, std::move(chunk));
+    return chunks.insert(position, std::make_unique<Chunk>(position));
+}
 
-    return this->chunks[position].get();
+void Terrain::releaseChunk(const glm::ivec3& position) {
+    chunks.release(position);
 }
 
-std::unique_ptr<Chunk> Terrain::takeChunk(const glm::ivec3& position) {
-    std::unique_lock lock(chunkGenLock);
-    auto nodeHandle = chunks.extract(position);
+void Terrain::releaseAllChunks() {
+    chunks.releaseAll();
+}
 
-    if (nodeHandle)
-        return std::move(nodeHandle.mapped());
+std::vector<std::unique_ptr<Chunk>> Terrain::collectReleasedChunks() {
+    return chunks.collectReleased();
+}
 
-    return nullptr;
+Chunk* Terrain::reclaimChunk(const glm::ivec3& position) {
+    return chunks.reclaim(position);
 }
+
 void Terrain::addChunk(const glm::ivec3& position, std::unique_ptr<Chunk> chunk) {
     chunk->setWorldPosition(position);
-    std::unique_lock lock(chunkGenLock);
-    this->chunks.emplace(position, std::move(chunk));
+    chunks.insert(position, std::move(chunk));
 }
 
 void Terrain::removeChunk(const glm::ivec3& position) {
-    std::unique_lock lock(chunkGenLock);
-    // if(this->chunks.contains(position))
-    //     this->chunks.erase(position);
+    chunks.erase(position);
 }
 
 Chunk* Terrain::getChunk(glm::ivec3 position) const {
-    std::shared_lock lock(chunkGenLock);
-
-    auto it = this->chunks.find(position);
-    if (it != this->chunks.end()) {
-        return it->second.get();
-    }
-
-    return nullptr;
+    return chunks.find(position);
 }
 
 bool Terrain::collision(glm::vec3 position, const RectangularCollider* collider) {
+    Cursor cursor{*this};
+
     glm::ivec3 ranges = {glm::ceil(collider->width), glm::ceil(collider->height), glm::ceil(collider->depth)};
 
     for (int i = -ranges.x; i <= ranges.x; i++) {
@@ -58,7 +47,7 @@ bool Terrain::collision(glm::vec3 position, const RectangularCollider* collider)
 
                 glm::ivec3 real_position = {floor(position.x + i), floor(position.y + j), floor(position.z + g)};
 
-                Block* blocki = getBlock(real_position);
+                Block* blocki = cursor.getBlock(real_position);
                 if (!blocki)
                     continue;
 
@@ -83,65 +72,160 @@ bool Terrain::collision(glm::vec3 position, const RectangularCollider* collider)
 }
 
 /*
-    Takes a local_distance, which is the in block distance from the floored block position and a direction part from a
-   vector, decides the ratio for that direction and distance
+    Time along the ray until it leaves the chunk through one axis, the chunk covers [origin, origin + 64) on every axis
 */
-static inline float findDeltaRatio(float direction, float local_distance) {
-    float upper_half = local_distance;
-    float lower_half = 1.0f - upper_half;
-
-    if (abs(direction) < 0.0001f)
-        return std::numeric_limits<float>::max();
-    return direction > 0.0f ? (lower_half / direction) : (upper_half / -direction);
+static inline float chunkExitTime(int axis, const glm::ivec3& voxel, const glm::ivec3& origin, const glm::ivec3& step,
+                                  const glm::vec3& t_max, const glm::vec3& t_delta) {
+    if (step[axis] == 0)
+        return std::numeric_limits<float>::infinity();
+
+    int local     = voxel[axis] - origin[axis];
+    int crossings = step[axis] > 0 ? CHUNK_SIZE - local : local + 1;
+    return t_max[axis] + (crossings - 1) * t_delta[axis];
 }
 
 RaycastResult Terrain::raycast(const glm::vec3& from, const glm::vec3& direction, float max_distance) {
-    glm::vec3 current_position = from;
-    glm::vec3 block_position, ratios, local_position, last_block_position, current_movement;
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    glm::ivec3 voxel = glm::floor(from);
+    glm::ivec3 step{0, 0, 0};
+    glm::vec3 t_max{infinity};
+    glm::vec3 t_delta{infinity};
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (direction[axis] > 0.0f)
+            step[axis] = 1;
+        else if (direction[axis] < 0.0f)
+            step[axis] = -1;
+        else
+            continue;
+
+        t_delta[axis]  = std::abs(1.0f / direction[axis]);
+        float boundary = step[axis] > 0 ? voxel[axis] + 1.0f : static_cast<float>(voxel[axis]);
+        t_max[axis]    = (boundary - from[axis]) / direction[axis];
+    }
 
-    float ratio = 0.0f;
-    float current_distance = 0.0f;
-    float distance = 0.0f;
+    RaycastResult result{voxel, voxel};
+    glm::ivec3 previous = voxel;
+    float t             = 0.0f;
+    int last_axis       = -1;
+
+    // Moves over every boundary crossed before the target time, the block the ray is in at that time is the new one
+    auto skip_to = [&](float target) {
+        // Crossings very close to the target are left to the single steps, so ties resolve the same way
+        target = std::min(target, max_distance) - 1e-3f;
+        bool moved = false;
+
+        for (int axis = 0; axis < 3; axis++) {
+            if (t_max[axis] >= target)
+                continue;
+
+            int crossings = static_cast<int>(std::ceil((target - t_max[axis]) / t_delta[axis]));
+            if (crossings <= 0)
+                continue;
+
+            float last_crossing = t_max[axis] + (crossings - 1) * t_delta[axis];
+            if (last_crossing >= t) {
+                t         = last_crossing;
+                last_axis = axis;
+            }
 
-    while (true) {
-        block_position = glm::floor(current_position);
+            voxel[axis] += crossings * step[axis];
+            t_max[axis] += crossings * t_delta[axis];
+            moved = true;
+        }
+
+        if (moved) {
+            previous = voxel;
+            previous[last_axis] -= step[last_axis];
+        }
+    };
 
-        auto* block = getBlock(block_position);
-        if (block && block->id != BLOCK_AIR_INDEX)
-            return {block_position, last_block_position};
+    auto guard = pin();
 
-        local_position = glm::abs(current_position - block_position);
+    glm::ivec3 chunk_position{std::numeric_limits<int>::min()};
+    Chunk* chunk              = nullptr;
+    BitField3D* solid_field   = nullptr;
+    glm::ivec2 row_position{-1, -1};
+    uint64_t row = 0;
+
+    while (t <= max_distance) {
+        glm::ivec3 current_chunk = ChunkCoordinates::ToChunk(voxel);
+        glm::ivec3 local         = ChunkCoordinates::ToLocal(voxel);
+
+        if (current_chunk != chunk_position) {
+            chunk_position = current_chunk;
+            chunk          = getChunk(chunk_position);
+            solid_field    = chunk && !chunk->isEmpty() ? &chunk->getSolidField() : nullptr;
+            row_position   = {-1, -1};
+        }
 
-        ratios = {findDeltaRatio(direction.x, local_position.x), findDeltaRatio(direction.y, local_position.y),
-                  findDeltaRatio(direction.z, local_position.z)};
+        if (!solid_field) {
+            // Nothing to hit in the whole chunk
+            glm::ivec3 origin = chunk_position * CHUNK_SIZE;
+            skip_to(std::min({chunkExitTime(0, voxel, origin, step, t_max, t_delta), chunkExitTime(1, voxel, origin, step, t_max, t_delta),
+                              chunkExitTime(2, voxel, origin, step, t_max, t_delta)}));
+        } else {
+            if (row_position != glm::ivec2{local.x, local.y}) {
+                row_position = {local.x, local.y};
+
+                // Transparent blocks are not in the solid field, their layers are added to it
+                row = solid_field->getRow(local.x, local.y);
+                for (auto& layer : chunk->getLayers()) {
+                    auto* prototype = BlockRegistry::get().getPrototype(layer.type);
+                    if (!prototype || prototype->transparent)
+                        row |= layer.field().getRow(local.x, local.y);
+                }
+            }
 
-        ratio = glm::min(glm::min(ratios.x, ratios.y), ratios.z) +
-                0.001f; // Slight offset to not get stuck across block boundaries
+            if (row & (1ULL << (63 - local.z))) {
+                result.position     = voxel;
+                result.lastPosition = previous;
+                result.hit          = true;
+                result.distance     = t;
+                if (last_axis != -1)
+                    result.normal[last_axis] = -step[last_axis];
+                return result;
+            }
 
-        current_movement = direction * ratio;
-        current_position += current_movement;
+            // The rest of the row is empty, the ray can only move along z until x or y changes
+            if (row == 0) {
+                glm::ivec3 origin = chunk_position * CHUNK_SIZE;
+                skip_to(std::min({t_max.x, t_max.y, chunkExitTime(2, voxel, origin, step, t_max, t_delta)}));
+            }
+        }
 
-        distance = glm::length(current_movement);
+        if (t > max_distance)
+            break;
 
-        current_distance += distance;
-        if (current_distance >= max_distance)
-            return {block_position, last_block_position};
+        // Single step to the next block
+        int axis = t_max.x < t_max.y ? (t_max.x < t_max.z ? 0 : 2) : (t_max.y < t_max.z ? 1 : 2);
+        if (t_max[axis] == infinity)
+            break;
 
-        last_block_position = block_position;
+        previous = voxel;
+        t        = t_max[axis];
+        voxel[axis] += step[axis];
+        t_max[axis] += t_delta[axis];
+        last_axis = axis;
     }
+
+    result.position     = voxel;
+    result.lastPosition = previous;
+    return result;
 }
 
 glm::ivec3 Terrain::blockToChunkPosition(glm::ivec3 blockPosition) const {
-    return glm::floor(glm::vec3(blockPosition) / static_cast<float>(CHUNK_SIZE));
+    return ChunkCoordinates::ToChunk(blockPosition);
 }
 
 glm::ivec3 Terrain::getGetChunkRelativeBlockPosition(glm::ivec3 position) {
-    return glm::abs(position - blockToChunkPosition(position) * CHUNK_SIZE);
+    return ChunkCoordinates::ToLocal(position);
 }
 
 Block* Terrain::getBlock(glm::ivec3 position) const {
-    auto chunkPosition = blockToChunkPosition(position);
-    auto blockPosition = glm::abs(position - chunkPosition * CHUNK_SIZE);
+    auto chunkPosition = ChunkCoordinates::ToChunk(position);
+    auto blockPosition = ChunkCoordinates::ToLocal(position);
     // printf("Chunk coords: %ix%i Block coords: %i(%i)x%ix%i(%i)\n", chunkX, chunkZ, ix,iy,iz);
 
     Chunk* chunk = this->getChunk(chunkPosition);
@@ -152,16 +236,17 @@ Block* Terrain::getBlock(glm::ivec3 position) const {
 }
 
 Chunk* Terrain::getChunkFromBlockPosition(glm::ivec3 position) const {
-    return this->getChunk(blockToChunkPosition(position));
+    return this->getChunk(ChunkCoordinates::ToChunk(position));
 }
 
 bool Terrain::setBlock(const glm::ivec3& position, const Block& block) {
-    auto chunkPosition = blockToChunkPosition(position);
-    auto blockPosition = glm::abs(position - chunkPosition * CHUNK_SIZE);
+    auto chunkPosition = ChunkCoordinates::ToChunk(position);
+    auto blockPosition = ChunkCoordinates::ToLocal(position);
     // printf("Chunk coords: %ix%i Block coords: %ix%ix%i\n", chunkX, chunkZ, ix,y,iz);
 
     // Block* i = getWorldBlock(world, ix, y, iz);
 
+    auto guard = pin();
     Chunk* chunk = this->getChunk(chunkPosition);
     if (!chunk)
         return false; // this->generateAndGetChunk(chunkX, chunkZ)->setBlock(ix,y,iz,index);
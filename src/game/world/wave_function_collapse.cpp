@@ -1,4 +1,10 @@
 #include <game/world/wave_function_collapse.hpp>
+#include <game/world/world_random.hpp>
+
+#include <bit>
+#include <limits>
+
+#include <structure/synchronization/threadlocal.hpp>
 
 using namespace WaveFunctionCollapse;
 using CT = ChunkDefinition::CrossType;
@@ -40,77 +46,177 @@ static auto chunk_definitions = std::to_array({
     ChunkDefinition({CT::WALL,CT::OPEN,CT::OPEN,CT::WALL,CT::WALL,CT::OPEN}),
 });
 
-static std::unordered_map<glm::ivec3, size_t, IVec3Hash, IVec3Equal> generated_chunks{};
-
-const ChunkDefinition& ChunkDefinition::getDefinitionFor(const glm::ivec3& position, int iseed){
-    if(generated_chunks.contains(position)) 
-        return chunk_definitions.at(generated_chunks.at(position));
+/*
+    Cells are collapsed a region at a time, the region only depends on the seed and its position so the cells don't
+    depend on which ones were asked for first. Faces on the border of a region are a wall or open from a hash of the
+    face, both regions see the same value. Inside the region every collapsed cell limits its neighbours to the
+    definitions that match it, like in the usual wave function collapse.
+*/
+static const int region_size  = 64 / ChunkDefinition::size; // Cells per axis, a region covers a world chunk
+static const int region_cells = region_size * region_size * region_size;
+
+static_assert((region_size & (region_size - 1)) == 0, "Cave regions are found by a shift, their size has to be a power of two.");
+
+using Candidates = uint32_t; // Bit for every definition that is still possible
+
+static_assert(chunk_definitions.size() <= 32, "Candidates of a cell have to fit a Candidates mask.");
+
+// Top, bottom, left, right, front, back like the cross types, the opposite of a face is face ^ 1
+static const std::array<glm::ivec3, 6> face_offsets = {
+    glm::ivec3{ 0, 1, 0},
+    glm::ivec3{ 0,-1, 0},
+    glm::ivec3{-1, 0, 0},
+    glm::ivec3{ 1, 0, 0},
+    glm::ivec3{ 0, 0,-1},
+    glm::ivec3{ 0, 0, 1}
+};
 
-    const static std::array<glm::ivec3,6> offsets = {
-        glm::ivec3{ 0, 1, 0},
-        glm::ivec3{ 0,-1, 0},
-        glm::ivec3{-1, 0, 0},
-        glm::ivec3{ 1, 0, 0},
-        glm::ivec3{ 0, 0,-1},
-        glm::ivec3{ 0, 0, 1}
-    };
+struct CollapsedRegion{
+    bool valid = false;
+    int seed = 0;
+    glm::ivec3 position{0};
+    std::array<uint8_t, region_cells> cells{}; // Index of the definition of every cell
+};
 
-    std::array<CT, 6> surrounding_neighbours{};
-    std::unordered_set<size_t> found_neighbours{};
+static CT getFaceType(const glm::ivec3& position, int face, int seed){
+    // A face is identified by the cell on its negative side
+    auto& offset = face_offsets[face];
+    glm::ivec3 owner = offset.x + offset.y + offset.z > 0 ? position : position + offset;
 
-    for(int i = 0; i < 6;i++){
-        glm::ivec3 offset_position = position + offsets[i];
-        if(!generated_chunks.contains(offset_position)){
-            surrounding_neighbours[i] = UNKNOWN;
-            continue;
-        }
-        size_t neighbour_index = generated_chunks.at(offset_position);
-        found_neighbours.emplace(neighbour_index);
-        auto neighbour = chunk_definitions.at(neighbour_index);
+    return WorldRandom::Hash(seed, owner, WorldRandom::CAVE_FACE + face / 2) & 1 ? CT::WALL : CT::OPEN;
+}
 
-        surrounding_neighbours[i] = neighbour.getCrossTypes().at(i + (i % 2 == 0 ? 1 : -1));
+// Definitions that have a cross type on a face, the all open definition is only used when nothing else fits
+static Candidates definitionsWith(int face, CT type){
+    Candidates result = 0;
+    for(size_t i = 1;i < chunk_definitions.size();i++){
+        if(chunk_definitions[i].getCrossTypes()[face] == type) result |= 1U << i;
     }
+    return result;
+}
 
-    static std::vector<size_t> candidates{};
-    candidates.clear();
+static int cellIndex(const glm::ivec3& local){
+    return local.x + (local.y + local.z * region_size) * region_size;
+}
 
-    for(size_t i = 1;i < chunk_definitions.size();i++){
-        auto definition = chunk_definitions.at(i);
-
-        bool passed = true;
-        for(int i = 0;i < 6;i++){
-            if(surrounding_neighbours[i] == UNKNOWN) continue;
-            if(definition.getCrossTypes().at(i) != surrounding_neighbours[i]){
-                passed = false;
-                break;
+static bool inRegion(const glm::ivec3& local){
+    return local.x >= 0 && local.y >= 0 && local.z >= 0 && local.x < region_size && local.y < region_size && local.z < region_size;
+}
+
+static void collapseRegion(CollapsedRegion& region){
+    static const auto with = [](){
+        std::array<std::array<Candidates, 2>, 6> result{};
+        for(int face = 0;face < 6;face++){
+            result[face][CT::WALL] = definitionsWith(face, CT::WALL);
+            result[face][CT::OPEN] = definitionsWith(face, CT::OPEN);
+        }
+        return result;
+    }();
+    static const Candidates all = with[0][CT::WALL] | with[0][CT::OPEN];
+
+    static ThreadLocal<std::array<Candidates, region_cells>> candidates_scratch{};
+    auto& candidates = candidates_scratch.Get();
+
+    glm::ivec3 origin = region.position * region_size;
+    std::vector<int> pending{};
+
+    // Removes what doesnt match the cell from its neighbours, and from theirs in turn. A neighbour left without any
+    // definition keeps the ones it had, that face is the only one that doesnt match
+    auto propagate = [&](){
+        while(!pending.empty()){
+            int cell = pending.back();
+            pending.pop_back();
+
+            glm::ivec3 local = {cell % region_size, cell / region_size % region_size, cell / region_size / region_size};
+            for(int face = 0;face < 6;face++){
+                glm::ivec3 neighbour = local + face_offsets[face];
+                if(!inRegion(neighbour)) continue;
+
+                Candidates allowed = 0;
+                if(candidates[cell] & with[face][CT::WALL]) allowed |= with[face ^ 1][CT::WALL];
+                if(candidates[cell] & with[face][CT::OPEN]) allowed |= with[face ^ 1][CT::OPEN];
+
+                auto& neighbour_candidates = candidates[cellIndex(neighbour)];
+                Candidates remaining = neighbour_candidates & allowed;
+                if(remaining == neighbour_candidates || remaining == 0) continue;
+
+                neighbour_candidates = remaining;
+                pending.push_back(cellIndex(neighbour));
             }
         }
+    };
 
-        if(!passed) continue;
+    // The border faces come first, they are shared with the surrounding regions
+    for(int cell = 0;cell < region_cells;cell++){
+        glm::ivec3 local = {cell % region_size, cell / region_size % region_size, cell / region_size / region_size};
 
-        if(
-            found_neighbours.contains(i)
-            && chunk_definitions.at(i).getCrossTypes().at(BOTTOM) == WALL
-            && chunk_definitions.at(i).getCrossTypes().at(TOP) == WALL
-        ){
-            for(int i = 0;i < 3;i++) candidates.push_back(i);
+        candidates[cell] = all;
+        for(int face = 0;face < 6;face++){
+            if(inRegion(local + face_offsets[face])) continue;
+
+            Candidates remaining = candidates[cell] & with[face][getFaceType(origin + local, face, region.seed)];
+            if(remaining != 0) candidates[cell] = remaining;
         }
-        candidates.push_back(i);
+        if(candidates[cell] != all) pending.push_back(cell);
+    }
+    propagate();
+
+    // Always collapses the cell with the fewest definitions left, ties go to a hash of the cell
+    static ThreadLocal<std::array<uint32_t, region_cells>> order_scratch{};
+    auto& order = order_scratch.Get();
+    for(int cell = 0;cell < region_cells;cell++){
+        glm::ivec3 local = {cell % region_size, cell / region_size % region_size, cell / region_size / region_size};
+        order[cell] = static_cast<uint32_t>(WorldRandom::Hash(region.seed, origin + local, WorldRandom::CAVE_ORDER));
     }
 
-    if(candidates.size() == 0) candidates.push_back(0);
+    std::array<bool, region_cells> collapsed{};
+    for(int step = 0;step < region_cells;step++){
+        int chosen = -1;
+        uint64_t chosen_key = std::numeric_limits<uint64_t>::max();
+
+        for(int cell = 0;cell < region_cells;cell++){
+            if(collapsed[cell]) continue;
+
+            uint64_t key = (static_cast<uint64_t>(std::popcount(candidates[cell])) << 32) | order[cell];
+            if(key >= chosen_key) continue;
 
-    // Define a fixed seed for reproducibility
-    static std::seed_seq seed{iseed};  // You can change this seed
-    static std::mt19937 gen(seed); // Mersenne Twister engine with fixed seed
-    std::uniform_int_distribution<std::size_t> dist(0, candidates.size() - 1);
+            chosen = cell;
+            chosen_key = key;
+        }
+
+        glm::ivec3 local = {chosen % region_size, chosen / region_size % region_size, chosen / region_size / region_size};
+        Candidates options = candidates[chosen];
+        size_t pick = WorldRandom::Pick(region.seed, origin + local, WorldRandom::CAVE_CHOICE, std::popcount(options));
+        for(size_t i = 0;i < pick;i++) options &= options - 1;
 
-    size_t result = candidates.at(dist(gen));
+        int definition = std::countr_zero(options);
+        candidates[chosen] = 1U << definition;
+        region.cells[chosen] = static_cast<uint8_t>(definition);
+        collapsed[chosen] = true;
 
-    //std::cout << "Selected: " << result << " for " << position.x << " " << position.y << " " << position.z << "\n";  
-    generated_chunks[position] = result;
-    return chunk_definitions.at(result);
-} 
+        pending.push_back(chosen);
+        propagate();
+    }
+}
+
+const ChunkDefinition& ChunkDefinition::getDefinitionFor(const glm::ivec3& position, int seed){
+    const static int shift = std::countr_zero(static_cast<unsigned>(region_size));
+
+    glm::ivec3 region_position = {position.x >> shift, position.y >> shift, position.z >> shift};
+
+    // Cells are asked for one by one, the last collapsed region is kept for the rest of its cells
+    static ThreadLocal<CollapsedRegion> regions{};
+    auto& region = regions.Get();
+
+    if(!region.valid || region.seed != seed || region.position != region_position){
+        region.valid    = true;
+        region.seed     = seed;
+        region.position = region_position;
+        collapseRegion(region);
+    }
+
+    return chunk_definitions.at(region.cells[cellIndex(position & (region_size - 1))]);
+}
 
 enum Axis{
     X = 0,
@@ -2,11 +2,71 @@
 #include <memory>
 #include <random>
 
+#include <game/world/world_random.hpp>
+#include <structure/synchronization/threadlocal.hpp>
+
 #define FNL_IMPL
 #include <FastNoiseLite.h>
 
 const auto GetID = BlockRegistry::GetBlockID;
 
+using ColumnValues = std::array<float, CHUNK_SIZE * CHUNK_SIZE>;
+
+// Noise of every layer for all the columns of a chunk, indexed by x * CHUNK_SIZE + z
+struct HeightmapNoise {
+    ColumnValues continentalness;
+    ColumnValues weirdness;
+    ColumnValues errosion;
+    ColumnValues temperature;
+    ColumnValues humidity;
+};
+
+// Sample positions of one layer for all the columns of a chunk
+struct NoiseCoordinates {
+    ColumnValues x;
+    ColumnValues y;
+};
+
+// Terrain of a chunk as one row mask per block type, so it is set a whole layer at a time instead of block by block
+struct TerrainLayers {
+    std::vector<BlockID> types;
+    std::vector<BitField> masks;
+    size_t used = 0;
+
+    BitField structure_mask; // Positions taken by structure blocks, the terrain leaves them alone
+
+    void reset() {
+        used = 0;
+        structure_mask.fill(0);
+    }
+
+    BitField& maskFor(BlockID type) {
+        for (size_t i = 0; i < used; i++)
+            if (types[i] == type)
+                return masks[i];
+
+        if (used == masks.size()) {
+            types.push_back(type);
+            masks.emplace_back();
+        } else {
+            types[used] = type;
+            masks[used].fill(0);
+        }
+
+        return masks[used++];
+    }
+};
+
+// Maps raw noise to 0 - 1 and snaps it, shared by the single and the batched path so both round the same
+static float FinishNoiseValue(float noise, int snap_range) {
+    float value = (noise + 1.0) / 2.0;
+
+    if (snap_range != 0)
+        value = (floor((value * 100.0f) / static_cast<float>(snap_range)) * static_cast<float>(snap_range)) / 100.0f;
+
+    return value;
+}
+
 WorldGenerator::WorldGenerator() {
     tree = std::make_shared<Structure>(5, 7, 5);
 
@@ -53,29 +113,34 @@ WorldGenerator::WorldGenerator() {
 
 void WorldGenerator::SetupBiomeLayers() {
     biomes.clear();
-    auto& height_map_layer = AddNoiseLayer("continentalness");
-    height_map_layer.noise.SetFrequency(0.003f);
-
-    auto& weirdness_layer = AddNoiseLayer("weirdness");
-    weirdness_layer.noise.SetFrequency(0.01f);
-    weirdness_layer.noise.SetFractalOctaves(15);
-    weirdness_layer.noise.SetFractalType(FastNoiseLite::FractalType_FBm);
-    weirdness_layer.noise.SetFractalLacunarity(2.0f);
-
-    auto& errosion_layer = AddNoiseLayer("errosion");
-    errosion_layer.noise.SetFrequency(0.01f);
-
-    auto& temperature_layer = AddNoiseLayer("temperature");
-    temperature_layer.noise.SetFrequency(0.0005f);
-    temperature_layer.noise.SetFractalOctaves(3);
-    temperature_layer.noise.SetFractalType(FastNoiseLite::FractalType_FBm);
-    temperature_layer.snap_range = 10;
-
-    auto& humidity_layer = AddNoiseLayer("humidity");
-    humidity_layer.noise.SetFrequency(0.001f);
-    humidity_layer.noise.SetFractalOctaves(3);
-    humidity_layer.noise.SetFractalType(FastNoiseLite::FractalType_FBm);
-    humidity_layer.snap_range = 10;
+    noise_layers.clear();
+
+    NoiseSettings continentalness{};
+    continentalness.frequency = 0.003f;
+    continentalness_layer     = AddNoiseLayer(continentalness);
+
+    NoiseSettings weirdness{};
+    weirdness.frequency  = 0.01f;
+    weirdness.octaves    = 15;
+    weirdness.fractal    = true;
+    weirdness.lacunarity = 2.0f;
+    weirdness_layer      = AddNoiseLayer(weirdness);
+
+    NoiseSettings errosion{};
+    errosion.frequency = 0.01f;
+    errosion_layer     = AddNoiseLayer(errosion);
+
+    NoiseSettings temperature{};
+    temperature.frequency = 0.0005f;
+    temperature.octaves   = 3;
+    temperature.fractal   = true;
+    temperature_layer     = AddNoiseLayer(temperature, 10);
+
+    NoiseSettings humidity{};
+    humidity.frequency = 0.001f;
+    humidity.octaves   = 3;
+    humidity.fractal   = true;
+    humidity_layer     = AddNoiseLayer(humidity, 10);
     // noise.SetSeed(1985);
     //
     default_biome = std::make_shared<Biome>(Biome{{0, 0, false, false},
@@ -112,34 +177,100 @@ void WorldGenerator::placeStructure(const glm::ivec3& position, const std::share
     structures.add(position, structure->getSize(), structure);
 }
 
-WorldGenerator::NoiseLayer& WorldGenerator::AddNoiseLayer(const std::string& name) {
-    auto& layer = noise_layers[name];
-    auto& noise = layer.noise;
+// Touching counts as overlapping, a superset of what RegionRegistry rejects
+static bool CandidatesOverlap(const WorldGenerator::StructureCandidate& a, const WorldGenerator::StructureCandidate& b) {
+    glm::ivec3 a_max = a.position + a.structure->getSize();
+    glm::ivec3 b_max = b.position + b.structure->getSize();
+
+    return a.position.x <= b_max.x && b.position.x <= a_max.x && a.position.y <= b_max.y && b.position.y <= a_max.y &&
+           a.position.z <= b_max.z && b.position.z <= a_max.z;
+}
+
+void WorldGenerator::placeStructuresFor(const glm::ivec3& position_in) {
+    auto position = glm::ivec3(position_in.x, 0, position_in.z);
+
+    // The flag is kept in the heightmap, so it is evicted together with it
+    auto column = getHeightmapFor(position);
+    {
+        std::lock_guard lock(structure_mutex);
+        if (column->structures_placed)
+            return;
+    }
+
+    // Structures are centered on a column, so only candidates of the neighbouring columns can reach into this one
+    std::array<std::shared_ptr<const Heightmap>, 9> maps{};
+    for (int i = -1; i <= 1; i++)
+        for (int j = -1; j <= 1; j++)
+            maps[(i + 1) * 3 + j + 1] = i == 0 && j == 0 ? column : getHeightmapFor(position + glm::ivec3{i, 0, j});
+
+    std::lock_guard lock(structure_mutex);
+    if (column->structures_placed)
+        return;
+
+    std::vector<const StructureCandidate*> nearby{};
+    for (auto& map : maps)
+        for (auto& candidate : map->structure_candidates)
+            nearby.push_back(&candidate);
+
+    for (auto& candidate : maps[4]->structure_candidates) {
+        // Equal priorities block each other, neither wins
+        bool blocked = false;
+        for (auto* other : nearby) {
+            if (other != &candidate && other->priority >= candidate.priority && CandidatesOverlap(*other, candidate)) {
+                blocked = true;
+                break;
+            }
+        }
+
+        if (!blocked)
+            placeStructure(candidate.position, candidate.structure);
+    }
+
+    column->structures_placed = true;
+}
+
+WorldGenerator::NoiseLayerHandle WorldGenerator::AddNoiseLayer(const NoiseSettings& settings, int snap_range) {
+    auto& layer = noise_layers.emplace_back();
 
     static std::uniform_int_distribution<std::size_t> dist(1000, 10000);
 
     layer.offset.x = static_cast<float>(dist(*offset_random_engine));
     layer.offset.y = static_cast<float>(dist(*offset_random_engine));
 
-    noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
-    noise.SetFrequency(0.001f);
+    NoiseSettings seeded = settings;
+    seeded.seed          = seed;
+    layer.noise.configure(seeded);
 
-    return layer;
-}
+    layer.snap_range = snap_range;
 
-float WorldGenerator::GetNoiseValueAt(const glm::vec3& position, const std::string& layer_name) {
-    if (!noise_layers.contains(layer_name))
-        return 0;
+    return noise_layers.size() - 1;
+}
 
-    auto& layer = noise_layers.at(layer_name);
+float WorldGenerator::GetNoiseValueAt(const glm::vec3& position, NoiseLayerHandle handle) {
+    auto& layer = noise_layers[handle];
 
     glm::vec2 pos = glm::vec2(position.x + layer.offset.x, position.z + layer.offset.y) / 10.0f;
-    float value   = (layer.noise.GetNoise(pos.x, pos.y) + 1.0) / 2.0;
+    return FinishNoiseValue(layer.noise.sample(pos.x, pos.y), layer.snap_range);
+}
 
-    if (layer.snap_range != 0)
-        value = (floor((value * 100.0f) / static_cast<float>(layer.snap_range)) * static_cast<float>(layer.snap_range)) / 100.0f;
+void WorldGenerator::GetNoiseValuesFor(const glm::ivec3& position, NoiseLayerHandle handle, ColumnValues& output) {
+    static ThreadLocal<NoiseCoordinates> coordinates_scratch{};
+    auto& coordinates = coordinates_scratch.Get();
 
-    return value;
+    auto& layer = noise_layers[handle];
+
+    for (int x = 0; x < CHUNK_SIZE; x++)
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            glm::vec3 world_position = glm::ivec3(x, 0, z) + position * CHUNK_SIZE;
+
+            coordinates.x[x * CHUNK_SIZE + z] = (world_position.x + layer.offset.x) / 10.0f;
+            coordinates.y[x * CHUNK_SIZE + z] = (world_position.z + layer.offset.y) / 10.0f;
+        }
+
+    layer.noise.sample(coordinates.x.data(), coordinates.y.data(), CHUNK_SIZE * CHUNK_SIZE, output.data());
+
+    for (auto& value : output)
+        value = FinishNoiseValue(value, layer.snap_range);
 }
 
 Image WorldGenerator::createPreview(int width, int height, float step) {
@@ -177,63 +308,72 @@ Image WorldGenerator::createPreview(int width, int height, float step) {
 }
 
 Biome* WorldGenerator::GetBiomeFor(const glm::ivec3& position) {
-    auto temperature = GetNoiseValueAt(position, "temperature");
-    auto humidity    = GetNoiseValueAt(position, "humidity");
+    return GetBiomeFor(GetNoiseValueAt(position, temperature_layer), GetNoiseValueAt(position, humidity_layer));
+}
 
-    std::vector<Biome*> candidates{};
+Biome* WorldGenerator::GetBiomeFor(float temperature, float humidity) {
+    // The first biome that fits wins
     for (auto& biome : biomes) {
-        if (!biome->humidity.IsWithin(humidity) || !biome->temperature.IsWithin(temperature))
-            continue;
-        candidates.push_back(biome.get());
+        if (biome->humidity.IsWithin(humidity) && biome->temperature.IsWithin(temperature))
+            return biome.get();
     }
 
-    if (candidates.size() == 0)
-        return default_biome.get();
-    return candidates[0];
+    return default_biome.get();
 }
 
-int WorldGenerator::GetHeightAt(const glm::vec3 position) {
-    float continentalness = GetNoiseValueAt(position, "continentalness");
-    float weirdness       = GetNoiseValueAt(position, "weirdness");
-    float errosion        = GetNoiseValueAt(position, "errosion");
-
+int WorldGenerator::GetHeightFor(float continentalness, float weirdness, float errosion) {
     float value = pow(continentalness, 2) * pow(pow(weirdness, 4), pow(errosion, 3));
 
     return value * ((3 * 64) - 20);
 }
 
-WorldGenerator::Heightmap& WorldGenerator::getHeightmapFor(glm::ivec3 position_in) {
-    static std::shared_mutex mutex;
-    auto position = glm::ivec3(position_in.x, 0, position_in.z);
+int WorldGenerator::GetHeightAt(const glm::vec3 position) {
+    return GetHeightFor(GetNoiseValueAt(position, continentalness_layer),
+                        GetNoiseValueAt(position, weirdness_layer),
+                        GetNoiseValueAt(position, errosion_layer));
+}
 
-    {
-        std::shared_lock lock(mutex);
-        if (getHeightMaps().contains(position))
-            return *getHeightMaps().at(position);
-    }
+std::shared_ptr<const WorldGenerator::Heightmap> WorldGenerator::getHeightmapFor(glm::ivec3 position_in) {
+    auto position = glm::ivec3(position_in.x, 0, position_in.z);
 
-    std::unique_lock lock(mutex);
+    if (auto cached = height_maps.Get(position))
+        return cached;
 
-    getHeightMaps().emplace(position, std::make_unique<Heightmap>());
-    auto& map = getHeightMaps().at(position);
+    // Calculated without holding any lock, when two threads miss the same column the first one to load it wins
+    auto map = std::make_shared<Heightmap>();
 
     map->lowest  = INT32_MAX;
     map->highest = INT32_MIN;
 
+    // Every layer is evaluated for the whole chunk at once instead of column by column
+    static ThreadLocal<HeightmapNoise> noise_scratch{};
+    auto& noise = noise_scratch.Get();
+
+    GetNoiseValuesFor(position, continentalness_layer, noise.continentalness);
+    GetNoiseValuesFor(position, weirdness_layer, noise.weirdness);
+    GetNoiseValuesFor(position, errosion_layer, noise.errosion);
+    GetNoiseValuesFor(position, temperature_layer, noise.temperature);
+    GetNoiseValuesFor(position, humidity_layer, noise.humidity);
+
     for (int x = 0; x < CHUNK_SIZE; x++)
         for (int z = 0; z < CHUNK_SIZE; z++) {
             glm::ivec3 localPosition = glm::ivec3(x, 0, z) + position * CHUNK_SIZE;
 
-            int value  = GetHeightAt(localPosition);
-            auto biome = GetBiomeFor(localPosition);
+            size_t index = x * CHUNK_SIZE + z;
+            int value    = GetHeightFor(noise.continentalness[index], noise.weirdness[index], noise.errosion[index]);
+            auto biome   = GetBiomeFor(noise.temperature[index], noise.humidity[index]);
 
-            static std::uniform_int_distribution<std::size_t> dist(0, 1000000);
+            for (size_t i = 0; i < biome->structures.size(); i++) {
+                auto& structure = biome->structures[i];
 
-            for (auto& structure : biome->structures) {
-                float chance_value = (float)dist(*structure_random_engine) / 10000;
+                float chance_value = WorldRandom::Chance(seed, localPosition, WorldRandom::STRUCTURE_SPAWN + i) * 100.0f;
                 if (chance_value <= structure.spawn_chance && localPosition.y + value > water_level) {
                     auto size = structure.structure->getSize() / 2;
-                    placeStructure(localPosition + glm::ivec3{-size.x, value + 1, -size.y}, structure.structure);
+
+                    glm::ivec3 structure_position = localPosition + glm::ivec3{-size.x, value + 1, -size.y};
+                    uint64_t priority             = WorldRandom::Hash(seed, structure_position, WorldRandom::STRUCTURE_PRIORITY);
+
+                    map->structure_candidates.push_back({structure_position, structure.structure, priority});
                     break;
                 }
             }
@@ -244,7 +384,8 @@ WorldGenerator::Heightmap& WorldGenerator::getHeightmapFor(glm::ivec3 position_i
             map->biomes[x][z]  = biome;
         }
 
-    return *map;
+    size_t size = sizeof(Heightmap) + map->structure_candidates.capacity() * sizeof(StructureCandidate);
+    return height_maps.Load(position, std::move(map), size);
 }
 
 void WorldGenerator::prepareHeightMaps(glm::ivec3 around, int distance) {
@@ -256,15 +397,14 @@ void WorldGenerator::prepareHeightMaps(glm::ivec3 around, int distance) {
 
 void WorldGenerator::GenerateTerrainChunk(Chunk* chunk, glm::ivec3 position, unsigned int simplification_step) {
     // static const int count = CHUNK_SIZE / ChunkDefinition::size;
-    // Pregen surrounding maps to keep structures whole
+    // Structures of the surrounding columns reach into this one, place them first to keep them whole
 
-    for(int i = -1;i <= 1;i++)
-    for(int j = -1;j <= 1;j++){
-        if(i == 0 && j == 0) continue;
-        getHeightmapFor(position + glm::ivec3{i,0,j});
-    }
+    for (int i = -1; i <= 1; i++)
+        for (int j = -1; j <= 1; j++)
+            placeStructuresFor(position + glm::ivec3{i, 0, j});
 
-    auto& heightMap = getHeightmapFor(position);
+    auto heightmap_pointer = getHeightmapFor(position);
+    auto& heightMap        = *heightmap_pointer;
 
     if (heightMap.lowest - 1 > position.y * CHUNK_SIZE + CHUNK_SIZE) {
         chunk->fill({heightMap.biomes[0][0]->underground_block});
@@ -276,53 +416,85 @@ void WorldGenerator::GenerateTerrainChunk(Chunk* chunk, glm::ivec3 position, uns
 
     chunk->generated_simplification_step = simplification_step;
 
-    for (int x = 0; x < CHUNK_SIZE; x += simplification_step)
-        for (int y = 0; y < CHUNK_SIZE; y += simplification_step)
-            for (int z = 0; z < CHUNK_SIZE; z += simplification_step) {
-                glm::ivec3 localPosition = glm::ivec3(x, y, z) + position * CHUNK_SIZE;
-
-                auto* biome = heightMap.biomes[x][z];
-                auto height = heightMap.heights[x][z];
-
-                auto* structure_region = structures.get(localPosition);
-                if (structure_region && localPosition.y > water_level) {
-                    glm::ivec3 relative_position = localPosition - structure_region->min;
+    static ThreadLocal<TerrainLayers> layers_scratch{};
+    auto& layers = layers_scratch.Get();
+    layers.reset();
+
+    int step             = static_cast<int>(simplification_step);
+    auto align           = [step](int value) { return (value + step - 1) / step * step; }; // Next generated coordinate
+    glm::ivec3 chunk_min = position * CHUNK_SIZE;
+    glm::ivec3 chunk_max = chunk_min + CHUNK_SIZE;
+
+    // Structure blocks above the water replace the terrain, their air lets it through
+    for (auto* region : structures.getWithin(chunk_min, chunk_max)) {
+        glm::ivec3 min = glm::max(region->min, chunk_min) - chunk_min;
+        glm::ivec3 max = glm::min(region->max, chunk_max) - chunk_min;
+
+        for (int x = align(min.x); x < max.x; x += step)
+            for (int y = align(min.y); y < max.y; y += step)
+                for (int z = align(min.z); z < max.z; z += step) {
+                    glm::ivec3 world_position = glm::ivec3(x, y, z) + chunk_min;
+                    if (world_position.y <= water_level)
+                        continue;
 
-                    auto* block = structure_region->value->getBlock(relative_position);
-                    if (block && block->id != BLOCK_AIR_INDEX) {
-                        chunk->setBlock(glm::ivec3(x, y, z), {block->id}, true);
+                    // Where regions share a subregion the first one registered owns the position
+                    if (structures.get(world_position) != region)
                         continue;
-                    }
-                }
 
-                if (localPosition.y > height) {
-                    if (localPosition.y <= water_level) {
-                        chunk->setBlock(glm::ivec3(x, y, z), {biome->water_block}, true);
+                    auto* block = region->value->getBlock(world_position - region->min);
+                    if (!block || block->id == BLOCK_AIR_INDEX)
                         continue;
-                    }
-                    continue;
+
+                    chunk->setBlock(glm::ivec3(x, y, z), {block->id}, true);
+                    layers.structure_mask.setRowMask(x, y, 1ULL << (63 - z));
                 }
+    }
+
+    int water_end = std::min(water_level - chunk_min.y, CHUNK_SIZE - 1);
+
+    for (int x = 0; x < CHUNK_SIZE; x += step)
+        for (int z = 0; z < CHUNK_SIZE; z += step) {
+            auto* biome  = heightMap.biomes[x][z];
+            int height   = heightMap.heights[x][z] - chunk_min.y;
+            uint64_t bit = 1ULL << (63 - z);
 
-                if (localPosition.y == height)
-                    chunk->setBlock(glm::ivec3(x, y, z), {biome->surface_block}, true);
-                else
-                    chunk->setBlock(glm::ivec3(x, y, z), {biome->underground_block}, true);
+            if (height > 0) {
+                auto& underground = layers.maskFor(biome->underground_block).data();
+                for (int y = 0; y < std::min(height, CHUNK_SIZE); y += step)
+                    underground[x + y * CHUNK_SIZE] |= bit;
             }
+
+            if (height >= 0 && height < CHUNK_SIZE && height % step == 0)
+                layers.maskFor(biome->surface_block).data()[x + height * CHUNK_SIZE] |= bit;
+
+            int water_begin = align(std::max(height + 1, 0));
+            if (water_begin <= water_end) {
+                auto& water = layers.maskFor(biome->water_block).data();
+                for (int y = water_begin; y <= water_end; y += step)
+                    water[x + y * CHUNK_SIZE] |= bit;
+            }
+        }
+
+    for (size_t i = 0; i < layers.used; i++) {
+        layers.masks[i].resetMask(layers.structure_mask);
+        chunk->setRows(layers.masks[i], {layers.types[i]}, true);
+    }
+
+    // Layers are created before their blocks are set, the layout is picked again once the content is known
+    chunk->selectLayout();
 }
 
 void WorldGenerator::Clear() {
-    getHeightMaps().clear();
+    std::lock_guard lock(structure_mutex);
+
+    height_maps.Clear();
     structures.clear();
 }
 
 void WorldGenerator::SetSeed(int seed) {
     this->seed = seed;
 
-    offset_random_engine    = std::make_unique<std::mt19937>(seed);
-    structure_random_engine = std::make_unique<std::mt19937>(seed);
+    offset_random_engine = std::make_unique<std::mt19937>(seed);
 
     SetupBiomeLayers();
-
-    for (auto& [name, layer] : noise_layers)
-        layer.noise.SetSeed(seed);
 }
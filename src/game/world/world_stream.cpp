@@ -1,44 +1,107 @@
 
 #include <game/world/world_stream.hpp>
 
-WorldStream::WorldStream(const std::shared_ptr<KeyedStorage<glm::ivec3>>& storage): record_store(storage){
+WorldStream::WorldStream(const std::shared_ptr<KeyedStorage<glm::ivec3>>& storage): queue(std::make_shared<SaveQueue>(storage)){
+    writer = std::thread(&WorldStream::RunWriter, this);
+}
+
+WorldStream::~WorldStream() {
+    Flush();
 
+    {
+        std::lock_guard lock(queue->pending_mutex);
+        queue->stopping = true;
+    }
+    queue->pending_available.notify_all();
+
+    writer.join();
 }
 
 glm::ivec3 WorldStream::GetSegmentPositionFor(const glm::ivec3& position) {
     return glm::floor(glm::vec3(position) / static_cast<float>(segment_size));
 }
 
-bool WorldStream::LoadSegment(const glm::ivec3& position) {
-    ByteArray array{};
-
+std::shared_ptr<WorldStream::SegmentPack> WorldStream::LoadSegment(const glm::ivec3& position, bool create) {
+    std::shared_ptr<SegmentPack> segment = nullptr;
+    std::unique_ptr<SegmentPack> pending = nullptr;
     {
-        std::unique_lock lock(record_mutex);
-        if (!record_store->Get(position, array.Vector())){
-            return false;
+        std::unique_lock lock(queue->pending_mutex);
+        // A segment that expired but isnt queued yet is waited for, so its changes are not missed. It is locked in the same
+        // check, it could expire right after a separate one and a second segment for the position would be created
+        queue->pending_written.wait(lock, [&]() {
+            if (queue->loading_positions.contains(position) || queue->writing_position == position)
+                return false;
+
+            auto live = queue->live_segments.find(position);
+            if (live == queue->live_segments.end())
+                return true;
+
+            segment = live->second.lock();
+            return segment != nullptr;
+        });
+
+        if (!segment) {
+            queue->loading_positions.insert(position);
+
+            // A segment that wasnt written yet is newer than the stored one
+            auto node = queue->pending_saves.extract(position);
+            if (node)
+                pending = std::move(node.mapped());
         }
     }
-    std::shared_ptr<SegmentPack> pack = InitSegment(position);
-    OctreeSerializer<Chunk>::Deserialize(pack->segment, array);
 
-    LoadSegmentToCache(position, std::move(pack));
+    // Still in use somewhere, even if it was evicted
+    if (segment) {
+        LoadSegmentToCache(position, segment);
+        return segment;
+    }
 
-    return true;
+    if (!pending) {
+        ByteArray array{};
+        bool stored = false;
+        {
+            // Gets of the record store can run in parallel, only saves need it exclusively
+            std::shared_lock lock(queue->record_mutex);
+            stored = queue->record_store->Get(position, array.Vector());
+        }
+
+        if (stored) {
+            pending = std::make_unique<SegmentPack>();
+            OctreeSerializer<Chunk>::Deserialize(pending->segment, array);
+        }
+        else if (create)
+            pending = std::make_unique<SegmentPack>();
+    }
+
+    if (pending)
+        segment = InitSegment(position, std::move(pending));
+
+    {
+        std::lock_guard lock(queue->pending_mutex);
+        if (segment)
+            queue->live_segments[position] = segment;
+
+        queue->loading_positions.erase(position);
+    }
+    queue->pending_written.notify_all();
+
+    if (segment)
+        LoadSegmentToCache(position, segment);
+
+    return segment;
 }
 
-void WorldStream::SaveSegment(const glm::ivec3& position, SegmentPack* segment) {
+void WorldStream::SaveSegment(SaveQueue& queue, const glm::ivec3& position, SegmentPack* segment) {
     ByteArray array{};
     OctreeSerializer<Chunk>::Serialize(segment->segment, array);
 
-    std::unique_lock lock(record_mutex);
-    record_store->Save(position, array.Size(), array.Data());
+    std::unique_lock lock(queue.record_mutex);
+    queue.record_store->Save(position, array.Size(), array.Data());
 }
 
 std::shared_ptr<WorldStream::SegmentPack> WorldStream::GetSegment(const glm::ivec3& position, bool set_in_use) {
-    std::shared_ptr<SegmentPack>* cached = nullptr;
-
-    std::shared_lock lock(record_mutex);
-    cached = segment_cache.Get(position);
+    // Copied under the cache lock, a pointer into the cache could be evicted and reused for another segment meanwhile
+    auto cached = segment_cache.GetCopy(position);
     if (!cached)
         return nullptr;
 
@@ -49,15 +112,88 @@ void WorldStream::LoadSegmentToCache(const glm::ivec3& position, std::shared_ptr
     segment_cache.Load(position, segment);
 }
 
-std::shared_ptr<WorldStream::SegmentPack> WorldStream::InitSegment(const glm::ivec3& position){
-    return std::shared_ptr<SegmentPack>(new SegmentPack(), [this,position](SegmentPack* pack){
-        SaveSegment(position, pack);
-        delete pack;
+std::shared_ptr<WorldStream::SegmentPack> WorldStream::InitSegment(const glm::ivec3& position, std::unique_ptr<SegmentPack> segment){
+    if (!segment)
+        segment = std::make_unique<SegmentPack>();
+
+    // Segments can be dropped on any thread, even after the stream is gone, the queue is only used while it exists
+    std::weak_ptr<SaveQueue> weak_queue = queue;
+    return std::shared_ptr<SegmentPack>(segment.release(), [weak_queue,position](SegmentPack* pack){
+        auto queue = weak_queue.lock();
+        if (queue)
+            QueueSave(*queue, position, pack);
+        else
+            delete pack;
     });
 }
 
-void WorldStream::CreateSegment(const glm::ivec3& position) {
-    LoadSegmentToCache(position, InitSegment(position));
+void WorldStream::QueueSave(SaveQueue& queue, const glm::ivec3& position, SegmentPack* segment) {
+    std::unique_lock lock(queue.pending_mutex);
+
+    if (queue.stopping) {
+        // No writer to hand it to, saved on this thread. Still under the lock so a load waits for it like for the writer
+        auto owned = std::unique_ptr<SegmentPack>(segment);
+        queue.live_segments.erase(position);
+        SaveSegment(queue, position, owned.get());
+        queue.pending_written.notify_all();
+        return;
+    }
+
+    queue.pending_written.wait(
+        lock, [&]() { return queue.pending_saves.size() < max_pending_saves || queue.pending_saves.contains(position); });
+
+    queue.live_segments.erase(position);
+    queue.pending_saves[position] = std::unique_ptr<SegmentPack>(segment);
+
+    queue.pending_available.notify_one();
+    queue.pending_written.notify_all(); // Wakes loads waiting for the segment to be queued
+}
+
+void WorldStream::RunWriter() {
+    while (true) {
+        glm::ivec3 position;
+        std::unique_ptr<SegmentPack> segment;
+
+        {
+            std::unique_lock lock(queue->pending_mutex);
+            queue->pending_available.wait(lock, [this]() { return !queue->pending_saves.empty() || queue->stopping; });
+
+            if (queue->pending_saves.empty())
+                return;
+
+            auto node = queue->pending_saves.extract(queue->pending_saves.begin());
+
+            position                = node.key();
+            segment                 = std::move(node.mapped());
+            queue->writing_position = position;
+        }
+
+        SaveSegment(*queue, position, segment.get());
+        segment = nullptr;
+
+        {
+            std::lock_guard lock(queue->pending_mutex);
+            queue->writing_position = std::nullopt;
+        }
+        queue->pending_written.notify_all();
+    }
+}
+
+void WorldStream::Flush() {
+    // Dropping the last reference queues the segment, which can block while the queue is full, so it happens after
+    // the cache lock is released. Segments still in use elsewhere are queued once they are dropped there
+    std::vector<std::shared_ptr<SegmentPack>> cached{};
+    segment_cache.Clear([&](auto, auto segment) { cached.push_back(std::move(segment)); });
+    cached.clear();
+
+    {
+        std::unique_lock lock(queue->pending_mutex);
+        queue->pending_written.wait(lock, [this]() { return queue->pending_saves.empty() && !queue->writing_position; });
+    }
+
+    // Every queued segment is written, commit them and their metadata to the disk
+    std::unique_lock lock(queue->record_mutex);
+    queue->record_store->Flush();
 }
 
 bool WorldStream::Save(std::unique_ptr<Chunk> chunk) {
@@ -68,12 +204,8 @@ bool WorldStream::Save(std::unique_ptr<Chunk> chunk) {
 
     auto segment_pack = GetSegment(segment_position, true);
 
-    if (!segment_pack) {
-        if (!LoadSegment(segment_position))
-            CreateSegment(segment_position);
-
-        segment_pack = GetSegment(segment_position, true);
-    }
+    if (!segment_pack)
+        segment_pack = LoadSegment(segment_position, true);
 
     if (!segment_pack) {
         LogError("Failed to load world segment.");
@@ -94,10 +226,11 @@ std::unique_ptr<Chunk> WorldStream::Load(const glm::ivec3& position) {
 
     auto segment_pack = GetSegment(segment_position, true);
 
-    if (!segment_pack) {
-        if (!LoadSegment(segment_position)) return nullptr;
-        segment_pack = GetSegment(segment_position, true);
-    }
+    if (!segment_pack)
+        segment_pack = LoadSegment(segment_position);
+
+    if (!segment_pack)
+        return nullptr;
 
     std::unique_ptr<Chunk> chunk = nullptr;
     {
@@ -113,10 +246,11 @@ bool WorldStream::HasChunkAt(const glm::ivec3& position) {
 
     auto segment_pack = GetSegment(segment_position, true);
 
-    if (!segment_pack) {
-        if (!LoadSegment(segment_position)) return false;
-        segment_pack = GetSegment(segment_position, true);
-    }
+    if (!segment_pack)
+        segment_pack = LoadSegment(segment_position);
+
+    if (!segment_pack)
+        return false;
 
     glm::ivec3 internal_position = position - segment_position * segment_size;
     bool result = false;
@@ -1,52 +1,67 @@
 #include <rendering/instanced_mesh.hpp>
 
-static MultilevelPool<float> mesh_pool{};
-
-InstancedMesh::InstancedMesh() : instance_data() {
-    for (auto& element : instance_data)
-        element = std::make_unique<MultilevelPool<float>::List>(mesh_pool.Next(64));
+InstancedMesh::InstancedMesh() {}
+
+static inline PackedFace PackInstance(const glm::ivec3& position,
+                                      float width,
+                                      float height,
+                                      int texture_index,
+                                      MeshInterface::FaceType type,
+                                      MeshInterface::Direction direction,
+                                      const std::array<int, 4>& occlusion) {
+    return PackedFace::Pack({position, static_cast<int>(width), static_cast<int>(height), texture_index, type, direction, occlusion});
 }
-void InstancedMesh::addQuadFace(const glm::ivec3& position_, float width, float height, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position) {
-    glm::vec3 position = world_position + glm::vec3(position_);
-    
-    std::array<float, InstancedMesh::instance_data_size> data = {
-        position.x,
-        position.y,
-        position.z,
 
-        width,
-        height,
+static inline std::array<int, 4> OcclusionToInt(const std::array<float, 4>& occlusion) {
+    return {static_cast<int>(occlusion[0]), static_cast<int>(occlusion[1]), static_cast<int>(occlusion[2]), static_cast<int>(occlusion[3])};
+}
 
-        static_cast<float>(type),
-        static_cast<float>(direction),
-        static_cast<float>(texture_index),
+void InstancedMesh::addQuadFace(const glm::ivec3& position, float width, float height, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position) {
+    // The world position is not stored, the loader supplies the chunk origin with every draw call
+    PackedFace face = PackInstance(position, width, height, texture_index, type, direction, OcclusionToInt(occlusion));
 
-        occlusion[0],
-        occlusion[1],
-        occlusion[3], // Swapped because of how occlusion is calculated, this changes clockwise order from the top left into one for
-                      // GL_TRIGNALE_STRIP
-        occlusion[2]};
+    auto& instance_data_list = instance_data.at(type);
+    instance_data_list.push_back(face.first);
+    instance_data_list.push_back(face.second);
+}
 
+void InstancedMesh::emitFaces(std::span<const QuadFace> faces, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position) {
     auto& instance_data_list = instance_data.at(type);
-    for (auto& value : data)
-        instance_data_list->Push(value);
+    auto occlusion_values    = OcclusionToInt(occlusion);
+
+    size_t start = instance_data_list.size();
+    instance_data_list.resize(start + faces.size() * instance_data_size);
+
+    uint32_t* output = instance_data_list.data() + start;
+    for (auto& face : faces) {
+        PackedFace packed = PackInstance(face.position, face.width, face.height, texture_index, type, direction, occlusion_values);
+        *output++ = packed.first;
+        *output++ = packed.second;
+    }
 }
 
 void InstancedMesh::preallocate(size_t size, FaceType type) {
-    if (size != 0 && size > instance_data.at(type)->Size())
-        instance_data.at(type)->Resize((size + 1) * instance_data_size);
+    auto& instance_data_list = instance_data.at(type);
+
+    // Keep growing geometrically, reserving the exact size for every small batch would copy the data every time
+    size_t required = instance_data_list.size() + size * instance_data_size;
+    if (required > instance_data_list.capacity())
+        instance_data_list.reserve(std::max(required, instance_data_list.capacity() * 2));
 }
-const MultilevelPool<float>::List& InstancedMesh::getInstanceData(FaceType type) {
-    return *instance_data[type];
+
+bool InstancedMesh::appendPacked(std::span<const uint32_t> data, FaceType type) {
+    auto& instance_data_list = instance_data.at(type);
+    instance_data_list.insert(instance_data_list.end(), data.begin(), data.end());
+    return true;
+}
+
+const std::vector<uint32_t>& InstancedMesh::getInstanceData(FaceType type) {
+    return instance_data[type];
 }
 
 bool InstancedMesh::empty() {
-    for (int i = 0; i < 4; i++) {
-        if (instance_data.size() == 0)
-            continue;
-        return false;
-    }
-    return true;
+    // Never reported as empty, RegionCuller skips empty meshes and an edit that removes every face still has to replace the old mesh
+    return false;
 }
 
 void InstancedMesh::shrink() {
@@ -168,10 +183,7 @@ InstancedMeshLoader::InstancedMeshLoader() {
 
     loaded_face_buffer.initialize(aligned_quad_data.size(), aligned_quad_data.data());
 
-    for (auto& info : render_information) {
-        info.vao.attachBuffer(&info.instance_data.getBuffer(), {{VEC3, VEC2, FLOAT, FLOAT, FLOAT, VEC4}, true});
-        info.vao.attachBuffer(&loaded_face_buffer, {VEC3, VEC2});
-    }
+    vao.attachBuffer(&loaded_face_buffer, {VEC3, VEC2});
 }
 
 void InstancedMeshLoader::LoadedMesh::destroy() {
@@ -194,41 +206,10 @@ void InstancedMeshLoader::LoadedMesh::update(MeshInterface* mesh_) {
     creator.updateMesh(*this, mesh);
 }
 
-void InstancedMeshLoader::LoadedMesh::render() {
-    if (!valid)
-        throw std::logic_error("Cannot render destroyed mesh.");
-    creator.renderMesh(*this);
-}
-
 void InstancedMeshLoader::LoadedMesh::addDrawCall(const glm::ivec3& position) {
     if (!valid)
         throw std::logic_error("Cannot add draw call of destroyed mesh.");
-    creator.addDrawCall(*this);
-}
-void InstancedMeshLoader::renderMesh(LoadedMesh& mesh) {
-    std::lock_guard lock(loading_mutex);
-
-    for (size_t i = 0; i < distinct_face_count; i++) {
-        render_information[i].vao.bind();
-
-        size_t instances_total = mesh.loaded_regions[i]->size / InstancedMesh::instance_data_size;
-        size_t instance_offset = mesh.loaded_regions[i]->start / InstancedMesh::instance_data_size;
-
-        glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP,
-                                          4 * i, // Offset in the buffer
-                                          4,
-                                          instances_total,
-                                          instance_offset);
-
-        if (i == 3) { // Draw the seconds diagonal
-            glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP,
-                                              4 * (i + 1), // Offset in the buffer
-                                              4,
-                                              instances_total,
-                                              instance_offset);
-        }
-        render_information[i].vao.unbind();
-    }
+    creator.addDrawCall(*this, position);
 }
 
 std::unique_ptr<LoadedMeshInterface> InstancedMeshLoader::loadMesh(MeshInterface* mesh_) {
@@ -243,12 +224,12 @@ std::unique_ptr<LoadedMeshInterface> InstancedMeshLoader::loadMesh(MeshInterface
 
     for (size_t i = 0; i < distinct_face_count; i++) {
         auto& component_data = mesh.getInstanceData(static_cast<InstancedMesh::FaceType>(i));
-        if (component_data.Size() == 0) {
+        if (component_data.size() == 0) {
             loaded_mesh->has_region[i] = false;
             continue;
         }
 
-        loaded_mesh->loaded_regions[i] = render_information[i].instance_data.append(component_data.Data(), component_data.Size());
+        loaded_mesh->loaded_regions[i] = render_information[i].instance_data.append(component_data.data(), component_data.size());
         loaded_mesh->has_region[i]     = true;
 
         render_information[i].instance_data.flush();
@@ -259,9 +240,11 @@ std::unique_ptr<LoadedMeshInterface> InstancedMeshLoader::loadMesh(MeshInterface
     return loaded_mesh;
 }
 
-void InstancedMeshLoader::addDrawCall(LoadedMesh& mesh) {
+void InstancedMeshLoader::addDrawCall(LoadedMesh& mesh, const glm::ivec3& position) {
     std::lock_guard lock(draw_call_mutex);
 
+    glm::ivec4 origin = {position, 0}; // In chunks
+
     for (size_t i = 0; i < distinct_face_count; i++) {
         if (!mesh.has_region[i])
             continue;
@@ -277,9 +260,11 @@ void InstancedMeshLoader::addDrawCall(LoadedMesh& mesh) {
         };
 
         render_information[i].draw_call_buffer.push(draw_call);
+        render_information[i].origins.push_back(origin);
         if (i == 3) { // Draw the seconds diagonal
             draw_call.first += 4;
             render_information[i].draw_call_buffer.push(draw_call);
+            render_information[i].origins.push_back(origin);
         }
     }
 }
@@ -289,16 +274,21 @@ void InstancedMeshLoader::updateMesh(LoadedMesh& loaded_mesh, InstancedMesh& new
 
     for (size_t i = 0; i < distinct_face_count; i++) {
         auto& component_data = new_mesh.getInstanceData(static_cast<InstancedMesh::FaceType>(i));
-        if (component_data.Size() == 0) {
+        if (component_data.size() == 0) {
+            if (loaded_mesh.has_region[i]) {
+                render_information[i].instance_data.remove(loaded_mesh.loaded_regions[i]);
+                updated = true;
+            }
+
             loaded_mesh.has_region[i] = false;
             continue;
         }
 
         if (loaded_mesh.has_region[i])
             loaded_mesh.loaded_regions[i] = render_information[i].instance_data.update(
-                loaded_mesh.loaded_regions[i], component_data.Data(), component_data.Size());
+                loaded_mesh.loaded_regions[i], component_data.data(), component_data.size());
         else
-            loaded_mesh.loaded_regions[i] = render_information[i].instance_data.append(component_data.Data(), component_data.Size());
+            loaded_mesh.loaded_regions[i] = render_information[i].instance_data.append(component_data.data(), component_data.size());
 
         loaded_mesh.has_region[i] = true;
 
@@ -326,16 +316,23 @@ void InstancedMeshLoader::render() {
     if (draw_failed)
         return;
 
-    shared_program.updateUniforms();
+    vao.bind();
 
     for (auto& info : render_information) {
-        info.vao.bind();
+        if (info.draw_call_buffer.count() == 0 || info.instance_data.size() == 0)
+            continue;
+
+        info.instance_data.getBuffer().bindBase(1);
+        info.origin_buffer.bindBase(0);
         info.draw_call_buffer.bind();
 
         while (true) {
             bool found_error = false;
 
             for (size_t i = 0; i < info.draw_call_buffer.count(); i += max_draw_calls) {
+                draw_offset_uniform = i; // gl_DrawID restarts with every batch
+                shared_program.updateUniforms();
+
                 glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP,
                                           (const void*)(i * sizeof(GLDrawCallBuffer::DrawCommand)),
                                           std::min(static_cast<uint>(info.draw_call_buffer.count() - i), max_draw_calls),
@@ -361,16 +358,18 @@ void InstancedMeshLoader::render() {
 
             max_draw_calls /= 2;
         }
-
-        info.vao.unbind();
     }
+
+    vao.unbind();
 }
 
 void InstancedMeshLoader::clearDrawCalls() {
     std::lock_guard lock(draw_call_mutex);
     
-    for (auto& info : render_information)
+    for (auto& info : render_information) {
         info.draw_call_buffer.clear();
+        info.origins.clear();
+    }
 }
 
 void InstancedMeshLoader::flushDrawCalls() {
@@ -379,6 +378,8 @@ void InstancedMeshLoader::flushDrawCalls() {
     for (auto& info : render_information) {
         // std::cout << "Flushed draw calls: " << info.draw_call_buffer.count() << std::endl;
         info.draw_call_buffer.flush();
+        if (!info.origins.empty())
+            info.origin_buffer.insert_or_resize(reinterpret_cast<int32_t*>(info.origins.data()), info.origins.size() * 4);
         if (updated)
             info.instance_data.flush();
     }
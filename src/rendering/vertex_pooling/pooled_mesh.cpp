@@ -1,6 +1,6 @@
 #include <rendering/vertex_pooling/pooled_mesh.hpp>
 
-void PooledMesh::addQuadFace(const glm::ivec3& position, float width, float height, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position){
+static inline uint32_t PackFirstPortion(const glm::ivec3& position, float width, float height, MeshInterface::Direction direction){
     uint32_t first_portion = 0;
 
     if(position.x > 63 || position.z > 63) std::cout << "Uhh oh!" << position.x << " " << position.y << " " << position.z << std::endl;
@@ -14,17 +14,43 @@ void PooledMesh::addQuadFace(const glm::ivec3& position, float width, float heig
 
     first_portion |= (0b1 & direction) << 31;
 
+    return first_portion;
+}
+
+static inline uint32_t PackSecondPortion(int texture_index, const std::array<float, 4>& occlusion){
     uint32_t second_portion = 0;
     for(int i = 0;i < 4;i++)
         second_portion |= (static_cast<unsigned int>(occlusion[i]) & 0b11) << (i * 2);
     
     second_portion |= (static_cast<unsigned int>(texture_index) & 0xFFFFFF) << 8;
 
-    data.Push(type, std::vector<uint32_t>{first_portion, second_portion});
+    return second_portion;
+}
+
+void PooledMesh::addQuadFace(const glm::ivec3& position, float width, float height, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position){
+    uint32_t* output = data.Extend(type, face_size);
+
+    output[0] = PackFirstPortion(position, width, height, direction);
+    output[1] = PackSecondPortion(texture_index, occlusion);
+}
+
+void PooledMesh::emitFaces(std::span<const QuadFace> faces, int texture_index, FaceType type, Direction direction, const std::array<float, 4>& occlusion, const glm::vec3& world_position){
+    uint32_t* output = data.Extend(type, faces.size() * face_size);
+
+    // Shared by the whole batch
+    uint32_t second_portion = PackSecondPortion(texture_index, occlusion);
+
+    for(auto& face: faces){
+        *output++ = PackFirstPortion(face.position, face.width, face.height, direction);
+        *output++ = second_portion;
+    }
 }
 
 void PooledMesh::preallocate(size_t size, FaceType type){
-    data.Reserve(type,size);
+    auto& list = data.Get(type);
+
+    size_t required = list.size() + size * face_size;
+    if(required > list.capacity()) data.Reserve(type, std::max(required, list.capacity() * 2));
 }
 
 bool PooledMesh::empty(){
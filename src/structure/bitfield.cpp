@@ -46,6 +46,32 @@ uint64_t BitField::getRow(uint x, uint y) {
     return _internal_data[calculateIndex(x, y)];
 }
 
+bool BitField::setRowMask(uint x, uint y, uint64_t mask) {
+    if (!inBounds(x, y))
+        return false;
+
+    _internal_data[calculateIndex(x, y)] |= mask;
+    return true;
+}
+
+bool BitField::resetRowMask(uint x, uint y, uint64_t mask) {
+    if (!inBounds(x, y))
+        return false;
+
+    _internal_data[calculateIndex(x, y)] &= ~mask;
+    return true;
+}
+
+void BitField::setMask(const BitField& mask) {
+    for (int i = 0; i < 64 * 64; i++)
+        _internal_data[i] |= mask._internal_data[i];
+}
+
+void BitField::resetMask(const BitField& mask) {
+    for (int i = 0; i < 64 * 64; i++)
+        _internal_data[i] &= ~mask._internal_data[i];
+}
+
 void BitField::fill(bool value) {
 
     uint64_t segment = value ? ~0ULL : 0ULL;
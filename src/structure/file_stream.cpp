@@ -1,44 +1,166 @@
 #include <structure/streams/file_stream.hpp>
 
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 FileStream::FileStream(const Callback& init, const Callback& load) : init(init), load(load) {
 
 }
 
+FileStream::~FileStream() {
+    Close();
+}
+
 bool FileStream::Read(size_t offset, size_t size, byte* buffer) {
-    std::lock_guard lock(mutex);
+    std::shared_lock lock(mapping_mutex);
 
     if (offset + size > Size())
         return false;
 
-    stream.seekg(offset, std::ios::beg);
-    stream.read(reinterpret_cast<char*>(buffer), size);
-    if (stream.fail()){
-        LogError("Failed to read from filestream: {} Error: {}", this->path.string(), strerror(errno));
-        return false;
-    }
-
+    if (size != 0)
+        std::memcpy(buffer, mapping + offset, size);
 
     return true;
 }
+
 bool FileStream::Write(size_t offset, size_t size, const byte* buffer) {
-    std::lock_guard lock(mutex);
+    if (size == 0)
+        return true;
 
-    stream.seekp(offset, std::ios::beg);
-    stream.write(reinterpret_cast<const char*>(buffer), size);
+    auto write = [&]() {
+        std::memcpy(mapping + offset, buffer, size);
 
-    if (offset + size > filesize)
-        filesize = offset + size;
+        size_t current = filesize.load();
+        while (offset + size > current && !filesize.compare_exchange_weak(current, offset + size)) {}
+    };
 
-    if (stream.fail()){
-        LogError("Failed to write to filestream: {} Error: {}", this->path.string(), strerror(errno));
+    {
+        std::shared_lock lock(mapping_mutex);
+        if (offset + size <= mapped_size) {
+            write();
+            return true;
+        }
+    }
+
+    std::unique_lock lock(mapping_mutex);
+    if (offset + size > mapped_size && !Remap(offset + size)) {
+        LogError("Failed to grow filestream: {} Error: {}", this->path.string(), strerror(errno));
         return false;
     }
 
+    write();
     return true;
 }
 
 size_t FileStream::Size() {
-    return filesize;
+    return filesize.load();
+}
+
+bool FileStream::Flush() {
+    std::shared_lock lock(mapping_mutex);
+
+    if (!mapping)
+        return true;
+
+#ifdef _WIN32
+    bool result = FlushViewOfFile(mapping, 0) && FlushFileBuffers(file);
+#else
+    bool result = msync(mapping, mapped_size, MS_SYNC) == 0;
+#endif
+
+    if (!result)
+        LogError("Failed to flush filestream: {} Error: {}", this->path.string(), strerror(errno));
+
+    return result;
+}
+
+bool FileStream::Remap(size_t size) {
+    return Map(std::max({size, mapped_size * 2, minimal_mapping_size}));
+}
+
+bool FileStream::Map(size_t new_size) {
+    Unmap();
+
+#ifdef _WIN32
+    // Mapping a larger size than the file has grows the file
+    file_mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(new_size >> 32),
+                                      static_cast<DWORD>(new_size & 0xFFFFFFFF), nullptr);
+    if (!file_mapping)
+        return false;
+
+    mapping = reinterpret_cast<byte*>(MapViewOfFile(file_mapping, FILE_MAP_ALL_ACCESS, 0, 0, new_size));
+    if (!mapping) {
+        CloseHandle(file_mapping);
+        file_mapping = nullptr;
+        return false;
+    }
+#else
+    if (ftruncate(file, new_size) != 0)
+        return false;
+
+    void* result = mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (result == MAP_FAILED)
+        return false;
+
+    mapping = reinterpret_cast<byte*>(result);
+#endif
+
+    mapped_size = new_size;
+    return true;
+}
+
+void FileStream::Unmap() {
+    if (!mapping)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+    CloseHandle(file_mapping);
+    file_mapping = nullptr;
+#else
+    munmap(mapping, mapped_size);
+#endif
+
+    mapping     = nullptr;
+    mapped_size = 0;
+}
+
+void FileStream::Close() {
+    std::unique_lock lock(mapping_mutex);
+
+    Unmap();
+
+    // The file was grown together with the mapping, cut off the unused part
+#ifdef _WIN32
+    if (!file)
+        return;
+
+    LARGE_INTEGER end{};
+    end.QuadPart = static_cast<LONGLONG>(filesize.load());
+    SetFilePointerEx(file, end, nullptr, FILE_BEGIN);
+    SetEndOfFile(file);
+
+    CloseHandle(file);
+    file = nullptr;
+#else
+    if (file == -1)
+        return;
+
+    if (ftruncate(file, filesize.load()) != 0)
+        LogError("Failed to truncate filestream: {} Error: {}", this->path.string(), strerror(errno));
+
+    close(file);
+    file = -1;
+#endif
 }
 
 void FileStream::SetCallbacks(const Callback& init, const Callback& load) {
@@ -49,9 +171,11 @@ void FileStream::SetCallbacks(const Callback& init, const Callback& load) {
 bool FileStream::Open(const fs::path& path) {
     bool newlyCreated = false;
 
+    Close();
+
     this->path = path;
     {
-        std::lock_guard lock(mutex);
+        std::unique_lock lock(mapping_mutex);
 
         fs::path dir_path = path.parent_path();
 
@@ -62,23 +186,35 @@ bool FileStream::Open(const fs::path& path) {
             }
         }
 
-        if (!fs::exists(path)) {
-            std::ofstream file(path, std::ios::binary);
-            if (!file.is_open()) {
-                LogError("Failed to create path for: {} Error: {}", this->path.string(), strerror(errno));
-                throw std::logic_error("Failed to create required path.");
-            }
-            file.close();
-            newlyCreated = true;
+        newlyCreated = !fs::exists(path);
+
+#ifdef _WIN32
+        HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            LogError("Failed to open filestream: {} Error: {}", this->path.string(), GetLastError());
+            return false;
+        }
+        file = handle;
+
+        LARGE_INTEGER size{};
+        GetFileSizeEx(handle, &size);
+        filesize = static_cast<size_t>(size.QuadPart);
+#else
+        file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (file == -1) {
+            LogError("Failed to open filestream: {} Error: {}", this->path.string(), strerror(errno));
+            return false;
         }
 
-        stream = std::fstream(path, std::ios::out | std::ios::in | std::ios::binary);
-        stream.seekg(0, std::ios::end); // Move to the end of the file
-        filesize = stream.tellg();
-        stream.seekg(0, std::ios::beg); // Move back
+        struct stat file_stat{};
+        fstat(file, &file_stat);
+        filesize = static_cast<size_t>(file_stat.st_size);
+#endif
 
-        if (!stream.is_open()){
-            LogError("Failed to open filestream: {} Error: {}", this->path.string(), strerror(errno));
+        // Only the existing contents are mapped, files that are just read never grow. Empty files are mapped on the first write
+        if (filesize > 0 && !Map(filesize)) {
+            LogError("Failed to map filestream: {} Error: {}", this->path.string(), strerror(errno));
             return false;
         }
     }
@@ -0,0 +1,61 @@
+#include <structure/palette_array.hpp>
+
+#include <algorithm>
+#include <bit>
+
+void PaletteIndexArray::widen(uint32_t new_shift) {
+    if (words.empty()) {
+        width_shift = new_shift;
+        words.assign((entry_count << width_shift) / 64, 0);
+        return;
+    }
+
+    std::vector<uint64_t> old_words(std::move(words));
+    uint32_t old_shift = width_shift;
+
+    width_shift = new_shift;
+    words.assign((entry_count << width_shift) / 64, 0);
+
+    uint32_t old_per_word_shift = 6 - old_shift;
+    uint64_t old_mask           = (1ULL << (1U << old_shift)) - 1;
+
+    for (size_t i = 0; i < old_words.size(); i++) {
+        uint64_t word = old_words[i];
+        if (word == 0)
+            continue;
+
+        size_t first = i << old_per_word_shift;
+        for (size_t j = 0; j < (1ULL << old_per_word_shift); j++)
+            set(first + j, (word >> (j << old_shift)) & old_mask);
+    }
+}
+
+void PaletteIndexArray::reserve(uint32_t max_value) {
+    uint32_t bits = std::max<uint32_t>(std::bit_width(max_value), 1);
+
+    uint32_t shift = std::bit_width(bits - 1);
+    if (shift > 4)
+        shift = 4; // Chunks never have more than 65535 types, it would not fit a BlockID worth of palette anyway
+
+    if (words.empty() || shift > width_shift)
+        widen(std::max(shift, width_shift));
+}
+
+void PaletteIndexArray::setMasked(size_t row, uint64_t mask, uint32_t value) {
+    if (mask == 0)
+        return;
+
+    reserve(value);
+
+    while (mask != 0) {
+        int z = std::countl_zero(mask);
+        set((row << 6) | z, value);
+        mask &= ~(1ULL << (63 - z));
+    }
+}
+
+void PaletteIndexArray::clear() {
+    words.clear();
+    words.shrink_to_fit();
+    width_shift = 0;
+}
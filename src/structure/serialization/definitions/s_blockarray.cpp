@@ -5,17 +5,32 @@
     BlockArray serialization
 */
 #include <blockarray.hpp>
+#include <structure/serialization/field_codec.hpp>
+#include <structure/synchronization/threadlocal.hpp>
+
+static ThreadLocal<FieldCodec::Rows> rows_threadlocal{};
+
+static void encodeField(CompressedBitField3D& field, ByteArray& array){
+    auto& rows = rows_threadlocal.Get();
+    auto compressed = field.getCompressed();
+
+    rows.fill(0);
+    BitField3D::decompress(rows, compressed);
+    FieldCodec::encode(rows, array);
+}
 
 SerializeFunction(SparseBlockArray) {
+    array.Append<uint8_t>(FieldCodec::format_version);
+
     array.Append<bool>(this_.isEmpty());
     if(this_.isEmpty()) return true;
 
-    array.Append(this_.solid_field.getCompressed());
+    encodeField(this_.solid_field, array);
     array.Append<size_t>(this_.layers.size());
 
     for(auto& layer: this_.layers){
         array.Append<BlockID>(layer.type);
-        array.Append(layer._field.getCompressed());
+        encodeField(layer._field, array);
     }
 
     array.Append<size_t>(this_.interactable_blocks.size());
@@ -35,21 +50,45 @@ SerializeFunction(SparseBlockArray) {
 SerializeInstatiate(SparseBlockArray)
 
 DeserializeFunction(SparseBlockArray){
-    ResolvedOption(is_empty, Read<bool>)
+    // Block arrays saved before the field codec start with the empty flag right away
+    ResolvedOption(version, Read<uint8_t>)
+    if(version > FieldCodec::format_version) return false;
+
+    bool legacy = version < FieldCodec::format_version;
+    bool is_empty = version == 1;
+
+    if(!legacy){
+        ResolvedOption(empty_flag, Read<bool>)
+        is_empty = empty_flag;
+    }
     if(is_empty) return true;
 
-    ResolvedOption(solid_data, ReadVector<uint64_t>)
+    auto& rows = rows_threadlocal.Get();
 
-    BitField3D::decompress(this_.getSolidField().data(), solid_data);
+    if(legacy){
+        ResolvedOption(solid_data, ReadVector<uint64_t>)
+        BitField3D::decompress(this_.getSolidField().data(), solid_data);
+    }
+    else{
+        if(!FieldCodec::decode(array, rows)) return false;
+        this_.getSolidField().data() = rows;
+    }
 
     ResolvedOption(layer_count, Read<size_t>);
 
     for(size_t i = 0;i < layer_count;i++){
         ResolvedOption(layer_type, Read<BlockID>);
-        ResolvedOption(data, ReadVector<uint64_t>);
 
         BitField3D field{};
-        BitField3D::decompress(field.data(), data);
+        if(legacy){
+            ResolvedOption(data, ReadVector<uint64_t>);
+            BitField3D::decompress(field.data(), data);
+        }
+        else{
+            if(!FieldCodec::decode(array, rows)) return false;
+            field.data() = rows;
+        }
+
         this_.createLayer(layer_type, field);
     }
 
@@ -0,0 +1,477 @@
+#include <structure/serialization/field_codec.hpp>
+
+#include <bitarray.hpp>
+#include <structure/bitworks.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+const static size_t total_bits = 64 * 64 * 64;
+
+static void writeVarint(std::vector<uint8_t>& output, uint64_t value) {
+    while (value >= 0x80) {
+        output.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+static bool readVarint(const std::vector<uint8_t>& input, size_t& cursor, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (cursor >= input.size())
+            return false;
+
+        uint8_t part = input[cursor++];
+        value |= static_cast<uint64_t>(part & 0x7F) << shift;
+        if ((part & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+/*
+    Axis orders, the rows are rearranged so the bits of every row go along the axis
+*/
+static void toAxisOrder(const FieldCodec::Rows& rows, int axis, FieldCodec::Rows& output) {
+    if (axis == 1) {
+        // Every x slice is a matrix of y rows of z bits, transposed its z rows of y bits
+        std::array<uint64_t, 64> slice{};
+        for (int x = 0; x < 64; x++) {
+            for (int y = 0; y < 64; y++)
+                slice[y] = rows[x + y * 64];
+
+            transpose_bit_matrix_64(slice.data());
+            std::copy(slice.begin(), slice.end(), output.begin() + x * 64);
+        }
+        return;
+    }
+
+    output = rows;
+    if (axis == 0)
+        for (int y = 0; y < 64; y++)
+            transpose_bit_matrix_64(output.data() + y * 64);
+}
+
+static void fromAxisOrder(FieldCodec::Rows& stream, int axis, FieldCodec::Rows& rows) {
+    if (axis == 1) {
+        std::array<uint64_t, 64> slice{};
+        for (int x = 0; x < 64; x++) {
+            std::copy(stream.begin() + x * 64, stream.begin() + x * 64 + 64, slice.begin());
+            transpose_bit_matrix_64(slice.data());
+
+            for (int y = 0; y < 64; y++)
+                rows[x + y * 64] = slice[y];
+        }
+        return;
+    }
+
+    rows = stream;
+    if (axis == 0)
+        for (int y = 0; y < 64; y++)
+            transpose_bit_matrix_64(rows.data() + y * 64);
+}
+
+// Sets a range of bits in a stream of rows, bits go from the highest bit of the first row
+static void setBits(uint64_t* rows, size_t start, size_t length) {
+    while (length > 0) {
+        size_t offset = start % 64;
+        size_t count  = std::min<size_t>(64 - offset, length);
+
+        uint64_t mask = count == 64 ? ~0ULL : ((1ULL << count) - 1) << (64 - offset - count);
+        rows[start / 64] |= mask;
+
+        start += count;
+        length -= count;
+    }
+}
+
+void FieldCodec::encodeAxisRuns(const Rows& rows, int axis, std::vector<uint8_t>& output) {
+    Rows stream{};
+    toAxisOrder(rows, axis, stream);
+
+    output.reserve(output.size() + sizeof(Rows) / 4);
+
+    bool value = (stream[0] >> 63) & 1;
+    output.push_back(value);
+
+    uint64_t run = 0;
+    for (uint64_t row : stream) {
+        int remaining = 64;
+
+        while (remaining > 0) {
+            // Leading zeros of the row flipped to the current value are the length of the run inside it
+            uint64_t same_bits = value ? ~row : row;
+            int same           = std::countl_zero(same_bits);
+
+            if (same >= remaining) {
+                run += remaining;
+                break;
+            }
+
+            run += same;
+            writeVarint(output, run);
+
+            run   = 0;
+            value = !value;
+            row <<= same;
+            remaining -= same;
+        }
+    }
+
+    writeVarint(output, run);
+}
+
+bool FieldCodec::decodeAxisRuns(const std::vector<uint8_t>& input, int axis, Rows& rows) {
+    if (input.empty() || axis > 2)
+        return false;
+
+    Rows stream{};
+
+    bool value    = input[0] != 0;
+    size_t cursor = 1;
+    size_t bit    = 0;
+
+    while (bit < total_bits) {
+        uint64_t run = 0;
+        if (!readVarint(input, cursor, run) || run > total_bits - bit)
+            return false;
+
+        if (value)
+            setBits(stream.data(), bit, run);
+
+        bit += run;
+        value = !value;
+    }
+
+    if (cursor != input.size())
+        return false;
+
+    fromAxisOrder(stream, axis, rows);
+    return true;
+}
+
+void FieldCodec::encodeRowRuns(const Rows& rows, std::vector<uint8_t>& output) {
+    for (size_t i = 0; i < rows.size();) {
+        size_t end = i + 1;
+        while (end < rows.size() && rows[end] == rows[i])
+            end++;
+
+        writeVarint(output, end - i);
+
+        size_t position = output.size();
+        output.resize(position + sizeof(uint64_t));
+        std::memcpy(output.data() + position, &rows[i], sizeof(uint64_t));
+
+        i = end;
+    }
+}
+
+bool FieldCodec::decodeRowRuns(const std::vector<uint8_t>& input, Rows& rows) {
+    size_t cursor = 0;
+
+    for (size_t i = 0; i < rows.size();) {
+        uint64_t count = 0;
+        if (!readVarint(input, cursor, count) || count == 0 || count > rows.size() - i)
+            return false;
+
+        if (cursor + sizeof(uint64_t) > input.size())
+            return false;
+
+        uint64_t row = 0;
+        std::memcpy(&row, input.data() + cursor, sizeof(uint64_t));
+        cursor += sizeof(uint64_t);
+
+        std::fill(rows.begin() + i, rows.begin() + i + count, row);
+        i += count;
+    }
+
+    return cursor == input.size();
+}
+
+/*
+    A small LZ77 in the style of LZ4, sequences of a token (literal count, match length), the literals,
+    a two byte offset and the rest of the match length. The last sequence only has literals.
+*/
+const static size_t lz_min_match   = 4;
+const static size_t lz_max_offset  = 0xFFFF;
+const static int lz_hash_bits      = 12;
+const static int lz_skip_shift     = 6;
+
+static uint32_t read32(const uint8_t* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(uint32_t));
+    return value;
+}
+
+static void writeSequence(std::vector<uint8_t>& output, const uint8_t* literals, size_t literal_count, size_t offset,
+                          size_t match_length) {
+    size_t match_rest = match_length >= lz_min_match ? match_length - lz_min_match : 0;
+
+    uint8_t token = static_cast<uint8_t>(std::min<size_t>(literal_count, 15) << 4);
+    if (match_length != 0)
+        token |= static_cast<uint8_t>(std::min<size_t>(match_rest, 15));
+
+    output.push_back(token);
+    if (literal_count >= 15)
+        writeVarint(output, literal_count - 15);
+
+    output.insert(output.end(), literals, literals + literal_count);
+
+    if (match_length == 0)
+        return;
+
+    output.push_back(static_cast<uint8_t>(offset));
+    output.push_back(static_cast<uint8_t>(offset >> 8));
+    if (match_rest >= 15)
+        writeVarint(output, match_rest - 15);
+}
+
+void FieldCodec::compressLZ(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
+    output.reserve(output.size() + input.size() + input.size() / 255 + 16);
+    writeVarint(output, input.size());
+
+    std::array<int32_t, 1 << lz_hash_bits> table;
+    table.fill(-1);
+
+    size_t anchor = 0;
+    size_t i      = 0;
+
+    while (i + lz_min_match <= input.size()) {
+        uint32_t sequence = read32(input.data() + i);
+        uint32_t hash     = (sequence * 2654435761U) >> (32 - lz_hash_bits);
+
+        int32_t candidate = table[hash];
+        table[hash]       = static_cast<int32_t>(i);
+
+        if (candidate < 0 || i - candidate > lz_max_offset || read32(input.data() + candidate) != sequence) {
+            // Like LZ4, the search steps faster the longer nothing was found, so incompressible data passes quickly
+            i += 1 + ((i - anchor) >> lz_skip_shift);
+            continue;
+        }
+
+        size_t length = lz_min_match;
+        while (i + length < input.size() && input[candidate + length] == input[i + length])
+            length++;
+
+        writeSequence(output, input.data() + anchor, i - anchor, i - candidate, length);
+
+        i += length;
+        anchor = i;
+    }
+
+    if (anchor < input.size())
+        writeSequence(output, input.data() + anchor, input.size() - anchor, 0, 0);
+}
+
+bool FieldCodec::decompressLZ(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
+    size_t cursor = 0;
+    uint64_t size = 0;
+    if (!readVarint(input, cursor, size) || size > total_bits * 2)
+        return false;
+
+    output.clear();
+    output.reserve(size);
+
+    while (output.size() < size) {
+        if (cursor >= input.size())
+            return false;
+
+        uint8_t token = input[cursor++];
+
+        uint64_t literal_count = token >> 4;
+        if (literal_count == 15) {
+            uint64_t rest = 0;
+            if (!readVarint(input, cursor, rest))
+                return false;
+            literal_count += rest;
+        }
+
+        if (literal_count > input.size() - cursor || literal_count > size - output.size())
+            return false;
+
+        output.insert(output.end(), input.begin() + cursor, input.begin() + cursor + literal_count);
+        cursor += literal_count;
+
+        if (output.size() == size)
+            break;
+
+        if (cursor + 2 > input.size())
+            return false;
+
+        size_t offset = input[cursor] | (static_cast<size_t>(input[cursor + 1]) << 8);
+        cursor += 2;
+
+        uint64_t match_length = token & 0xF;
+        if (match_length == 15) {
+            uint64_t rest = 0;
+            if (!readVarint(input, cursor, rest))
+                return false;
+            match_length += rest;
+        }
+        match_length += lz_min_match;
+
+        if (offset == 0 || offset > output.size() || match_length > size - output.size())
+            return false;
+
+        // Matches can overlap what they copy, so bytes are copied one by one
+        size_t from = output.size() - offset;
+        for (size_t i = 0; i < match_length; i++)
+            output.push_back(output[from + i]);
+    }
+
+    return cursor == input.size();
+}
+
+/*
+    Cheap statistics of a field, they pick the encodings worth trying so not every one has to be built on every save.
+    Runs along an axis are counted from the bits that differ from their neighbour along it, on every fourth y slice
+*/
+struct FieldStatistics {
+    std::array<size_t, 3> axis_runs{1, 1, 1};
+    size_t row_runs = 1; // Runs of identical rows
+};
+
+const static int statistics_y_step = 4;
+
+static FieldStatistics gatherStatistics(const FieldCodec::Rows& rows) {
+    FieldStatistics statistics{};
+
+    for (size_t i = 1; i < rows.size(); i++)
+        statistics.row_runs += rows[i] != rows[i - 1];
+
+    std::array<size_t, 3> changes{};
+    for (int y = 0; y < 64; y += statistics_y_step)
+        for (int x = 0; x < 64; x++) {
+            uint64_t row = rows[x + y * 64];
+
+            changes[2] += std::popcount((row ^ (row >> 1)) & (~0ULL >> 1));
+            if (x < 63)
+                changes[0] += std::popcount(row ^ rows[x + 1 + y * 64]);
+            if (y < 63)
+                changes[1] += std::popcount(row ^ rows[x + (y + 1) * 64]);
+        }
+
+    for (int axis = 0; axis < 3; axis++)
+        statistics.axis_runs[axis] += changes[axis] * statistics_y_step;
+
+    return statistics;
+}
+
+// Bytes of a varint of the average run, the estimate only has to order the encodings
+static size_t estimateRunBytes(size_t runs, size_t length) {
+    size_t average = length / runs;
+    return runs * (average < (1 << 7) ? 1 : average < (1 << 14) ? 2 : 3);
+}
+
+// LZ on the rows only won against encodings at least half their size, larger rows are not compressed to compare
+const static size_t rows_lz_ratio = 2;
+
+void FieldCodec::encode(const Rows& rows, ByteArray& output) {
+    std::vector<uint8_t> rows_encoded{};
+    {
+        auto compressed = BitField3D::compress(rows);
+        rows_encoded.resize(compressed.size() * sizeof(uint64_t));
+        std::memcpy(rows_encoded.data(), compressed.data(), rows_encoded.size());
+    }
+
+    std::vector<uint8_t> best = rows_encoded;
+    uint8_t best_header       = ROWS;
+
+    auto statistics = gatherStatistics(rows);
+
+    int axis = 0;
+    for (int i = 1; i < 3; i++)
+        if (statistics.axis_runs[i] < statistics.axis_runs[axis])
+            axis = i;
+
+    size_t axis_estimate = 1 + estimateRunBytes(statistics.axis_runs[axis], total_bits);
+    size_t rows_estimate = estimateRunBytes(statistics.row_runs, rows.size()) + statistics.row_runs * sizeof(uint64_t);
+
+    std::vector<uint8_t> candidate{};
+    std::vector<uint8_t> compressed{};
+
+    auto consider = [&](uint8_t header) {
+        if (candidate.size() < best.size()) {
+            best.swap(candidate);
+            best_header = header;
+        }
+    };
+
+    // Only the encodings that can beat the rows are built, the second one only when it is close to the first
+    bool axis_first = axis_estimate <= rows_estimate;
+    for (int pass = 0; pass < 2; pass++) {
+        bool use_axis   = axis_first == (pass == 0);
+        size_t estimate = use_axis ? axis_estimate : rows_estimate;
+        if (estimate >= best.size() || (pass == 1 && estimate > std::min(axis_estimate, rows_estimate) * 3 / 2))
+            continue;
+
+        candidate.clear();
+        if (use_axis) {
+            encodeAxisRuns(rows, axis, candidate);
+            consider(AXIS_RUNS | (axis << axis_shift));
+        } else {
+            encodeRowRuns(rows, candidate);
+            consider(ROW_RUNS);
+        }
+    }
+
+    // LZ finds the repeats the runs don't, it is tried on the smallest encoding and on the rows, whose partial rows repeat
+    compressed.clear();
+    compressLZ(best, compressed);
+    if (compressed.size() < best.size()) {
+        best.swap(compressed);
+        best_header |= lz_flag;
+    }
+
+    if ((best_header & method_mask) != ROWS && rows_encoded.size() <= best.size() * rows_lz_ratio) {
+        compressed.clear();
+        compressLZ(rows_encoded, compressed);
+        if (compressed.size() < best.size()) {
+            best.swap(compressed);
+            best_header = ROWS | lz_flag;
+        }
+    }
+
+    output.Append<uint8_t>(best_header);
+    output.Append(best);
+}
+
+bool FieldCodec::decode(ByteArray& input, Rows& rows) {
+    auto header_option  = input.Read<uint8_t>();
+    auto payload_option = input.ReadVector<uint8_t>();
+    if (!header_option || !payload_option)
+        return false;
+
+    uint8_t header = header_option.value();
+    auto& payload  = payload_option.value();
+
+    if (header & lz_flag) {
+        std::vector<uint8_t> decompressed{};
+        if (!decompressLZ(payload, decompressed))
+            return false;
+
+        payload.swap(decompressed);
+    }
+
+    switch (header & method_mask) {
+        case ROWS: {
+            if (payload.size() % sizeof(uint64_t) != 0)
+                return false;
+
+            CompressedArray compressed(payload.size() / sizeof(uint64_t));
+            std::memcpy(compressed.data(), payload.data(), payload.size());
+
+            rows.fill(0);
+            BitField3D::decompress(rows, compressed);
+            return true;
+        }
+        case AXIS_RUNS:
+            return decodeAxisRuns(payload, (header >> axis_shift) & 0b11, rows);
+        case ROW_RUNS:
+            return decodeRowRuns(payload, rows);
+    }
+
+    return false;
+}
@@ -0,0 +1,90 @@
+#include <structure/synchronization/epoch.hpp>
+
+#include <thread>
+
+using namespace Sync;
+
+EpochDomain::~EpochDomain() {
+    for (auto& list : retired) {
+        for (auto& deleter : list)
+            deleter();
+        list.clear();
+    }
+}
+
+EpochDomain::Guard EpochDomain::Pin() {
+    static const std::hash<std::thread::id> hasher{};
+    auto& stripe = stripes[hasher(std::this_thread::get_id()) % stripe_count];
+
+    while (true) {
+        uint64_t current = epoch.load();
+
+        auto& readers = stripe.readers[current & 1];
+        readers.fetch_add(1);
+
+        // The epoch moved on before the reader was counted, the count might already have been checked
+        if (epoch.load() == current)
+            return Guard(&readers);
+
+        readers.fetch_sub(1);
+    }
+}
+
+size_t EpochDomain::Readers(size_t parity) {
+    size_t total = 0;
+    for (auto& stripe : stripes)
+        total += stripe.readers[parity].load();
+
+    return total;
+}
+
+bool EpochDomain::TryAdvance() {
+    uint64_t current = epoch.load();
+    size_t previous  = (current + 1) & 1;
+
+    // Readers of the previous epoch could still hold what was retired in it
+    if (Readers(previous) != 0)
+        return false;
+
+    for (auto& deleter : retired[previous])
+        deleter();
+    retired[previous].clear();
+
+    epoch.store(current + 1);
+    return true;
+}
+
+void EpochDomain::Retire(std::function<void()> deleter) {
+    std::lock_guard lock(retire_mutex);
+
+    retired[epoch.load() & 1].push_back(std::move(deleter));
+    TryAdvance();
+}
+
+void EpochDomain::Collect() {
+    std::lock_guard lock(retire_mutex);
+
+    // Both lists are freed after two advances
+    if (TryAdvance())
+        TryAdvance();
+}
+
+void EpochDomain::Synchronize() {
+    std::unique_lock lock(retire_mutex);
+
+    // After two advances every reader from before is gone and both lists were freed
+    uint64_t target = epoch.load() + 2;
+    while (epoch.load() < target) {
+        if (TryAdvance())
+            continue;
+
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+    }
+}
+
+size_t EpochDomain::Pending() {
+    std::lock_guard lock(retire_mutex);
+    return retired[0].size() + retired[1].size();
+}
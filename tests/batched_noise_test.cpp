@@ -0,0 +1,109 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <game/world/batched_noise.hpp>
+#include <game/world/world_generation.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+
+/*
+    Batches of noise have to give the same values as single samples with FastNoiseLite, for every count and also for
+    zero and negative whole coordinates. The heightmaps evaluated in batches have to match GetHeightAt column by column
+*/
+
+static FastNoiseLite Reference(const NoiseSettings& settings) {
+    FastNoiseLite noise{};
+    noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
+    noise.SetSeed(settings.seed);
+    noise.SetFrequency(settings.frequency);
+    noise.SetFractalType(settings.fractal ? FastNoiseLite::FractalType_FBm : FastNoiseLite::FractalType_None);
+    noise.SetFractalOctaves(settings.octaves);
+    noise.SetFractalLacunarity(settings.lacunarity);
+    noise.SetFractalGain(settings.gain);
+    noise.SetFractalWeightedStrength(settings.weighted_strength);
+    return noise;
+}
+
+// Bit exact, unless the build fuses FastNoiseLites multiplications and additions
+static bool Same(float value, float expected) {
+#ifdef __FMA__
+    return std::abs(value - expected) < 1e-6f;
+#else
+    return std::memcmp(&value, &expected, sizeof(float)) == 0;
+#endif
+}
+
+static void TestBatches() {
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> coordinate(-5000, 5000);
+
+    const size_t count = 4099;
+    std::vector<float> x(count), y(count), output(count);
+    for (size_t i = 0; i < count; i++) {
+        x[i] = coordinate(random);
+        y[i] = coordinate(random);
+    }
+    x[0] = -2, y[0] = -3;
+    x[1] = 0, y[1] = 0;
+    x[2] = -0.0f, y[2] = 1e-30f;
+
+    std::vector<NoiseSettings> settings(4);
+    settings[0].frequency         = 0.003f;
+    settings[0].seed              = 42;
+    settings[1].frequency         = 0.01f;
+    settings[1].fractal           = true;
+    settings[1].octaves           = 15;
+    settings[1].seed              = -7;
+    settings[2].frequency         = 0.0005f;
+    settings[2].fractal           = true;
+    settings[2].octaves           = 3;
+    settings[3].frequency         = 0.05f;
+    settings[3].fractal           = true;
+    settings[3].octaves           = 5;
+    settings[3].weighted_strength = 0.7f;
+    settings[3].gain              = -0.6f;
+
+    for (auto& setting : settings) {
+        BatchedNoise noise{};
+        noise.configure(setting);
+        auto reference = Reference(setting);
+
+        // Counts that fill whole vectors, leave a remainder or are shorter than a vector
+        for (size_t batch : {count, size_t{64}, size_t{13}, size_t{3}, size_t{1}}) {
+            noise.sample(x.data(), y.data(), batch, output.data());
+
+            size_t same = 0;
+            for (size_t i = 0; i < batch; i++)
+                same += Same(output[i], reference.GetNoise(x[i], y[i])) && Same(noise.sample(x[i], y[i]), output[i]);
+            CHECK(same == batch);
+        }
+    }
+}
+
+static void TestHeightmaps() {
+    RegisterGenerationBlocks();
+
+    WorldGenerator generator{};
+    generator.SetSeed(12345);
+
+    for (glm::ivec3 position : {glm::ivec3{0, 0, 0}, glm::ivec3{-3, 0, 5}, glm::ivec3{17, 2, -9}}) {
+        auto heightmap = generator.getHeightmapFor(position);
+
+        int same = 0;
+        for (int x = 0; x < CHUNK_SIZE; x++)
+            for (int z = 0; z < CHUNK_SIZE; z++) {
+                glm::vec3 column = glm::vec3{position.x * CHUNK_SIZE + x, 0, position.z * CHUNK_SIZE + z};
+                same += heightmap->heights[x][z] == generator.GetHeightAt(column);
+            }
+        CHECK(same == CHUNK_SIZE * CHUNK_SIZE);
+    }
+}
+
+int main() {
+    TestBatches();
+    TestHeightmaps();
+
+    return Test::Result();
+}
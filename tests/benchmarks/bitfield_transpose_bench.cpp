@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <memory>
+#include <random>
+
+#include <bitarray.hpp>
+
+#include <test.hpp>
+
+/*
+    getTransposed against the bit by bit loop it replaced, on empty, full, terrain like and random fields. Both have
+    to give the same field, prints the time per transpose of each
+*/
+
+static std::unique_ptr<BitField> LoopTranspose(BitField3D& field) {
+    auto transposed = std::make_unique<BitField>();
+
+    for (int z = 0; z < 64; z++) {
+        for (int y = 0; y < 64; y++) {
+            uint64_t value = field.getRow(z, y);
+
+            for (int x = 0; x < 64; x++) {
+                uint64_t mask = 1ULL << (63 - x);
+
+                if (!(value & mask))
+                    continue;
+
+                transposed->setRow(x, y, transposed->getRow(x, y) | (1ULL << (63 - z)));
+            }
+        }
+    }
+
+    return transposed;
+}
+
+static void Fill(BitField3D& field, int kind) {
+    std::mt19937_64 random(kind);
+
+    for (uint x = 0; x < 64; x++)
+        for (uint y = 0; y < 64; y++) {
+            uint64_t row = 0;
+            if (kind == 1)
+                row = ~0ULL;
+            else if (kind == 2) {
+                // Solid up to a height that changes slowly along z
+                for (uint z = 0; z < 64; z++)
+                    if (y < 28 + (x * 7 + z * 3) % 9)
+                        row |= 1ULL << (63 - z);
+            } else if (kind == 3)
+                row = random();
+
+            field.setRow(x, y, row);
+        }
+}
+
+int main() {
+    const char* names[] = {"empty", "full", "terrain", "random"};
+
+    int mismatches = 0;
+    for (int kind = 0; kind < 4; kind++) {
+        BitField3D field{};
+        Fill(field, kind);
+
+        auto expected      = LoopTranspose(field);
+        BitField3D* kernel = field.getTransposed();
+        for (uint x = 0; x < 64; x++)
+            for (uint y = 0; y < 64; y++)
+                mismatches += kernel->getRow(x, y) != expected->getRow(x, y);
+
+        double loop = Test::Measure([&]() { LoopTranspose(field); });
+
+        // Setting a row drops the cached version, so every call transposes again
+        double transpose = Test::Measure([&]() {
+            for (int i = 0; i < 100; i++) {
+                field.setRow(0, 0, field.getRow(0, 0));
+                field.getTransposed();
+            }
+        }) / 100;
+
+        printf("%-8s loop %8.1f us, getTransposed %6.1f us\n", names[kind], loop * 1000, transpose * 1000);
+    }
+
+    if (mismatches != 0)
+        printf("%d rows differ from the loop\n", mismatches);
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include <game/world/terrain.hpp>
+
+#include <test_blocks.hpp>
+#include <test_mesh.hpp>
+
+/*
+    Block reads by world position in a world of 5x5x5 chunks, in random order and walking over every block of a box.
+    Terrain::getBlock and Terrain::Cursor against the float division getBlock converted coordinates with before
+*/
+
+static Block* FloatGetBlock(const Terrain& terrain, const glm::ivec3& position) {
+    glm::ivec3 chunk_position = glm::floor(glm::vec3(position) / static_cast<float>(CHUNK_SIZE));
+    glm::ivec3 local_position = glm::abs(position - chunk_position * CHUNK_SIZE);
+
+    Chunk* chunk = terrain.getChunk(chunk_position);
+    return chunk ? chunk->getBlock(local_position) : nullptr;
+}
+
+int main() {
+    RegisterTestBlocks();
+
+    Terrain terrain{};
+    for (int x = -2; x <= 2; x++)
+        for (int y = -2; y <= 2; y++)
+            for (int z = -2; z <= 2; z++) {
+                auto chunk = std::make_unique<Chunk>(glm::ivec3{x, y, z});
+                FillTestChunk(*chunk, TestChunkKind::TERRAIN, 5 + (x + 2) * 25 + (y + 2) * 5 + z + 2);
+                terrain.addChunk({x, y, z}, std::move(chunk));
+            }
+
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int> coordinate(-160, 159);
+
+    std::vector<glm::ivec3> positions(4000000);
+    for (auto& position : positions)
+        position = {coordinate(random), coordinate(random), coordinate(random)};
+
+    const int box_size = 192;
+
+    auto run = [&](const char* name, auto get) {
+        size_t sum = 0; // Keeps the reads from being optimized out
+
+        auto start = std::chrono::steady_clock::now();
+        for (auto& position : positions)
+            if (Block* block = get(position))
+                sum += block->id;
+        auto middle = std::chrono::steady_clock::now();
+        for (int x = -box_size / 2; x < box_size / 2; x++)
+            for (int y = -box_size / 2; y < box_size / 2; y++)
+                for (int z = -box_size / 2; z < box_size / 2; z++)
+                    if (Block* block = get(glm::ivec3{x, y, z}))
+                        sum += block->id;
+        auto end = std::chrono::steady_clock::now();
+
+        double random_time     = std::chrono::duration<double, std::nano>(middle - start).count() / positions.size();
+        double sequential_time = std::chrono::duration<double, std::nano>(end - middle).count() / (box_size * box_size * box_size);
+        printf("%-16s random %6.1f ns/block, sequential %6.1f ns/block (%zu)\n", name, random_time, sequential_time, sum);
+    };
+
+    run("float getBlock", [&](const glm::ivec3& position) { return FloatGetBlock(terrain, position); });
+    run("getBlock", [&](const glm::ivec3& position) { return terrain.getBlock(position); });
+
+    Terrain::Cursor cursor{terrain};
+    run("cursor", [&](const glm::ivec3& position) { return cursor.getBlock(position); });
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+
+#include <blockarray.hpp>
+#include <game/chunk.hpp>
+
+#include <test_blocks.hpp>
+#include <test_mesh.hpp>
+
+/*
+    Reads and writes of a million random positions of one chunk, with the layers scanned (LAYERED) and through the
+    palette index (PALETTE), for chunks with one to six types of blocks. Prints nanoseconds per block
+*/
+
+const int access_count = 1000000;
+
+static void Fill(Chunk& chunk, int types) {
+    std::mt19937 random(types);
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 64; y++)
+            for (int z = 0; z < 64; z++)
+                chunk.setBlock({x, y, z}, {static_cast<BlockID>(1 + random() % types)}, true);
+}
+
+static void Run(const char* name, const std::function<void(Chunk&)>& fill) {
+    std::mt19937 random(3);
+    std::vector<glm::ivec3> positions(access_count);
+    std::vector<BlockID> types(access_count);
+    for (int i = 0; i < access_count; i++) {
+        positions[i] = {random() % 64, random() % 64, random() % 64};
+        types[i]     = 1 + random() % 6;
+    }
+
+    double get[2]{};
+    double set[2]{};
+    std::vector<BlockID> read[2]{};
+
+    for (auto layout : {SparseBlockArray::LAYERED, SparseBlockArray::PALETTE}) {
+        Chunk chunk{};
+        fill(chunk);
+        chunk.setLayout(layout);
+
+        size_t sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (auto& position : positions)
+            sum += chunk.getBlock(position)->id;
+        auto middle = std::chrono::steady_clock::now();
+
+        // Only types the chunk already has, so the layout stays the same
+        for (int i = 0; i < access_count; i++)
+            chunk.setBlock(positions[i], *chunk.getBlock(positions[(i + 1) % access_count]));
+        auto end = std::chrono::steady_clock::now();
+
+        get[layout] = std::chrono::duration<double, std::nano>(middle - start).count() / access_count;
+        set[layout] = std::chrono::duration<double, std::nano>(end - middle).count() / access_count;
+
+        for (auto& position : positions)
+            read[layout].push_back(chunk.getBlock(position)->id);
+        read[layout].push_back(sum);
+    }
+
+    printf("%-16s getBlock %6.1f -> %5.1f ns, setBlock %6.1f -> %6.1f ns%s\n", name, get[0], get[1], set[0], set[1],
+           read[0] == read[1] ? "" : ", DIFFERENT BLOCKS");
+}
+
+int main() {
+    RegisterTestBlocks();
+
+    printf("LAYERED -> PALETTE\n");
+    Run("full, 1 type", [](Chunk& chunk) { chunk.fill({1}); });
+    Run("random, 2 types", [](Chunk& chunk) { Fill(chunk, 2); });
+    Run("terrain", [](Chunk& chunk) { FillTestChunk(chunk, TestChunkKind::TERRAIN); });
+    Run("random, 4 types", [](Chunk& chunk) { Fill(chunk, 4); });
+    Run("random, 6 types", [](Chunk& chunk) { Fill(chunk, 6); });
+
+    return 0;
+}
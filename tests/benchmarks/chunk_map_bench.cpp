@@ -0,0 +1,131 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <game/world/chunk_map.hpp>
+#include <vec_hash.hpp>
+
+/*
+    Lookups mixed with inserts and removals at 16 threads, the chunk map against the map behind one shared mutex that
+    Terrain used before. Prints the operations per second of every mix
+*/
+
+const int thread_count = 16;
+const int side         = 24; // 24 * 8 * 24 positions
+const auto duration    = std::chrono::seconds(2);
+
+static glm::ivec3 PositionOf(uint32_t value) {
+    return {static_cast<int>(value % side) - side / 2, static_cast<int>(value / side % 8) - 4,
+            static_cast<int>(value / side / 8 % side) - side / 2};
+}
+
+class LockedMap {
+  private:
+    std::shared_mutex mutex;
+    std::unordered_map<glm::ivec3, std::unique_ptr<Chunk>, IVec3Hash, IVec3Equal> chunks{};
+
+  public:
+    Chunk* find(const glm::ivec3& position) {
+        std::shared_lock lock(mutex);
+
+        auto chunk = chunks.find(position);
+        return chunk == chunks.end() ? nullptr : chunk->second.get();
+    }
+    void insert(const glm::ivec3& position) {
+        auto chunk = std::make_unique<Chunk>(position);
+
+        std::unique_lock lock(mutex);
+        chunks.try_emplace(position, std::move(chunk));
+    }
+    void remove(const glm::ivec3& position) {
+        std::unique_ptr<Chunk> chunk = nullptr;
+
+        std::unique_lock lock(mutex);
+        auto node = chunks.extract(position);
+        if (node)
+            chunk = std::move(node.mapped());
+    }
+    int pin() {
+        return 0;
+    }
+};
+
+class PinnedMap {
+  private:
+    ChunkMap chunks{};
+
+  public:
+    Chunk* find(const glm::ivec3& position) {
+        return chunks.find(position);
+    }
+    void insert(const glm::ivec3& position) {
+        chunks.insert(position, std::make_unique<Chunk>(position));
+    }
+    // Removed like unloaded chunks, released and collected by the next removal once unused
+    void remove(const glm::ivec3& position) {
+        chunks.release(position);
+        chunks.collectReleased();
+    }
+    ChunkMap::Guard pin() {
+        return chunks.pin();
+    }
+};
+
+template <typename Map> static double Run(int lookup_percent) {
+    Map map{};
+    for (uint32_t value = 0; value < side * 8 * side; value += 2)
+        map.insert(PositionOf(value));
+
+    std::atomic<bool> stop         = false;
+    std::atomic<size_t> operations = 0;
+
+    std::vector<std::thread> threads{};
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 random(t + 100);
+            size_t done = 0;
+
+            while (!stop) {
+                for (int i = 0; i < 64; i++) {
+                    auto position = PositionOf(random());
+                    int operation = random() % 100;
+
+                    if (operation < lookup_percent) {
+                        auto guard            = map.pin();
+                        Chunk* volatile chunk = map.find(position);
+                        (void) chunk;
+                    } else if (operation < lookup_percent + (100 - lookup_percent) / 2)
+                        map.insert(position);
+                    else
+                        map.remove(position);
+                }
+                done += 64;
+            }
+
+            operations += done;
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    stop = true;
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return operations / std::chrono::duration<double>(duration).count() / 1e6;
+}
+
+int main() {
+    printf("%d threads, %u hardware threads\n", thread_count, std::thread::hardware_concurrency());
+
+    for (int lookup_percent : {90, 99, 100}) {
+        printf("%3d%% lookups: shared_mutex map %6.2f M ops/s, ChunkMap %6.2f M ops/s\n", lookup_percent, Run<LockedMap>(lookup_percent),
+               Run<PinnedMap>(lookup_percent));
+    }
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+#include <game/game_state.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+
+/*
+    Ticks of a world with thousands of dropped items and no terrain, every item collides with the items around it.
+    Next to the tick the same collision checks are done the way entityCollision did before the grid, against every
+    other entity
+*/
+
+const fs::path world_path = "entity_bench_world";
+
+static size_t PairwiseChecks(const std::vector<Entity>& entities) {
+    size_t collisions = 0;
+
+    for (auto& checked : entities) {
+        auto& checked_collider = checked.getCollider();
+
+        for (auto& entity : entities) {
+            if (&entity == &checked)
+                continue;
+
+            auto& entity_collider = entity.getCollider();
+
+            float distance = glm::distance(entity_collider.center, checked_collider.center);
+            if (distance > checked_collider.bounding_sphere_radius + entity_collider.bounding_sphere_radius)
+                continue;
+
+            collisions += entity_collider.collidesWith(&checked_collider, entity.getPosition(), checked.getPosition());
+        }
+    }
+
+    return collisions;
+}
+
+static void Run(int count) {
+    fs::remove_all(world_path);
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> position(-40, 40);
+    std::uniform_real_distribution<float> velocity(-3, 3);
+
+    std::vector<Entity> items{};
+    for (int i = 0; i < count; i++) {
+        Entity item({position(random), 30 + position(random) * 0.1f, position(random)}, {0.3f, 0.3f, 0.3f});
+        item.setGravity(false);
+        item.setSolid(i % 5 == 0);
+        item.getVelocity() = {velocity(random), velocity(random), velocity(random)};
+
+        items.push_back(item);
+    }
+
+    size_t collisions = 0;
+    double tick       = 0;
+    {
+        GameState state(world_path.string());
+        for (auto& item : items) {
+            item.onCollision = [&collisions](Entity*, Entity*) { collisions++; };
+            state.addEntity(item);
+        }
+
+        tick = Test::Measure([&]() { state.updateEntities(0.016f); });
+    }
+
+    double pairwise = Test::Measure([&]() { PairwiseChecks(items); }, count > 5000 ? 1 : 5);
+
+    printf("%5d items: tick %8.2f ms, %6zu collisions, checks against every entity %8.2f ms\n", count, tick, collisions, pairwise);
+
+    fs::remove_all(world_path);
+}
+
+int main() {
+    RegisterTestBlocks();
+
+    for (int count : {1000, 10000})
+        Run(count);
+
+    return 0;
+}
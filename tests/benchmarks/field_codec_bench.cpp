@@ -0,0 +1,145 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include <game/world/world_generation.hpp>
+#include <structure/serialization/field_codec.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+
+/*
+    Size and speed of the field codec against the row scheme of BitField3D it replaced, on the fields of generated
+    chunks. Surface chunks have terrain, water and structures. The generator has no caves yet, so tunnels are carved into
+    the underground chunks. Random fields are the worst case for both
+*/
+
+using Rows = FieldCodec::Rows;
+
+// The solid field and a field for every block type, as a block array stores them
+static void AddFields(Chunk& chunk, std::vector<Rows>& fields) {
+    std::map<BlockID, Rows> types{};
+    Rows solid{};
+
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 64; y++)
+            for (int z = 0; z < 64; z++) {
+                BlockID id = chunk.getBlock({x, y, z})->id;
+                if (id == BLOCK_AIR_INDEX)
+                    continue;
+
+                uint64_t bit = 1ULL << (63 - z);
+                types[id][x + y * 64] |= bit;
+                if (!BlockRegistry::get().getPrototype(id)->transparent)
+                    solid[x + y * 64] |= bit;
+            }
+
+    if (types.empty())
+        return;
+
+    fields.push_back(solid);
+    for (auto& [id, rows] : types)
+        fields.push_back(rows);
+}
+
+// Random walks of air spheres
+static void CarveTunnels(Chunk& chunk, std::mt19937& random) {
+    auto step_of = [&]() { return static_cast<int>(random() % 3) - 1; };
+
+    for (int tunnel = 0; tunnel < 6; tunnel++) {
+        glm::ivec3 position  = glm::ivec3{random() % 64, random() % 64, random() % 64};
+        glm::ivec3 direction = {step_of(), step_of(), step_of()};
+
+        for (int step = 0; step < 40; step++) {
+            int radius = 2 + random() % 3;
+            for (int x = -radius; x <= radius; x++)
+                for (int y = -radius; y <= radius; y++)
+                    for (int z = -radius; z <= radius; z++) {
+                        glm::ivec3 block = position + glm::ivec3{x, y, z};
+                        if (x * x + y * y + z * z <= radius * radius && glm::clamp(block, 0, 63) == block)
+                            chunk.setBlock(block, {BLOCK_AIR_INDEX});
+                    }
+
+            position += direction + glm::ivec3{step_of(), 0, step_of()};
+        }
+    }
+}
+
+static void Report(const char* name, const std::vector<Rows>& fields) {
+    std::vector<CompressedArray> old_encoded(fields.size());
+    std::vector<ByteArray> new_encoded(fields.size());
+    Rows rows{};
+
+    double old_encode = Test::Measure([&]() {
+        for (size_t i = 0; i < fields.size(); i++)
+            old_encoded[i] = BitField3D::compress(fields[i]);
+    });
+    double old_decode = Test::Measure([&]() {
+        for (auto& encoded : old_encoded) {
+            rows.fill(0);
+            BitField3D::decompress(rows, encoded);
+        }
+    });
+    double new_encode = Test::Measure([&]() {
+        for (size_t i = 0; i < fields.size(); i++) {
+            new_encoded[i] = ByteArray{};
+            FieldCodec::encode(fields[i], new_encoded[i]);
+        }
+    });
+
+    size_t mismatches = 0;
+    double new_decode = Test::Measure([&]() {
+        for (size_t i = 0; i < fields.size(); i++) {
+            new_encoded[i].SetCursor(0);
+            mismatches += !FieldCodec::decode(new_encoded[i], rows) || rows != fields[i];
+        }
+    });
+
+    size_t old_size = 0;
+    size_t new_size = 0;
+    for (size_t i = 0; i < fields.size(); i++) {
+        old_size += sizeof(size_t) + old_encoded[i].size() * sizeof(uint64_t); // As ByteArray::Append writes it
+        new_size += new_encoded[i].GetCursor();
+    }
+
+    double megabytes = fields.size() * sizeof(Rows) / 1e6;
+    auto speed       = [&](double milliseconds) { return megabytes / milliseconds * 1000; };
+
+    printf("%-11s %4zu fields, row scheme %8zu B, codec %8zu B, ratio %5.2fx | "
+           "encode %7.0f -> %5.0f MB/s | decode %7.0f -> %5.0f MB/s%s\n",
+           name, fields.size(), old_size, new_size, static_cast<double>(old_size) / new_size, speed(old_encode), speed(new_encode),
+           speed(old_decode), speed(new_decode), mismatches ? " MISMATCH" : "");
+}
+
+int main() {
+    RegisterGenerationBlocks();
+
+    WorldGenerator generator{};
+    generator.SetSeed(1234);
+
+    std::mt19937 random(5);
+
+    std::vector<Rows> surface{};
+    std::vector<Rows> underground{};
+    for (int x = 0; x < 4; x++)
+        for (int z = 0; z < 4; z++)
+            for (int y = -3; y <= 1; y++) {
+                Chunk chunk({x, y, z});
+                generator.GenerateTerrainChunk(&chunk, {x, y, z});
+                if (y < -1)
+                    CarveTunnels(chunk, random);
+
+                AddFields(chunk, y >= -1 ? surface : underground);
+            }
+
+    std::vector<Rows> random_fields(16);
+    for (auto& field : random_fields)
+        for (auto& row : field)
+            row = static_cast<uint64_t>(random()) << 32 | random();
+
+    Report("surface", surface);
+    Report("underground", underground);
+    Report("random", random_fields);
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include <game/world/world_generation.hpp>
+
+#include <test_blocks.hpp>
+
+/*
+    A long flight over new terrain, the heightmaps of 17x17 columns around the player (a render distance of 6 and a two
+    column margin) are fetched every step while it moves a column forward on a wavy path. Every 50 steps prints the
+    resident memory of the process, what the heightmap cache holds and the hit rate since the last report. The memory
+    has to level off once the cache is full, the hit rate stays close to the 17 new of 289 columns per step
+*/
+
+const int view_radius = 8;
+const int steps       = 600;
+const int report_step = 50;
+
+// Resident memory in MB, 0 where /proc isn't available
+static double ResidentMemory() {
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file)
+        return 0;
+
+    unsigned long pages = 0, resident = 0;
+    int read = std::fscanf(file, "%lu %lu", &pages, &resident);
+    std::fclose(file);
+
+    return read == 2 ? resident * 4096.0 / (1024 * 1024) : 0;
+}
+
+int main() {
+    RegisterGenerationBlocks();
+
+    WorldGenerator generator{};
+    generator.SetSeed(12345);
+
+    auto& cache   = generator.getHeightmapCache();
+    auto previous = cache.GetStatistics();
+    size_t lookups = 0;
+
+    printf("step   RSS MB  cache MB / budget  entries  evictions  hit rate\n");
+
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 1; step <= steps; step++) {
+        glm::ivec3 center = {step, 0, static_cast<int>(std::round(12 * std::sin(step * 0.03)))};
+
+        for (int x = -view_radius; x <= view_radius; x++)
+            for (int z = -view_radius; z <= view_radius; z++, lookups++)
+                generator.getHeightmapFor(center + glm::ivec3(x, 0, z));
+
+        if (step % report_step != 0)
+            continue;
+
+        auto statistics = cache.GetStatistics();
+        size_t hits     = statistics.hits - previous.hits;
+        size_t misses   = statistics.misses - previous.misses;
+        previous        = statistics;
+
+        printf("%4d  %7.1f  %7.1f / %5.1f  %7zu  %9zu  %8.3f\n", step, ResidentMemory(), statistics.memory_usage / (1024.0 * 1024.0),
+               statistics.memory_budget / (1024.0 * 1024.0), statistics.entries, statistics.evictions,
+               static_cast<double>(hits) / static_cast<double>(hits + misses));
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%zu lookups in %.1f s\n", lookups, seconds);
+
+    return 0;
+}
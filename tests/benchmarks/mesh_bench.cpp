@@ -0,0 +1,99 @@
+#include <array>
+#include <cstdio>
+#include <functional>
+
+#include <game/world/face_masks.hpp>
+#include <game/world/mesh_generation.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+#include <test_mesh.hpp>
+
+/*
+    Time to mesh a chunk without neighbours and the faces meshed per second, on empty, full, terrain like and random
+    chunks. The face masks of every layer are also calculated the way the mesher did before snapshots, a locked virtual
+    getRow per row through std::function getters, next to the snapshots and FaceMaskBuffer it uses now
+*/
+
+using RowGetter = std::function<uint64_t(int layer, int row)>;
+
+static uint64_t LockedMasks(BitField3D& solid, BitField3D& field, bool transparent) {
+    RowGetter getters[3][2] = {
+        {[&](int layer, int row) { return solid.getRow(layer, row); }, [&](int layer, int row) { return field.getRow(layer, row); }},
+        {[&](int layer, int row) { return solid.getRow(row, layer); }, [&](int layer, int row) { return field.getRow(row, layer); }},
+        {[&](int layer, int row) { return solid.getTransposed()->getRow(layer, row); },
+         [&](int layer, int row) { return field.getTransposed()->getRow(layer, row); }}};
+
+    uint64_t any = 0;
+    for (auto& [solid_row, field_row] : getters)
+        for (int layer = 0; layer < 63; layer++)
+            for (int row = 0; row < 64; row++) {
+                auto [forward, backward] = ProcessFaceRowValues(
+                    solid_row(layer, row), solid_row(layer + 1, row), field_row(layer, row), field_row(layer + 1, row), transparent);
+                any |= forward | backward;
+            }
+
+    return any;
+}
+
+static uint64_t SnapshotMasks(BitField3D& solid, BitField3D& field, bool transparent) {
+    static BitFieldSnapshot solid_snapshot{};
+    static BitFieldSnapshot field_snapshot{};
+    static FaceMaskBuffer masks{};
+    static BitPlane<64> plane{};
+
+    solid_snapshot.capture(solid);
+    field_snapshot.capture(field);
+    masks.compute(solid_snapshot, field_snapshot, transparent);
+
+    return masks.getPlane(FaceMaskBuffer::X_FORWARD, 0, plane);
+}
+
+int main() {
+    RegisterTestBlocks();
+
+    printf("face mask kernel: %s\n", FaceMaskBuffer::KernelName());
+
+    const char* names[] = {"empty", "full", "terrain", "random"};
+
+    Terrain world{};
+    ChunkMeshGenerator generator{};
+    generator.setWorld(&world);
+
+    for (int kind = 0; kind < 4; kind++) {
+        Chunk chunk({0, 0, 0});
+        FillTestChunk(chunk, static_cast<TestChunkKind>(kind));
+
+        size_t faces        = MeshTestChunk(generator, chunk).size();
+        double milliseconds = Test::Measure([&]() { MeshTestChunk(generator, chunk); }, kind == 3 ? 3 : 20);
+
+        // Masks of all the test block types in the chunk, the same ones the mesher calculates for its layers
+        BitField3D solid{};
+        std::array<BitField3D, 7> fields{};
+        for (uint x = 0; x < 64; x++)
+            for (uint y = 0; y < 64; y++)
+                for (uint z = 0; z < 64; z++) {
+                    BlockID id = chunk.getBlock({x, y, z})->id;
+                    if (id == BLOCK_AIR_INDEX)
+                        continue;
+
+                    fields[id].set(x, y, z);
+                    if (!BlockRegistry::get().getPrototype(id)->transparent)
+                        solid.set(x, y, z);
+                }
+
+        double locked   = 0;
+        double snapshot = 0;
+        for (BlockID id = 1; id < fields.size(); id++) {
+            bool transparent = BlockRegistry::get().getPrototype(id)->transparent;
+
+            locked += Test::Measure([&]() { LockedMasks(solid, fields[id], transparent); });
+            snapshot += Test::Measure([&]() { SnapshotMasks(solid, fields[id], transparent); });
+        }
+
+        printf("%-8s %8.3f ms per chunk, %7zu faces, %5.2f M faces/s, masks with locked rows %7.3f ms, with snapshots %6.3f ms\n",
+               names[kind], milliseconds, faces, faces / milliseconds / 1000, locked, snapshot);
+    }
+
+    return 0;
+}
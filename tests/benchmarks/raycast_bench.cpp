@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include <game/world/terrain.hpp>
+#include <game/world/world_generation.hpp>
+
+#include <test_blocks.hpp>
+#include <test_raycast.hpp>
+
+/*
+    Batches of a million rays across generated terrain, Terrain::raycast against the stepping raycast it replaced and
+    a DDA that reads every block. Prints nanoseconds per ray for a short reach like the cursor and a long one
+*/
+
+const int ray_count = 1000000;
+
+int main() {
+    RegisterGenerationBlocks();
+
+    WorldGenerator generator{};
+    generator.SetSeed(1234);
+
+    // 8x4x8 chunks around the surface, empty chunks above
+    Terrain terrain{};
+    for (int x = -4; x < 4; x++)
+        for (int y = -2; y < 2; y++)
+            for (int z = -4; z < 4; z++) {
+                auto chunk = std::make_unique<Chunk>(glm::ivec3{x, y, z});
+                generator.GenerateTerrainChunk(chunk.get(), {x, y, z});
+                terrain.addChunk({x, y, z}, std::move(chunk));
+            }
+
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+
+    // From the air above the ground in every direction, like the cursor and line of sight checks
+    std::vector<std::pair<glm::vec3, glm::vec3>> rays(ray_count);
+    for (auto& [from, direction] : rays) {
+        from = {uniform(random) * 200, 70 + uniform(random) * 50, uniform(random) * 200};
+        do
+            direction = {uniform(random), uniform(random), uniform(random)};
+        while (glm::length(direction) < 0.1f);
+        direction = glm::normalize(direction);
+    }
+
+    for (float reach : {10.0f, 100.0f}) {
+        size_t hits = 0;
+        auto time   = [&](auto raycast) {
+            auto start = std::chrono::steady_clock::now();
+            for (auto& [from, direction] : rays)
+                hits += raycast(from, direction).hit;
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ray_count;
+        };
+
+        double dda      = time([&](auto& from, auto& direction) { return terrain.raycast(from, direction, reach); });
+        double stepping = time([&](auto& from, auto& direction) { return SteppingRaycast(terrain, from, direction, reach); });
+        double blocks   = time([&](auto& from, auto& direction) { return BlockRaycast(terrain, from, direction, reach); });
+
+        printf("reach %3.0f: raycast %6.0f ns/ray, stepping %6.0f ns/ray, every block %6.0f ns/ray, %4.1f%% hit\n", reach, dda,
+               stepping, blocks, hits * 100.0 / 3 / ray_count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+#include <structure/record_store.hpp>
+#include <vec_hash.hpp>
+
+#include <memory_buffer.hpp>
+
+/*
+    A store of a million segment keys with 16 byte values, in a single record block and in a chain of 62 blocks, more
+    than the store caches. Prints how long filling, committing and opening take, how much a commit of a few changed
+    keys and the commits while values grow write, and the latency of random gets
+*/
+
+struct Header {};
+
+using Store = RecordStore<glm::ivec3, Header, IVec3Hash, IVec3Equal>;
+
+const int key_count = 1000000;
+
+static glm::ivec3 Key(int i) {
+    return {i % 100 - 50, i / 10000 - 50, (i / 100) % 100 - 50};
+}
+
+template <typename Function> static double Seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void Run(size_t records_per_block) {
+    CountingBuffer buffer{};
+    std::mt19937 random(3);
+    byte value[2048]{};
+
+    auto store = std::make_unique<Store>(records_per_block);
+    store->SetBuffer(&buffer);
+
+    double fill  = Seconds([&]() {
+        for (int i = 0; i < key_count; i++)
+            store->Save(Key(i), 16, value);
+    });
+    double flush = Seconds([&]() { store->Flush(); });
+
+    // A few values saved again and a few new keys, like a short play session
+    buffer.written = 0;
+    double commit  = Seconds([&]() {
+        for (int i = 0; i < 1000; i++)
+            store->Save(Key(random() % key_count), 16, value);
+        for (int i = 0; i < 100; i++)
+            store->Save(Key(key_count + i), 16, value);
+        store->Flush();
+    });
+    size_t commit_written = buffer.written;
+
+    // Values outgrowing their records, freed space makes the store commit on its own every few thousand saves
+    buffer.written = 0;
+    double grow    = Seconds([&]() {
+        for (int i = 0; i < 20000; i++)
+            store->Save(Key(random() % key_count), sizeof(value), value);
+    });
+    size_t grow_written = buffer.written;
+
+    store = std::make_unique<Store>(records_per_block);
+    double open = Seconds([&]() { store->SetBuffer(&buffer); });
+
+    std::vector<glm::ivec3> keys(key_count);
+    for (auto& key : keys)
+        key = Key(random() % key_count);
+
+    std::vector<byte> output{};
+    size_t hits = 0;
+    double get  = Seconds([&]() {
+        for (auto& key : keys)
+            hits += store->Get(key, output);
+    });
+    double miss = Seconds([&]() {
+        for (auto& key : keys)
+            hits += store->Get(key + glm::ivec3(0, 0, 1000), output);
+    });
+
+    printf("%7zu records per block: fill %5.2f s, flush %6.1f ms, open %6.1f ms\n", records_per_block, fill, flush * 1000,
+           open * 1000);
+    printf("    commit of 1100 saves %6.1f ms writing %6.0f KB, 20000 growing saves %6.1f us/save writing %6.1f MB\n",
+           commit * 1000, commit_written / 1024.0, grow * 1e6 / 20000, grow_written / 1048576.0);
+    printf("    get %6.0f ns, missing key %4.0f ns (%zu found)\n", get * 1e9 / key_count, miss * 1e9 / key_count, hits);
+}
+
+int main() {
+    Run(Store::default_records_per_block);
+    Run(16384);
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <cstdio>
+
+#include <game/structure.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+#include <test_mesh.hpp>
+#include <test_structure.hpp>
+
+/*
+    Placements of the tower the world generator uses and of random cubes into a world of terrain chunks, Structure::place
+    against placing block by block the way it did before. Prints milliseconds per placement
+*/
+
+static void Run(const char* name, Structure& structure) {
+    Terrain terrain{};
+    for (int x = -2; x <= 2; x++)
+        for (int y = -2; y <= 2; y++)
+            for (int z = -2; z <= 2; z++) {
+                auto chunk = std::make_unique<Chunk>(glm::ivec3{x, y, z});
+                FillTestChunk(*chunk, TestChunkKind::TERRAIN, 7 + x * 25 + y * 5 + z);
+                terrain.addChunk({x, y, z}, std::move(chunk));
+            }
+
+    // Unaligned, so most arrays are split across 8 chunks
+    glm::ivec3 position = {5, -3, 17};
+
+    double place = Test::Measure([&]() { structure.place(position, terrain); });
+    double voxel = Test::Measure([&]() { VoxelPlace(structure, position, terrain); }, 1);
+
+    printf("%-26s place %8.3f ms, block by block %8.2f ms\n", name, place, voxel);
+}
+
+int main() {
+    RegisterTestBlocks();
+    BlockID chest = RegisterChestBlock();
+
+    Structure tower = LoadTower();
+    Run("tower", tower);
+
+    Structure cube = RandomStructure(64, chest);
+    Run("random 64^3 with chests", cube);
+
+    Structure plain = RandomStructure(64, BLOCK_AIR_INDEX);
+    Run("random 64^3", plain);
+
+    Structure large = RandomStructure(96, chest);
+    Run("random 96^3 with chests", large);
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <game/chunk.hpp>
+#include <game/world/batched_noise.hpp>
+#include <game/world/world_generation.hpp>
+
+#include <test_blocks.hpp>
+
+/*
+    Throughput of the world generator, noise points per second of the batched noise against single samples, heightmap
+    columns per second and whole chunks per second, where the heightmaps of the columns around are calculated on the way
+*/
+
+template <typename Function> static double Seconds(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void BenchNoise() {
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> coordinate(-5000, 5000);
+
+    const size_t count = 1 << 16;
+    std::vector<float> x(count), y(count), output(count);
+    for (size_t i = 0; i < count; i++) {
+        x[i] = coordinate(random);
+        y[i] = coordinate(random);
+    }
+
+    NoiseSettings settings{};
+    settings.fractal = true;
+    settings.octaves = 5;
+
+    BatchedNoise noise{};
+    noise.configure(settings);
+
+    double batched = Seconds([&]() { noise.sample(x.data(), y.data(), count, output.data()); });
+    double single  = Seconds([&]() {
+        for (size_t i = 0; i < count; i++)
+            output[i] = noise.sample(x[i], y[i]);
+    });
+
+    printf("noise, 5 octaves: batched (%s) %6.1f ns/point, single samples %6.1f ns/point\n", BatchedNoise::KernelName(),
+           batched * 1e9 / count, single * 1e9 / count);
+}
+
+int main() {
+    RegisterGenerationBlocks();
+    BenchNoise();
+
+    WorldGenerator generator{};
+    generator.SetSeed(12345);
+
+    // Spread out so the columns of one heightmap dont overlap the others
+    int columns       = 0;
+    double heightmaps = Seconds([&]() {
+        for (int x = -6; x < 6; x++)
+            for (int z = -6; z < 6; z++, columns++)
+                generator.getHeightmapFor({x * 3 + 100, 0, z * 3 - 40});
+    });
+    printf("heightmaps: %4d columns in %6.3f s, %6.1f columns/s\n", columns, heightmaps, columns / heightmaps);
+
+    generator.Clear();
+
+    int chunks     = 0;
+    double terrain = Seconds([&]() {
+        for (int x = -3; x < 3; x++)
+            for (int z = -3; z < 3; z++)
+                for (int y = -1; y <= 2; y++, chunks++) {
+                    Chunk chunk({x, y, z});
+                    generator.GenerateTerrainChunk(&chunk, {x, y, z});
+                }
+    });
+    printf("chunks:     %4d chunks  in %6.3f s, %6.1f chunks/s\n", chunks, terrain, chunks / terrain);
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include <random>
+
+#include <bitarray.hpp>
+
+#include <test.hpp>
+
+/*
+    Border planes read by the mesher have to match the rows of the field and of its transposed version
+*/
+
+int main() {
+    std::mt19937_64 random(5);
+
+    for (int round = 0; round < 4; round++) {
+        BitField3D field{};
+        for (uint x = 0; x < 64; x++)
+            for (uint y = 0; y < 64; y++)
+                field.setRow(x, y, round == 0 ? ~0ULL : random() & random());
+
+        BitField3D* transposed = field.getTransposed();
+
+        for (uint layer : {0u, 1u, 31u, 63u}) {
+            BitFieldBorder border{};
+            border.captureX(field, layer);
+            border.captureY(field, layer);
+            border.captureZ(field, layer);
+
+            for (uint row = 0; row < 64; row++) {
+                CHECK(border.getXRow(row) == field.getRow(layer, row));
+                CHECK(border.getYRow(row) == field.getRow(row, layer));
+                CHECK(border.getZRow(row) == transposed->getRow(layer, row));
+            }
+
+            border.clear();
+            for (uint row = 0; row < 64; row++)
+                CHECK((border.getXRow(row) | border.getYRow(row) | border.getZRow(row)) == 0);
+        }
+    }
+
+    return Test::Result();
+}
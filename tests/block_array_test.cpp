@@ -0,0 +1,147 @@
+#include <random>
+
+#include <blockarray.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+
+/*
+    Both layouts have to read the same blocks, also where layers overlap, and only dense chunks get the palette index.
+    Writes that skip the check for the block already there can't leave the index and the layers disagreeing
+*/
+
+static std::vector<BlockID> ReadAll(SparseBlockArray& array) {
+    std::vector<BlockID> blocks{};
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 64; y++)
+            for (int z = 0; z < 64; z++)
+                blocks.push_back(array.getBlock({x, y, z})->id);
+
+    return blocks;
+}
+
+static void TestOverlap() {
+    std::mt19937 random(3);
+
+    // Without checking, blocks are set on top of other layers instead of replacing them, the earliest layer wins
+    SparseBlockArray array{};
+    for (BlockID type : {1, 2, 3, 5})
+        for (int i = 0; i < 3000; i++)
+            array.setBlock({random() % 16, random() % 16, random() % 16}, {type}, true);
+
+    CHECK(array.getLayout() == SparseBlockArray::LAYERED);
+    auto expected = ReadAll(array);
+
+    array.setLayout(SparseBlockArray::PALETTE);
+    CHECK(ReadAll(array) == expected);
+
+    // Layers loaded into an indexed array are added to the existing index one by one
+    ByteArray bytes{};
+    CHECK(Serializer::Serialize<SparseBlockArray>(array, bytes));
+    bytes.SetCursor(0);
+
+    SparseBlockArray loaded{};
+    loaded.setLayout(SparseBlockArray::PALETTE);
+    CHECK(Serializer::Deserialize<SparseBlockArray>(loaded, bytes));
+    CHECK(loaded.getLayout() == SparseBlockArray::PALETTE);
+    CHECK(ReadAll(loaded) == expected);
+}
+
+static void TestSelect() {
+    std::mt19937 random(4);
+
+    // A few blocks of many types in air
+    SparseBlockArray sparse{};
+    for (int i = 0; i < 1000; i++)
+        sparse.setBlock({random() % 64, random() % 64, random() % 64}, {static_cast<BlockID>(1 + i % 6)});
+
+    CHECK(sparse.getLayout() == SparseBlockArray::LAYERED);
+
+    // Layers are created before their blocks are set, selecting again picks the palette once the chunk is dense
+    SparseBlockArray dense{};
+    for (int i = 0; i < 100000; i++)
+        dense.setBlock({random() % 64, random() % 64, random() % 64}, {static_cast<BlockID>(1 + i % 6)});
+
+    auto expected = ReadAll(dense);
+    dense.selectLayout();
+    CHECK(dense.getLayout() == SparseBlockArray::PALETTE);
+    CHECK(ReadAll(dense) == expected);
+
+    // Emptied again, the index is dropped
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 60; y++)
+            for (int z = 0; z < 64; z++)
+                dense.setBlock({x, y, z}, {BLOCK_AIR_INDEX});
+
+    expected = ReadAll(dense);
+    dense.selectLayout();
+    CHECK(dense.getLayout() == SparseBlockArray::LAYERED);
+    CHECK(ReadAll(dense) == expected);
+}
+
+static void TestUncheckedWrites() {
+    std::mt19937 random(5);
+
+    auto position = [&random]() { return glm::ivec3(random() % 64, random() % 64, random() % 64); };
+    auto index    = [](const glm::ivec3& position) { return (position.x * 64 + position.y) * 64 + position.z; };
+
+    // Dense with many types, so it is indexed
+    SparseBlockArray array{};
+    std::vector<BlockID> expected(64 * 64 * 64, BLOCK_AIR_INDEX);
+    for (int i = 0; i < 100000; i++) {
+        auto at = position();
+        array.setBlock(at, {static_cast<BlockID>(1 + i % 6)});
+        expected[index(at)] = 1 + i % 6;
+    }
+    array.selectLayout();
+    CHECK(array.getLayout() == SparseBlockArray::PALETTE);
+
+    // Over existing blocks and air, without checking
+    for (int i = 0; i < 20000; i++) {
+        auto at    = position();
+        BlockID id = i % 4 == 0 ? BLOCK_AIR_INDEX : 1 + i % 6;
+        array.setBlock(at, {id}, true);
+        expected[index(at)] = id;
+    }
+
+    // Rows of air and of blocks, every other row of a slab
+    for (BlockID id : {BlockID{BLOCK_AIR_INDEX}, BlockID{3}}) {
+        BitField mask{};
+        int y = id == BLOCK_AIR_INDEX ? 10 : 40;
+        for (int x = 0; x < 64; x += 2) {
+            mask.data()[x + y * 64] = 0xF0F0F0F0F0F0F0F0ULL;
+            for (int z = 0; z < 64; z++)
+                if ((0xF0F0F0F0F0F0F0F0ULL >> (63 - z)) & 1)
+                    expected[index({x, y, z})] = id;
+        }
+        array.setRows(mask, {id}, true);
+    }
+
+    CHECK(ReadAll(array) == expected);
+
+    // The layers alone give the same blocks, and indexed again from them too
+    array.setLayout(SparseBlockArray::LAYERED);
+    CHECK(ReadAll(array) == expected);
+    array.setLayout(SparseBlockArray::PALETTE);
+    CHECK(ReadAll(array) == expected);
+
+    // The layers hold no blocks that were replaced, so emptying the array drops the index
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 64; y++)
+            for (int z = 0; z < 64; z++)
+                array.setBlock({x, y, z}, {BLOCK_AIR_INDEX}, true);
+
+    array.selectLayout();
+    CHECK(array.getLayout() == SparseBlockArray::LAYERED);
+    CHECK(ReadAll(array) == std::vector<BlockID>(64 * 64 * 64, BLOCK_AIR_INDEX));
+}
+
+int main() {
+    RegisterTestBlocks();
+
+    TestOverlap();
+    TestSelect();
+    TestUncheckedWrites();
+
+    return Test::Result();
+}
@@ -0,0 +1,108 @@
+#include <climits>
+#include <cstdint>
+
+#include <game/world/chunk_coordinates.hpp>
+#include <game/world/terrain.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+#include <test_mesh.hpp>
+
+/*
+    Every coordinate around zero and next to the limits of int has to land in the chunk floor division gives and at a
+    position inside it between 0 and CHUNK_SIZE - 1. Terrain::getBlock and Terrain::Cursor have to find the same blocks
+    as looking the chunk up directly, also next to missing chunks
+*/
+
+static int64_t FloorDivide(int64_t value) {
+    return value >= 0 ? value / CHUNK_SIZE : -((-value + CHUNK_SIZE - 1) / CHUNK_SIZE);
+}
+
+static void TestCoordinates() {
+    size_t wrong = 0;
+    auto check   = [&](int64_t value) {
+        int x = static_cast<int>(value);
+        int y = static_cast<int>(-value - 1); // The other side of zero, INT_MIN for INT_MAX
+
+        glm::ivec3 chunk = ChunkCoordinates::ToChunk({x, y, x});
+        glm::ivec3 local = ChunkCoordinates::ToLocal({x, y, x});
+
+        int64_t chunk_x = FloorDivide(x);
+        int64_t chunk_y = FloorDivide(y);
+
+        bool correct = chunk.x == chunk_x && local.x == x - chunk_x * CHUNK_SIZE && chunk.y == chunk_y &&
+                       local.y == y - chunk_y * CHUNK_SIZE && chunk.z == chunk.x && local.z == local.x;
+        correct &= glm::clamp(local, 0, CHUNK_SIZE - 1) == local;
+        correct &= ChunkCoordinates::ToWorld(chunk, local) == glm::ivec3(x, y, x);
+
+        wrong += !correct;
+    };
+
+    for (int64_t value = -(1 << 25); value <= (1 << 25); value++)
+        check(value);
+    for (int64_t value = INT_MIN; value < INT_MIN + (1 << 20); value++)
+        check(value);
+    for (int64_t value = INT_MAX - (1 << 20); value <= INT_MAX; value++)
+        check(value);
+
+    CHECK(wrong == 0);
+
+    // Where the float division used to round wrong
+    Terrain terrain{};
+    CHECK(terrain.blockToChunkPosition({-1, 0, -64}) == glm::ivec3(-1, 0, -1));
+    CHECK(terrain.blockToChunkPosition({-65, 63, 64}) == glm::ivec3(-2, 0, 1));
+    CHECK(terrain.blockToChunkPosition({(1 << 24) + 63, -(1 << 24) - 1, 0}) == glm::ivec3(1 << 18, -(1 << 18) - 1, 0));
+    CHECK(terrain.getGetChunkRelativeBlockPosition({-1, -64, 16777279}) == glm::ivec3(63, 0, 63));
+}
+
+static void TestAccess() {
+    RegisterTestBlocks();
+
+    // 5x5x5 chunks with the middle one missing
+    Terrain terrain{};
+    for (int x = -2; x <= 2; x++)
+        for (int y = -2; y <= 2; y++)
+            for (int z = -2; z <= 2; z++) {
+                if (x == 0 && y == 0 && z == 0)
+                    continue;
+
+                auto chunk = std::make_unique<Chunk>(glm::ivec3{x, y, z});
+                FillTestChunk(*chunk, TestChunkKind::TERRAIN, 5 + (x + 2) * 25 + (y + 2) * 5 + z + 2);
+                terrain.addChunk({x, y, z}, std::move(chunk));
+            }
+
+    // A box crossing the borders of the chunks and of the world, walked like the cursor is used and in jumps
+    Terrain::Cursor cursor{terrain};
+    size_t wrong = 0;
+    for (int x = -140; x < 140; x += 5)
+        for (int y = -140; y < 140; y += 5)
+            for (int z = -140; z < 140; z++) {
+                glm::ivec3 position{x, y, z};
+                int64_t chunk_x = FloorDivide(x);
+                int64_t chunk_y = FloorDivide(y);
+                int64_t chunk_z = FloorDivide(z);
+
+                Chunk* chunk    = terrain.getChunk(glm::ivec3(chunk_x, chunk_y, chunk_z));
+                Block* expected = chunk ? chunk->getBlock(glm::ivec3(x - chunk_x * CHUNK_SIZE, y - chunk_y * CHUNK_SIZE,
+                                                                     z - chunk_z * CHUNK_SIZE))
+                                        : nullptr;
+
+                wrong += cursor.getBlock(position) != expected || terrain.getBlock(position) != expected;
+                wrong += cursor.getBlock(-position) != terrain.getBlock(-position);
+            }
+    CHECK(wrong == 0);
+
+    // A chunk added after the cursor missed it is found
+    CHECK(cursor.getBlock({10, 10, 10}) == nullptr);
+    terrain.createEmptyChunk({0, 0, 0});
+    CHECK(cursor.getBlock({10, 10, 10}) != nullptr);
+    CHECK(cursor.setBlock({10, 10, 10}, {3}));
+    CHECK(terrain.getBlock({10, 10, 10})->id == 3);
+}
+
+int main() {
+    TestCoordinates();
+    TestAccess();
+
+    return Test::Result();
+}
@@ -0,0 +1,144 @@
+#include <atomic>
+#include <random>
+#include <thread>
+
+#include <game/world/chunk_map.hpp>
+
+#include <test.hpp>
+
+/*
+    Readers check every chunk they find while other threads insert, erase, release, reclaim and collect at the same
+    positions, a chunk that was freed or reused under a reader shows up as a wrong position or generation
+*/
+
+const int thread_count = 16;
+const int side         = 12; // 12 * 8 * 12 positions, small so threads keep hitting the same ones
+
+static glm::ivec3 PositionOf(uint32_t value) {
+    return {static_cast<int>(value % side) - side / 2, static_cast<int>(value / side % 8) - 4,
+            static_cast<int>(value / side / 8 % side) - side / 2};
+}
+
+static void TestStress() {
+    ChunkMap map{};
+
+    std::atomic<size_t> corrupted = 0;
+    std::atomic<size_t> found     = 0;
+    std::atomic<size_t> collected = 0;
+
+    std::vector<std::thread> threads{};
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 random(t);
+
+            for (int i = 0; i < 20000; i++) {
+                auto position = PositionOf(random());
+                int operation = random() % 100;
+
+                if (operation < 85) {
+                    auto guard   = map.pin();
+                    Chunk* chunk = map.find(position);
+                    if (!chunk)
+                        continue;
+
+                    found++;
+                    uint64_t generation = chunk->getGeneration();
+                    for (int check = 0; check < 20; check++) {
+                        if (chunk->getWorldPosition() != position || chunk->getGeneration() != generation || generation == 0) {
+                            corrupted++;
+                            break;
+                        }
+                    }
+                } else if (operation < 91)
+                    map.insert(position, std::make_unique<Chunk>(position));
+                else if (operation < 94)
+                    map.erase(position);
+                else if (operation < 97)
+                    map.release(position);
+                else if (operation < 99) {
+                    auto guard   = map.pin();
+                    Chunk* chunk = map.reclaim(position);
+                    if (chunk && chunk->getWorldPosition() != position)
+                        corrupted++;
+                } else {
+                    for (auto& chunk : map.collectReleased()) {
+                        collected++;
+                        if (chunk->getGeneration() == 0)
+                            corrupted++;
+                    }
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    CHECK(corrupted == 0);
+    CHECK(found > 0);
+    CHECK(collected > 0);
+
+    size_t counted = 0;
+    for (uint32_t value = 0; value < side * 8 * side; value++)
+        counted += map.find(PositionOf(value)) != nullptr;
+    CHECK(counted == map.size());
+
+    // Without readers everything released is handed out right away
+    size_t released = map.releasedCount();
+    map.releaseAll();
+    CHECK(map.size() == 0);
+    CHECK(map.collectReleased().size() == released + counted);
+    CHECK(map.releasedCount() == 0);
+}
+
+static void TestGenerations() {
+    ChunkMap map{};
+    glm::ivec3 position{1, 2, 3};
+
+    Chunk* first        = map.insert(position, std::make_unique<Chunk>(position));
+    uint64_t generation = first->getGeneration();
+    CHECK(generation != 0);
+
+    // A second chunk at the same position is not added
+    CHECK(map.insert(position, std::make_unique<Chunk>(position)) == first);
+    CHECK(first->getGeneration() == generation);
+
+    // A released chunk is only handed out once the reader that found it is gone
+    {
+        auto guard = map.pin();
+        CHECK(map.find(position) == first);
+
+        map.release(position);
+        CHECK(map.find(position) == nullptr);
+        CHECK(map.collectReleased().empty());
+        CHECK(first->getWorldPosition() == position);
+    }
+
+    // Reclaimed chunks come back with a new generation, their old readers don't hand them out anymore
+    Chunk* reclaimed = nullptr;
+    {
+        auto guard = map.pin();
+        reclaimed  = map.reclaim(position);
+        CHECK(reclaimed == first);
+    }
+    uint64_t reclaimed_generation = reclaimed->getGeneration();
+    CHECK(reclaimed_generation > generation);
+    CHECK(map.collectReleased().empty());
+    CHECK(map.find(position) == first);
+
+    map.release(position);
+    auto collected = map.collectReleased();
+    CHECK(collected.size() == 1 && collected[0].get() == first);
+    CHECK(map.reclaim(position) == nullptr);
+
+    // Inserted again, the chunk is told apart from the one before even at the same address
+    Chunk* again = map.insert(position, std::move(collected[0]));
+    CHECK(again->getGeneration() > reclaimed_generation);
+}
+
+int main() {
+    TestGenerations();
+    TestStress();
+
+    return Test::Result();
+}
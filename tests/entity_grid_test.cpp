@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <list>
+#include <random>
+
+#include <game/entity.hpp>
+#include <game/entity_grid.hpp>
+
+#include <test.hpp>
+
+/*
+    Queries have to find every entity a box touches, once each and in the order the entities were added, also after
+    entities moved or were removed
+*/
+
+static bool Touches(const Entity& entity, const glm::vec3& min, const glm::vec3& max) {
+    RectangularCollider box(min.x, min.y, min.z, max.x - min.x, max.y - min.y, max.z - min.z);
+    return entity.getCollider().collidesWith(&box, entity.getPosition(), {0, 0, 0});
+}
+
+static void CheckQueries(EntityGrid& grid, std::list<Entity>& entities, std::mt19937& random) {
+    std::uniform_real_distribution<float> position(-30, 30);
+    std::uniform_real_distribution<float> size(0.1f, 5);
+
+    std::vector<Entity*> found{};
+    for (int i = 0; i < 500; i++) {
+        glm::vec3 min = {position(random), position(random), position(random)};
+        glm::vec3 max = min + glm::vec3{size(random), size(random), size(random)};
+
+        grid.query(min, max, found);
+
+        // In list order without duplicates
+        auto next    = entities.begin();
+        bool ordered = true;
+        for (auto* entity : found) {
+            while (next != entities.end() && &*next != entity)
+                ++next;
+            if (next == entities.end()) {
+                ordered = false;
+                break;
+            }
+            ++next;
+        }
+        CHECK(ordered);
+
+        for (auto& entity : entities)
+            if (Touches(entity, min, max))
+                CHECK(std::find(found.begin(), found.end(), &entity) != found.end());
+    }
+}
+
+int main() {
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> position(-30, 30);
+    std::uniform_real_distribution<float> size(0.2f, 4);
+
+    std::list<Entity> entities{};
+    EntityGrid grid{};
+
+    for (int i = 0; i < 2000; i++) {
+        entities.emplace_back(glm::vec3{position(random), position(random), position(random)},
+                              glm::vec3{size(random), size(random), size(random)});
+        grid.update(&entities.back());
+    }
+    CHECK(grid.size() == entities.size());
+    CheckQueries(grid, entities, random);
+
+    // Moved a little or far away, the order stays
+    std::uniform_real_distribution<float> move(-3, 3);
+    for (auto& entity : entities) {
+        float offset = random() % 10 == 0 ? position(random) : move(random);
+        entity.setPosition(entity.getPosition() + glm::vec3{offset, 0, 0});
+        grid.update(&entity);
+    }
+    CheckQueries(grid, entities, random);
+
+    for (auto entity = entities.begin(); entity != entities.end();) {
+        if (random() % 3 != 0) {
+            ++entity;
+            continue;
+        }
+
+        grid.remove(&*entity);
+        entity = entities.erase(entity);
+    }
+    CHECK(grid.size() == entities.size());
+    CheckQueries(grid, entities, random);
+
+    // Rebuilt in a new order, like every tick
+    entities.reverse();
+    grid.clear();
+    for (auto& entity : entities)
+        grid.update(&entity);
+    CheckQueries(grid, entities, random);
+
+    return Test::Result();
+}
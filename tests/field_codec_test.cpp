@@ -0,0 +1,176 @@
+#include <random>
+
+#include <blockarray.hpp>
+#include <structure/serialization/field_codec.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+
+/*
+    Every encoding has to give back the exact rows, block arrays saved in the format before the codec still load
+*/
+
+using Rows = FieldCodec::Rows;
+
+static std::vector<Rows> TestFields() {
+    std::mt19937_64 random(9);
+    std::vector<Rows> fields(6);
+
+    fields[1].fill(~0ULL);
+
+    for (auto& row : fields[2])
+        row = random();
+
+    // Ground up to a rolling height with a few holes
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 64; y++)
+            for (int z = 0; z < 64; z++)
+                if (y < 30 + (x * 3 + z * 5) % 7 && random() % 50 != 0)
+                    fields[3][x + y * 64] |= 1ULL << (63 - z);
+
+    // Scattered single bits
+    for (int i = 0; i < 200; i++)
+        fields[4][random() % (64 * 64)] |= 1ULL << (random() % 64);
+
+    // Repeating rows
+    for (int i = 0; i < 64 * 64; i++)
+        fields[5][i] = i % 3 == 0 ? 0xF0F0F0F0F0F0F0F0ULL : 0;
+
+    return fields;
+}
+
+static void TestRoundTrip() {
+    for (auto& field : TestFields()) {
+        ByteArray bytes{};
+        FieldCodec::encode(field, bytes);
+        bytes.SetCursor(0);
+
+        Rows decoded{};
+        decoded.fill(0x1234);
+        CHECK(FieldCodec::decode(bytes, decoded));
+        CHECK(decoded == field);
+
+        // Every stage on its own
+        for (int axis = 0; axis < 3; axis++) {
+            std::vector<uint8_t> runs{};
+            FieldCodec::encodeAxisRuns(field, axis, runs);
+
+            decoded.fill(0x1234);
+            CHECK(FieldCodec::decodeAxisRuns(runs, axis, decoded));
+            CHECK(decoded == field);
+
+            std::vector<uint8_t> compressed{};
+            std::vector<uint8_t> decompressed{};
+            FieldCodec::compressLZ(runs, compressed);
+            CHECK(FieldCodec::decompressLZ(compressed, decompressed));
+            CHECK(decompressed == runs);
+        }
+
+        std::vector<uint8_t> runs{};
+        FieldCodec::encodeRowRuns(field, runs);
+
+        decoded.fill(0x1234);
+        CHECK(FieldCodec::decodeRowRuns(runs, decoded));
+        CHECK(decoded == field);
+    }
+}
+
+static void TestTruncated() {
+    auto fields = TestFields();
+
+    ByteArray bytes{};
+    FieldCodec::encode(fields[3], bytes);
+    size_t size = bytes.GetCursor();
+
+    for (size_t cut = 0; cut < size; cut += 1 + cut / 4) {
+        ByteArray truncated{};
+        truncated.Append(cut, bytes.GetData().data());
+        truncated.SetCursor(0);
+
+        Rows decoded{};
+        CHECK(!FieldCodec::decode(truncated, decoded));
+    }
+}
+
+static std::vector<BlockID> ReadAll(SparseBlockArray& array) {
+    std::vector<BlockID> blocks{};
+    for (int x = 0; x < 64; x++)
+        for (int y = 0; y < 64; y++)
+            for (int z = 0; z < 64; z++)
+                blocks.push_back(array.getBlock({x, y, z})->id);
+
+    return blocks;
+}
+
+static void TestBlockArray() {
+    std::mt19937 random(2);
+
+    SparseBlockArray array{};
+    for (int x = 0; x < 64; x++)
+        for (int z = 0; z < 64; z++)
+            for (int y = 0; y < 20 + (x + z) % 5; y++)
+                array.setBlock({x, y, z}, {static_cast<BlockID>(random() % 20 == 0 ? 5 : 1 + (y > 18) + (y > 20))});
+    array.setBlock({5, 40, 5}, {4});
+
+    auto expected = ReadAll(array);
+
+    ByteArray bytes{};
+    CHECK(Serializer::Serialize<SparseBlockArray>(array, bytes));
+    bytes.SetCursor(0);
+    CHECK(bytes.Read<uint8_t>() == FieldCodec::format_version);
+
+    bytes.SetCursor(0);
+    SparseBlockArray loaded{};
+    CHECK(Serializer::Deserialize<SparseBlockArray>(loaded, bytes));
+    CHECK(ReadAll(loaded) == expected);
+
+    /*
+        The format before the codec, the empty flag followed by every field in the row scheme of BitField3D
+    */
+    std::array<BitField3D, 6> layers{};
+    BitField3D solid{};
+    for (uint x = 0; x < 64; x++)
+        for (uint y = 0; y < 64; y++)
+            for (uint z = 0; z < 64; z++) {
+                BlockID id = expected[(x * 64 + y) * 64 + z];
+                if (id == BLOCK_AIR_INDEX)
+                    continue;
+
+                layers[id - 1].set(x, y, z);
+                if (id != 4)
+                    solid.set(x, y, z);
+            }
+
+    ByteArray legacy{};
+    legacy.Append<bool>(false);
+    legacy.Append(solid.getCompressed());
+    legacy.Append<size_t>(5);
+    for (BlockID id : {1, 2, 3, 4, 5}) {
+        legacy.Append<BlockID>(id);
+        legacy.Append(layers[id - 1].getCompressed());
+    }
+    legacy.Append<size_t>(0);
+    legacy.SetCursor(0);
+
+    SparseBlockArray legacy_loaded{};
+    CHECK(Serializer::Deserialize<SparseBlockArray>(legacy_loaded, legacy));
+    CHECK(ReadAll(legacy_loaded) == expected);
+
+    ByteArray legacy_empty{};
+    legacy_empty.Append<bool>(true);
+    legacy_empty.SetCursor(0);
+
+    SparseBlockArray empty{};
+    CHECK(Serializer::Deserialize<SparseBlockArray>(empty, legacy_empty));
+    CHECK(empty.isEmpty());
+}
+
+int main() {
+    RegisterTestBlocks();
+
+    TestRoundTrip();
+    TestTruncated();
+    TestBlockArray();
+
+    return Test::Result();
+}
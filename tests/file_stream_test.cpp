@@ -0,0 +1,113 @@
+#include <filesystem>
+#include <fstream>
+
+#include <structure/record_store.hpp>
+#include <structure/streams/file_stream.hpp>
+#include <vec_hash.hpp>
+
+#include <test.hpp>
+
+struct TestHeader {
+    int value = 0;
+};
+
+using Store = RecordStore<glm::ivec3, TestHeader, IVec3Hash, IVec3Equal>;
+
+const fs::path small_path = "file_stream_test_small.dat";
+const fs::path store_path = "file_stream_test_store.dat";
+const fs::path copy_path  = "file_stream_test_copy.dat";
+
+/*
+    Files that are only read keep their size, files written past their end are cut back to what was written
+*/
+static void TestSize() {
+    fs::remove(small_path);
+    {
+        std::ofstream file(small_path, std::ios::binary);
+        for (int i = 0; i < 1033; i++)
+            file.put(static_cast<char>(i));
+    }
+
+    {
+        FileStream stream{};
+        CHECK(stream.Open(small_path));
+        CHECK(stream.Size() == 1033);
+        CHECK(fs::file_size(small_path) == 1033);
+
+        byte value = 0;
+        CHECK(stream.Read(1032, 1, &value));
+        CHECK(value == static_cast<byte>(1032));
+        CHECK(!stream.Read(1033, 1, &value));
+    }
+    CHECK(fs::file_size(small_path) == 1033);
+
+    {
+        FileStream stream{};
+        CHECK(stream.Open(small_path));
+
+        std::vector<byte> data(5000, 7);
+        CHECK(stream.Write(1000, data.size(), data.data()));
+        CHECK(stream.Size() == 6000);
+        CHECK(stream.Flush());
+    }
+    CHECK(fs::file_size(small_path) == 6000);
+
+    fs::remove(small_path);
+}
+
+/*
+    After a flush the file holds the records and the metadata to find them, even while the store stays open
+*/
+static void TestStoreFlush() {
+    fs::remove(store_path);
+    fs::remove(copy_path);
+
+    Store store{};
+    auto init = [&](FileStream* s) {
+        store.SetBuffer(s);
+        store.ResetHeader();
+    };
+    auto load = [&](FileStream* s) { store.SetBuffer(s); };
+
+    FileStream stream(init, load);
+    CHECK(stream.Open(store_path));
+
+    std::vector<byte> value(3000);
+    for (int key = 0; key < 100; key++) {
+        std::fill(value.begin(), value.end(), static_cast<byte>(key));
+        store.Save({key, 0, 0}, value.size(), value.data());
+    }
+    for (int key = 0; key < 100; key += 3)
+        store.Delete({key, 0, 0});
+
+    store.Flush();
+    fs::copy_file(store_path, copy_path);
+
+    {
+        Store copy{};
+        FileStream copy_stream(nullptr, [&](FileStream* s) { copy.SetBuffer(s); });
+        CHECK(copy_stream.Open(copy_path));
+
+        std::vector<byte> output{};
+        for (int key = 0; key < 100; key++) {
+            bool stored = copy.Get({key, 0, 0}, output);
+            CHECK(stored == (key % 3 != 0));
+            if (stored)
+                CHECK(output == std::vector<byte>(3000, static_cast<byte>(key)));
+        }
+
+        copy.SetBuffer(nullptr);
+    }
+
+    store.SetBuffer(nullptr);
+
+    fs::remove(store_path);
+    fs::remove(copy_path);
+}
+
+int main() {
+    TestSize();
+    TestStoreFlush();
+
+    return Test::Result();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <structure/streams/buffer.hpp>
+
+/**
+ * @brief A buffer kept in memory, copying it is the state a crash would leave on the disk
+ *
+ */
+struct MemoryBuffer : public Buffer {
+    std::vector<byte> data;
+    std::mutex mutex;
+
+    MemoryBuffer() {}
+    MemoryBuffer(const MemoryBuffer& other) : data(other.data) {}
+
+    bool Read(size_t offset, size_t size, byte* output) override {
+        std::lock_guard lock(mutex);
+        if (offset + size > data.size())
+            return false;
+
+        std::memcpy(output, data.data() + offset, size);
+        return true;
+    }
+
+    bool Write(size_t offset, size_t size, const byte* input) override {
+        std::lock_guard lock(mutex);
+        if (offset + size > data.size())
+            data.resize(offset + size);
+
+        std::memcpy(data.data() + offset, input, size);
+        return true;
+    }
+
+    size_t Size() override {
+        std::lock_guard lock(mutex);
+        return data.size();
+    }
+};
+
+/**
+ * @brief A buffer kept in memory that counts the bytes written into it
+ *
+ */
+struct CountingBuffer : public MemoryBuffer {
+    size_t written = 0;
+
+    bool Write(size_t offset, size_t size, const byte* input) override {
+        written += size;
+        return MemoryBuffer::Write(offset, size, input);
+    }
+};
@@ -0,0 +1,101 @@
+#include <bit>
+#include <cstdio>
+
+#include <game/world/mesh_generation.hpp>
+#include <rendering/instanced_mesh.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+#include <test_mesh.hpp>
+
+/*
+    Meshes have to stay the same face for face, in the same order. The hashes were recorded with the mesher from before
+    occlusion planes were split in a single pass, any change to the greedy merge or the face order shows up here
+*/
+
+struct ExpectedMesh {
+    const char* name;
+    TestChunkKind kind;
+    size_t faces;
+    uint64_t hash;
+};
+
+const std::array<ExpectedMesh, 2> expected_meshes = {{
+    {"terrain", TestChunkKind::TERRAIN, 14493, 0xa3e9648ef2a9b7e1ULL},
+    {"random", TestChunkKind::RANDOM, 353556, 0xf6b2aaf7e960c6a0ULL},
+}};
+
+static uint64_t HashFaces(const std::vector<RecordingMesh::Face>& faces) {
+    uint64_t hash = 1469598103934665603ULL;
+    auto add      = [&](uint32_t value) { hash = (hash ^ value) * 1099511628211ULL; };
+
+    for (auto& face : faces) {
+        add(face.position.x);
+        add(face.position.y);
+        add(face.position.z);
+        add(std::bit_cast<uint32_t>(face.width));
+        add(std::bit_cast<uint32_t>(face.height));
+        add(face.texture_index);
+        add(face.type);
+        add(face.direction);
+        for (float occlusion : face.occlusion)
+            add(std::bit_cast<uint32_t>(occlusion));
+    }
+
+    return hash;
+}
+
+int main() {
+    RegisterTestBlocks();
+
+    for (auto& expected : expected_meshes) {
+        // A chunk in a world of the same chunks, the faces towards its neighbours are meshed too
+        Terrain world{};
+        for (int x = -1; x <= 0; x++)
+            for (int y = -1; y <= 0; y++)
+                for (int z = -1; z <= 0; z++) {
+                    auto chunk = std::make_unique<Chunk>(glm::ivec3{x, y, z});
+                    FillTestChunk(*chunk, expected.kind, 7 + x * 4 + y * 2 + z);
+                    world.addChunk({x, y, z}, std::move(chunk));
+                }
+
+        ChunkMeshGenerator generator{};
+        generator.setWorld(&world);
+
+        Chunk& chunk = *world.getChunk({0, 0, 0});
+        auto faces   = MeshTestChunk(generator, chunk);
+
+        if (faces.size() != expected.faces || HashFaces(faces) != expected.hash)
+            printf("%s: %zu faces, hash %016llx\n", expected.name, faces.size(), static_cast<unsigned long long>(HashFaces(faces)));
+
+        CHECK(faces.size() == expected.faces);
+        CHECK(HashFaces(faces) == expected.hash);
+
+        // Planes are consumed while meshing, whatever is left over would show up in the next mesh
+        CHECK(MeshTestChunk(generator, chunk) == faces);
+
+        // An edit of every plane is meshed into segments and replayed, it has to give the same faces
+        DirtyPlanes all_planes{};
+        all_planes.markAll();
+
+        auto replayed        = std::make_unique<RecordingMesh>();
+        auto* replayed_faces = replayed.get();
+        CHECK(generator.syncUpdateAsyncUploadMesh(&chunk, std::move(replayed), all_planes));
+        CHECK(replayed_faces->faces == faces);
+        generator.clear();
+
+        // Meshes that store packed faces take the segments as they are
+        auto packed           = std::make_unique<InstancedMesh>();
+        auto* packed_instance = packed.get();
+        auto direct           = std::make_unique<InstancedMesh>();
+        auto* direct_instance = direct.get();
+        CHECK(generator.syncUpdateAsyncUploadMesh(&chunk, std::move(packed), all_planes));
+        CHECK(generator.syncGenerateAsyncUploadMesh(&chunk, std::move(direct), BitField3D::NONE));
+        for (int type = 0; type < 4; type++)
+            CHECK(packed_instance->getInstanceData(static_cast<MeshInterface::FaceType>(type)) ==
+                  direct_instance->getInstanceData(static_cast<MeshInterface::FaceType>(type)));
+        generator.clear();
+    }
+
+    return Test::Result();
+}
@@ -0,0 +1,74 @@
+#include <random>
+
+#include <rendering/packed_face.hpp>
+
+#include <test.hpp>
+
+/*
+    Every field of a face has to come back unchanged after packing, the shader decodes the same layout
+*/
+
+static bool RoundTrips(const PackedFace::Fields& fields) {
+    auto unpacked = PackedFace::Pack(fields).unpack();
+
+    return unpacked.position == fields.position && unpacked.width == fields.width && unpacked.height == fields.height &&
+           unpacked.texture_index == fields.texture_index && unpacked.type == fields.type &&
+           unpacked.direction == fields.direction && unpacked.occlusion == fields.occlusion;
+}
+
+int main() {
+    // Positions include 64, faces on the far side of the chunk
+    for (int x = 0; x <= 64; x++)
+        for (int y = 0; y <= 64; y++)
+            for (int z = 0; z <= 64; z++)
+                CHECK(RoundTrips({{x, y, z}, 1, 1, 0, MeshInterface::X_ALIGNED, MeshInterface::Forward, {0, 0, 0, 0}}));
+
+    // Sizes of 64 are stored as 0
+    for (int width = 1; width <= 64; width++)
+        for (int height = 1; height <= 64; height++)
+            for (int type = 0; type < 4; type++)
+                for (int direction = 0; direction < 2; direction++)
+                    CHECK(RoundTrips({{1, 2, 3},
+                                      width,
+                                      height,
+                                      5,
+                                      static_cast<MeshInterface::FaceType>(type),
+                                      static_cast<MeshInterface::Direction>(direction),
+                                      {1, 2, 3, 0}}));
+
+    for (int occlusion = 0; occlusion < 256; occlusion++)
+        CHECK(RoundTrips({{0, 0, 0},
+                          1,
+                          1,
+                          0,
+                          MeshInterface::Y_ALIGNED,
+                          MeshInterface::Backward,
+                          {occlusion & 3, (occlusion >> 2) & 3, (occlusion >> 4) & 3, (occlusion >> 6) & 3}}));
+
+    for (int texture = 0; texture <= PackedFace::max_texture_index; texture++)
+        CHECK(RoundTrips({{64, 64, 64}, 64, 64, texture, MeshInterface::BILLBOARD, MeshInterface::Backward, {3, 3, 3, 3}}));
+
+    std::mt19937 random(1);
+    for (int i = 0; i < 100000; i++) {
+        PackedFace::Fields fields{};
+        fields.position      = {random() % 65, random() % 65, random() % 65};
+        fields.width         = random() % 64 + 1;
+        fields.height        = random() % 64 + 1;
+        fields.texture_index = random() % (PackedFace::max_texture_index + 1);
+        fields.type          = static_cast<MeshInterface::FaceType>(random() % 4);
+        fields.direction     = static_cast<MeshInterface::Direction>(random() % 2);
+        for (auto& corner : fields.occlusion)
+            corner = random() % 4;
+
+        CHECK(RoundTrips(fields));
+    }
+
+    // The shader reads occlusion in GL_TRIANGLE_STRIP order, the last two corners are swapped
+    auto face = PackedFace::Pack({{0, 0, 0}, 1, 1, 0, MeshInterface::X_ALIGNED, MeshInterface::Forward, {0, 1, 2, 3}});
+    CHECK(((face.second >> 6) & 3) == 0);
+    CHECK(((face.second >> 8) & 3) == 1);
+    CHECK(((face.second >> 10) & 3) == 3);
+    CHECK(((face.second >> 12) & 3) == 2);
+
+    return Test::Result();
+}
@@ -0,0 +1,110 @@
+#include <random>
+
+#include <game/world/terrain.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+#include <test_mesh.hpp>
+#include <test_raycast.hpp>
+
+/*
+    Terrain::raycast skips empty rows and chunks, it has to end in the same block, through the same face and at the same
+    distance as a DDA that reads every block on the way
+*/
+
+// 8x3x8 chunks, full chunks under terrain under empty chunks, with a missing chunk in the middle of the terrain
+static void FillWorld(Terrain& terrain) {
+    for (int x = -4; x < 4; x++)
+        for (int y = -1; y < 2; y++)
+            for (int z = -4; z < 4; z++) {
+                if (x == 0 && y == 0 && z == 0)
+                    continue;
+
+                auto chunk = std::make_unique<Chunk>(glm::ivec3{x, y, z});
+                if (y == -1)
+                    FillTestChunk(*chunk, TestChunkKind::FULL);
+                if (y == 0)
+                    FillTestChunk(*chunk, TestChunkKind::TERRAIN, 7 + x * 8 + z);
+
+                terrain.addChunk({x, y, z}, std::move(chunk));
+            }
+}
+
+static bool Same(const RaycastResult& result, const RaycastResult& expected) {
+    if (result.hit != expected.hit)
+        return false;
+    if (!result.hit)
+        return true;
+
+    return result.position == expected.position && glm::ivec3(result.lastPosition) == glm::ivec3(expected.lastPosition) &&
+           result.normal == expected.normal && std::abs(result.distance - expected.distance) < 1e-3f;
+}
+
+static void TestSimple(Terrain& terrain) {
+    // Straight down onto the full chunks through the hole of the missing chunk
+    auto down = terrain.raycast({10.5f, 100.5f, 10.5f}, {0, -1, 0}, 200);
+    CHECK(down.hit);
+    CHECK(down.position == glm::ivec3(10, -1, 10));
+    CHECK(down.normal == glm::ivec3(0, 1, 0));
+    CHECK(std::abs(down.distance - 100.5f) < 1e-3f);
+
+    // Starting inside a block
+    auto inside = terrain.raycast({10.5f, -10.5f, 10.5f}, {1, 0, 0}, 10);
+    CHECK(inside.hit);
+    CHECK(inside.position == glm::ivec3(10, -11, 10));
+    CHECK(inside.normal == glm::ivec3(0, 0, 0));
+    CHECK(inside.distance == 0);
+
+    // Up into the empty chunks and out of the world
+    CHECK(!terrain.raycast({10.5f, 100.5f, 10.5f}, {0, 1, 0}, 300).hit);
+    CHECK(!terrain.raycast({10.5f, 100.5f, 10.5f}, {0, -1, 0}, 50).hit);
+}
+
+static void TestRandom(Terrain& terrain) {
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+
+    const int count = 20000;
+    int hits        = 0;
+    int same        = 0;
+    int same_block  = 0;
+
+    for (int i = 0; i < count; i++) {
+        glm::vec3 from = {uniform(random) * 200, 20 + (uniform(random) + 1) * 60, uniform(random) * 200};
+
+        glm::vec3 direction{};
+        do
+            direction = {uniform(random), uniform(random), uniform(random)};
+        while (glm::length(direction) < 0.1f);
+
+        // Some rays along planes, they never cross one of the axes
+        if (i % 10 == 0)
+            direction[random() % 3] = 0;
+        direction = glm::normalize(direction);
+
+        auto result = terrain.raycast(from, direction, 100);
+        hits += result.hit;
+        same += Same(result, BlockRaycast(terrain, from, direction, 100));
+
+        auto stepping = SteppingRaycast(terrain, from, direction, 100);
+        same_block += result.hit == stepping.hit && (!result.hit || result.position == stepping.position);
+    }
+
+    CHECK(hits > count / 4);
+    CHECK(same == count);
+
+    // The stepping raycast cuts across block corners now and then
+    CHECK(same_block > count * 999 / 1000);
+}
+
+int main() {
+    RegisterTestBlocks();
+
+    Terrain terrain{};
+    FillWorld(terrain);
+
+    TestSimple(terrain);
+    TestRandom(terrain);
+
+    return Test::Result();
+}
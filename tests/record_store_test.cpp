@@ -0,0 +1,193 @@
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+
+#include <structure/record_store.hpp>
+#include <vec_hash.hpp>
+
+#include <memory_buffer.hpp>
+#include <test.hpp>
+
+struct TestHeader {
+    int value = 0;
+};
+
+using Store = RecordStore<glm::ivec3, TestHeader, IVec3Hash, IVec3Equal>;
+
+const int key_count = 500;
+
+static std::vector<byte> RandomValue(std::mt19937_64& random, size_t max_size) {
+    std::vector<byte> value(1 + random() % max_size);
+    for (auto& b : value)
+        b = static_cast<byte>(random());
+    return value;
+}
+
+/*
+    Random saves and deletes checked against a map, reopening the store now and then
+*/
+static void TestAgainstReference() {
+    MemoryBuffer buffer{};
+    std::mt19937_64 random(7);
+    std::map<int, std::vector<byte>> reference{};
+
+    auto store = std::make_unique<Store>();
+    store->SetBuffer(&buffer);
+
+    size_t largest_live = 0;
+    for (int round = 0; round < 12; round++) {
+        for (int operation = 0; operation < 5000; operation++) {
+            int key = random() % key_count;
+
+            if (random() % 10 < 7) {
+                auto value = RandomValue(random, 6000);
+                store->Save({key, 0, 0}, value.size(), value.data());
+                reference[key] = value;
+            } else {
+                bool had = reference.erase(key) != 0;
+                CHECK(store->Delete({key, 0, 0}) == had);
+            }
+        }
+
+        auto stats   = store->GetSpaceStats();
+        largest_live = std::max(largest_live, stats.live_bytes);
+
+        // Freed space is reused within a session, the store stays close to its live size
+        CHECK(stats.disk_bytes < largest_live * 2);
+
+        if (round % 3 == 2) {
+            store->SetBuffer(nullptr);
+            store->SetBuffer(&buffer);
+        }
+        if (round % 4 == 3) {
+            store = std::make_unique<Store>();
+            store->SetBuffer(&buffer);
+        }
+
+        std::vector<byte> output{};
+        for (int key = 0; key < key_count; key++) {
+            auto expected = reference.find(key);
+            bool stored   = store->Get({key, 0, 0}, output);
+
+            CHECK(stored == (expected != reference.end()));
+            if (stored && expected != reference.end())
+                CHECK(output == expected->second);
+        }
+    }
+}
+
+/*
+    A copy of the buffer taken in the middle of a session is what a crash leaves behind,
+    every record it can still find has to hold a value that was saved under its key
+*/
+static void TestCrash() {
+    MemoryBuffer buffer{};
+    std::mt19937_64 random(3);
+
+    auto run = [&](Store& store, int operations) {
+        for (int i = 0; i < operations; i++) {
+            int key = random() % key_count;
+
+            if (random() % 4 == 0) {
+                store.Delete({key, 0, 0});
+                continue;
+            }
+
+            std::vector<byte> value(1 + random() % 3000, static_cast<byte>(key));
+            store.Save({key, 0, 0}, value.size(), value.data());
+        }
+    };
+
+    {
+        Store store{};
+        store.SetBuffer(&buffer);
+        run(store, 5000);
+    }
+
+    for (int crash = 0; crash < 4; crash++) {
+        Store store{};
+        store.SetBuffer(&buffer);
+        run(store, 1000 + crash * 1000);
+
+        MemoryBuffer crashed(buffer);
+
+        Store recovered{};
+        recovered.SetBuffer(&crashed);
+
+        std::vector<byte> output{};
+        size_t found = 0;
+        for (int key = 0; key < key_count; key++) {
+            if (!recovered.Get({key, 0, 0}, output))
+                continue;
+
+            found++;
+            bool intact = true;
+            for (auto b : output)
+                intact = intact && b == static_cast<byte>(key);
+            CHECK(intact);
+        }
+        CHECK(found > 0);
+
+        recovered.SetBuffer(nullptr);
+    }
+}
+
+/*
+    A store of many small record blocks and index pages, reopened it has every key. Commits only write what changed, so
+    saving a few keys of a large store writes only their records and index pages
+*/
+static void TestLargeIndex() {
+    CountingBuffer buffer{};
+    const int count = 40000;
+
+    // 157 blocks, more than the store caches
+    auto store = std::make_unique<Store>(256);
+    store->SetBuffer(&buffer);
+
+    for (int key = 0; key < count; key++)
+        store->Save({key, -key, key % 7}, sizeof(int), reinterpret_cast<byte*>(&key));
+    store->Flush();
+
+    size_t full_size = buffer.written;
+
+    // Values that fit their records and a few new keys
+    buffer.written = 0;
+    for (int key = 0; key < count; key += count / 10) {
+        int value = -key;
+        store->Save({key, -key, key % 7}, sizeof(int), reinterpret_cast<byte*>(&value));
+    }
+    for (int key = count; key < count + 3; key++)
+        store->Save({key, -key, key % 7}, sizeof(int), reinterpret_cast<byte*>(&key));
+    store->Flush();
+    CHECK(buffer.written < full_size / 5);
+
+    for (int key = 0; key < count; key += 3)
+        CHECK(store->Delete({key, -key, key % 7}));
+
+    store = std::make_unique<Store>(256);
+    store->SetBuffer(&buffer);
+
+    std::vector<byte> output{};
+    int found = 0;
+    int same  = 0;
+    for (int key = 0; key < count + 3; key++) {
+        if (!store->Get({key, -key, key % 7}, output))
+            continue;
+
+        int value = 0;
+        std::memcpy(&value, output.data(), sizeof(int));
+        found++;
+        same += value == (key % (count / 10) == 0 && key < count ? -key : key);
+    }
+    CHECK(found == count + 3 - (count + 2) / 3);
+    CHECK(same == found);
+}
+
+int main() {
+    TestAgainstReference();
+    TestCrash();
+    TestLargeIndex();
+
+    return Test::Result();
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <tuple>
+
+#include <game/structure.hpp>
+#include <game/world/mesh_generation.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+#include <test_mesh.hpp>
+#include <test_structure.hpp>
+
+/*
+    Structure::place has to leave the world the same as placing block by block: the same blocks, a chest with its own
+    metadata for every placed chest and the same faces when meshed. It returns only the loaded chunks that changed
+*/
+
+// 3x3x3 chunks, full chunks under test terrain under empty chunks
+static void FillWorld(Terrain& terrain) {
+    for (int x = -1; x <= 1; x++)
+        for (int y = -1; y <= 1; y++)
+            for (int z = -1; z <= 1; z++) {
+                auto chunk = std::make_unique<Chunk>(glm::ivec3{x, y, z});
+                if (y == -1)
+                    chunk->fill({1});
+                if (y == 0)
+                    FillTestChunk(*chunk, TestChunkKind::TERRAIN, 7 + (x + 1) * 3 + z + 1);
+
+                terrain.addChunk({x, y, z}, std::move(chunk));
+            }
+}
+
+// The layers of a chunk can end up in another order than with setBlock, so the faces are meshed in another order
+static std::vector<RecordingMesh::Face> SortedFaces(ChunkMeshGenerator& generator, Chunk& chunk) {
+    auto faces = MeshTestChunk(generator, chunk);
+
+    auto key = [](const RecordingMesh::Face& face) {
+        return std::make_tuple(face.position.x, face.position.y, face.position.z, face.direction, face.type, face.width,
+                               face.height, face.texture_index, face.occlusion);
+    };
+    std::sort(faces.begin(), faces.end(), [&](auto& a, auto& b) { return key(a) < key(b); });
+
+    return faces;
+}
+
+// Only the chunks either placement changed, a chunk pasted into by mistake is one of the changed chunks
+static void CheckSame(Terrain& placed, Terrain& expected, const Structure::PositionSet& changed) {
+    ChunkMeshGenerator placed_generator{};
+    ChunkMeshGenerator expected_generator{};
+    placed_generator.setWorld(&placed);
+    expected_generator.setWorld(&expected);
+
+    for (auto& position : changed) {
+        Chunk* chunk          = placed.getChunk(position);
+        Chunk* expected_chunk = expected.getChunk(position);
+
+        int same = 0;
+        for (int i = 0; i < CHUNK_SIZE; i++)
+            for (int j = 0; j < CHUNK_SIZE; j++)
+                for (int k = 0; k < CHUNK_SIZE; k++) {
+                    Block* block          = chunk->getBlock({i, j, k});
+                    Block* expected_block = expected_chunk->getBlock({i, j, k});
+                    same += block->id == expected_block->id && !block->metadata == !expected_block->metadata;
+                }
+        CHECK(same == CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
+
+        // The faces depend on the solid field
+        CHECK(SortedFaces(placed_generator, *chunk) == SortedFaces(expected_generator, *expected_chunk));
+    }
+}
+
+static void TestPlace(Structure& structure) {
+    // Aligned, unaligned, negative, at chunk corners and partly outside the loaded chunks
+    for (glm::ivec3 position : {glm::ivec3{0, 0, 0}, glm::ivec3{5, -3, 17}, glm::ivec3{-40, 20, -7}, glm::ivec3{-64, -64, 0},
+                                glm::ivec3{63, 1, -63}, glm::ivec3{-1, -1, -1}}) {
+        Terrain placed{};
+        Terrain expected{};
+        FillWorld(placed);
+        FillWorld(expected);
+
+        auto changed  = structure.place(position, placed);
+        auto visited  = VoxelPlace(structure, position, expected);
+        size_t loaded = 0;
+        for (auto& chunk_position : visited) {
+            bool is_loaded = expected.getChunk(chunk_position) != nullptr;
+            loaded += is_loaded;
+            CHECK(!is_loaded || changed.contains(chunk_position));
+        }
+        CHECK(changed.size() == loaded);
+
+        CheckSame(placed, expected, changed);
+    }
+}
+
+int main() {
+    RegisterTestBlocks();
+    BlockID chest = RegisterChestBlock();
+
+    Structure tower = LoadTower();
+    CHECK(tower.getSize().y > 0);
+    TestPlace(tower);
+
+    Structure cube = RandomStructure(64, chest);
+    TestPlace(cube);
+
+    return Test::Result();
+}
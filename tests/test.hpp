@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+/**
+ * @brief Minimal checks shared by the test executables
+ *
+ * A failed CHECK prints where it failed and the test keeps going, main returns Test::Result() so ctest sees the failures.
+ * Checks can run on several threads at once.
+ */
+namespace Test {
+
+inline std::atomic<int> failures = 0;
+
+inline int Result() {
+    if (failures != 0)
+        std::printf("%d checks failed\n", failures.load());
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Runs a function repeatedly and returns the fastest run in milliseconds, used by the benchmarks
+ *
+ */
+template <typename F>
+double Measure(F&& function, int repeats = 5) {
+    double best = 0;
+    for (int i = 0; i < repeats; i++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || milliseconds < best)
+            best = milliseconds;
+    }
+    return best;
+}
+
+} // namespace Test
+
+#define CHECK(condition)                                                                                                  \
+    do {                                                                                                                  \
+        if (!(condition)) {                                                                                               \
+            Test::failures++;                                                                                             \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);                                     \
+        }                                                                                                                 \
+    } while (0)
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <game/blocks.hpp>
+
+/**
+ * @brief Registers a few full blocks after air, ids 1 to 6, glass (4) is transparent
+ *
+ * Textures are only registered by name, nothing is loaded.
+ */
+inline void RegisterTestBlocks() {
+    auto& registry = BlockRegistry::get();
+    if (registry.registeredBlocksTotal() > 1)
+        return;
+
+    for (auto* name : {"stone", "dirt", "grass", "glass", "ore", "sand"}) {
+        registry.addTexture(name, std::string(name) + ".png");
+        registry.addFullBlock(name, name, std::string(name) == "glass");
+    }
+}
+
+/**
+ * @brief Registers the test blocks and the blocks the WorldGenerator places, it looks them up by name
+ *
+ */
+inline void RegisterGenerationBlocks() {
+    RegisterTestBlocks();
+
+    auto& registry = BlockRegistry::get();
+    if (registry.registeredBlocksTotal() > 7)
+        return;
+
+    for (auto* name : {"oak_log", "oak_leaves", "cactus", "grass_billboard", "volcanic_sand", "sand_stone", "water"}) {
+        registry.addTexture(name, std::string(name) + ".png");
+        registry.addFullBlock(name, name, std::string(name) == "water");
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cmath>
+#include <random>
+
+#include <game/world/mesh_generation.hpp>
+
+/**
+ * @brief A mesh that only records the faces it is given, in order
+ *
+ */
+class RecordingMesh : public MeshInterface {
+  public:
+    struct Face {
+        glm::ivec3 position;
+        float width;
+        float height;
+        int texture_index;
+        FaceType type;
+        Direction direction;
+        std::array<float, 4> occlusion;
+
+        bool operator==(const Face&) const = default;
+    };
+
+    std::vector<Face> faces{};
+
+    void addQuadFace(const glm::ivec3& position, float width, float height, int texture_index, FaceType type, Direction direction,
+                     const std::array<float, 4>& occlusion, const glm::vec3&) override {
+        faces.push_back({position, width, height, texture_index, type, direction, occlusion});
+    }
+    void preallocate(size_t, FaceType) override {}
+    bool empty() override {
+        return faces.empty();
+    }
+    void shrink() override {}
+};
+
+enum class TestChunkKind { EMPTY, FULL, TERRAIN, RANDOM };
+
+/**
+ * @brief Fills a chunk with test blocks (see RegisterTestBlocks), the same kind and seed always give the same chunk
+ *
+ * Terrain is stone with some sand, then dirt, a layer of glass and a few ores on top of rolling hills.
+ */
+inline void FillTestChunk(Chunk& chunk, TestChunkKind kind, uint32_t seed = 7) {
+    std::mt19937 random(seed);
+
+    if (kind == TestChunkKind::EMPTY)
+        return;
+
+    for (int x = 0; x < 64; x++)
+        for (int z = 0; z < 64; z++) {
+            int height = 20 + static_cast<int>(10 * std::sin(x * 0.07) + 8 * std::cos(z * 0.05) + 4 * std::sin((x + z) * 0.2));
+
+            for (int y = 0; y < 64; y++) {
+                BlockID id = BLOCK_AIR_INDEX;
+                if (kind == TestChunkKind::FULL)
+                    id = 1;
+                else if (kind == TestChunkKind::RANDOM)
+                    id = random() % 7;
+                else if (y < height - 4)
+                    id = random() % 40 == 0 ? 6 : 1;
+                else if (y < height - 1)
+                    id = 2;
+                else if (y == height - 1)
+                    id = 4;
+                else if (y == height && random() % 30 == 0)
+                    id = 5;
+
+                if (id != BLOCK_AIR_INDEX)
+                    chunk.setBlock({x, y, z}, {id}, true);
+            }
+        }
+}
+
+/**
+ * @brief Meshes a chunk and returns the faces, empty if nothing was meshed
+ *
+ * The generator needs a world set, the chunk doesn't have to be in it.
+ */
+inline std::vector<RecordingMesh::Face> MeshTestChunk(ChunkMeshGenerator& generator, Chunk& chunk) {
+    auto mesh      = std::make_unique<RecordingMesh>();
+    auto* recorded = mesh.get();
+
+    std::vector<RecordingMesh::Face> faces{};
+    if (generator.syncGenerateAsyncUploadMesh(&chunk, std::move(mesh), BitField3D::NONE))
+        faces = std::move(recorded->faces);
+
+    generator.clear(); // Drops the queued mesh
+    return faces;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+#include <game/world/terrain.hpp>
+
+/**
+ * @brief The raycast Terrain used before the DDA, moves a float position past each block boundary and reads every block
+ *
+ * Steps 0.001 past every boundary, so it can cut across the corner of a block the DDA enters.
+ */
+inline RaycastResult SteppingRaycast(Terrain& terrain, const glm::vec3& from, const glm::vec3& direction, float max_distance) {
+    auto delta_ratio = [](float direction, float local_distance) {
+        if (std::abs(direction) < 0.0001f)
+            return std::numeric_limits<float>::max();
+        return direction > 0.0f ? (1.0f - local_distance) / direction : local_distance / -direction;
+    };
+
+    glm::vec3 position = from;
+    glm::vec3 last_block_position{};
+    float distance = 0;
+
+    while (true) {
+        glm::vec3 block_position = glm::floor(position);
+
+        auto* block = terrain.getBlock(block_position);
+        if (block && block->id != BLOCK_AIR_INDEX)
+            return {block_position, last_block_position, true};
+
+        glm::vec3 local_position = glm::abs(position - block_position);
+        float ratio              = std::min({delta_ratio(direction.x, local_position.x), delta_ratio(direction.y, local_position.y),
+                                             delta_ratio(direction.z, local_position.z)}) +
+                      0.001f;
+
+        position += direction * ratio;
+        distance += glm::length(direction * ratio);
+        if (distance >= max_distance)
+            return {block_position, last_block_position, false};
+
+        last_block_position = block_position;
+    }
+}
+
+/**
+ * @brief A DDA that reads every block it passes through getBlock, Terrain::raycast has to give the same results
+ *
+ */
+inline RaycastResult BlockRaycast(Terrain& terrain, const glm::vec3& from, const glm::vec3& direction, float max_distance) {
+    glm::ivec3 block = glm::floor(from);
+    glm::ivec3 step{0};
+    glm::vec3 next_crossing{INFINITY};
+    glm::vec3 crossing_distance{INFINITY};
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (direction[axis] == 0)
+            continue;
+
+        step[axis]              = direction[axis] > 0 ? 1 : -1;
+        crossing_distance[axis] = std::abs(1 / direction[axis]);
+        float boundary          = step[axis] > 0 ? block[axis] + 1.0f : static_cast<float>(block[axis]);
+        next_crossing[axis]     = (boundary - from[axis]) / direction[axis];
+    }
+
+    glm::ivec3 previous = block;
+    float distance      = 0;
+    int last_axis       = -1;
+
+    while (distance <= max_distance) {
+        auto* found = terrain.getBlock(block);
+        if (found && found->id != BLOCK_AIR_INDEX) {
+            RaycastResult result{block, previous, true};
+            result.distance = distance;
+            if (last_axis >= 0)
+                result.normal[last_axis] = -step[last_axis];
+            return result;
+        }
+
+        int axis = next_crossing.x < next_crossing.y ? (next_crossing.x < next_crossing.z ? 0 : 2)
+                                                     : (next_crossing.y < next_crossing.z ? 1 : 2);
+
+        previous = block;
+        distance = next_crossing[axis];
+        block[axis] += step[axis];
+        next_crossing[axis] += crossing_distance[axis];
+        last_axis = axis;
+    }
+
+    return {block, previous, false};
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <filesystem>
+#include <random>
+
+#include <game/structure.hpp>
+#include <game/world/terrain.hpp>
+#include <structure/streams/file_stream.hpp>
+
+/**
+ * @brief Interface of the test chest, only creates empty metadata
+ *
+ */
+class TestChestInterface : public BlockInterface {
+  private:
+    struct Metadata : public BlockMetadata {
+        void serialize(ByteArray&) override {}
+    };
+
+    std::string name = "chest";
+
+  public:
+    void open(std::shared_ptr<BlockMetadata>, GameState*) override {}
+    std::shared_ptr<BlockMetadata> createMetadata() override {
+        return std::make_shared<Metadata>();
+    }
+    std::shared_ptr<BlockMetadata> deserialize(ByteArray&) override {
+        return nullptr;
+    }
+    const std::string& getName() override {
+        return name;
+    }
+};
+
+/**
+ * @brief Registers a chest block with an interface, every chest placed gets its own metadata
+ *
+ * @return BlockID of the chest
+ */
+inline BlockID RegisterChestBlock() {
+    auto& registry = BlockRegistry::get();
+    if (auto* chest = registry.getPrototype("chest"); chest && chest->name == "chest")
+        return chest->id;
+
+    registry.addTexture("chest", "chest.png");
+    registry.addFullBlock("chest", "chest");
+
+    BlockID id = registry.getPrototype("chest")->id;
+    registry.setPrototypeInterface(id, std::make_unique<TestChestInterface>());
+    return id;
+}
+
+/**
+ * @brief The Structure::place used before the layers were pasted, reads and sets every block one by one
+ *
+ * Also returns the positions of chunks that aren't loaded.
+ */
+inline Structure::PositionSet VoxelPlace(Structure& structure, const glm::ivec3& position, Terrain& world) {
+    Structure::PositionSet visited{};
+
+    // Block arrays cover the size of the structure, the last position included
+    glm::ivec3 extent = (ChunkCoordinates::ToChunk(structure.getSize()) + 1) * CHUNK_SIZE;
+
+    for (int x = 0; x < extent.x; x++)
+        for (int y = 0; y < extent.y; y++)
+            for (int z = 0; z < extent.z; z++) {
+                Block* block = structure.getBlock({x, y, z});
+                if (!block || block->id == BLOCK_AIR_INDEX)
+                    continue;
+
+                glm::ivec3 block_position = position + glm::ivec3{x, y, z};
+                visited.emplace(world.blockToChunkPosition(block_position));
+                world.setBlock(block_position, *block);
+            }
+
+    return visited;
+}
+
+/**
+ * @brief A cube of random blocks, ids 1 to 6 of the test blocks with half of it air, chests are one block in 16
+ *
+ * @param chest BLOCK_AIR_INDEX for a structure without chests
+ */
+inline Structure RandomStructure(int size, BlockID chest, uint32_t seed = 99) {
+    std::mt19937 random(seed);
+    Structure structure(size, size, size);
+
+    for (int x = 0; x < size; x++)
+        for (int y = 0; y < size; y++)
+            for (int z = 0; z < size; z++) {
+                int value = random() % 16;
+                if (value < 7)
+                    continue;
+
+                BlockID id = value == 7 && chest != BLOCK_AIR_INDEX ? chest : 1 + value % 6;
+                structure.setBlock({x, y, z}, {id});
+            }
+
+    return structure;
+}
+
+/**
+ * @brief Loads the tower the world generator places, from the resources of the repository
+ *
+ */
+inline Structure LoadTower() {
+    auto path = std::filesystem::path(__FILE__).parent_path() / ".." / "resources" / "structures" / "tower.structure";
+
+    ByteArray array{};
+    FileStream stream{};
+    stream.Open(path);
+    stream.MoveCursor(0);
+    array.LoadFromStream(stream);
+
+    Structure tower(0, 0, 0);
+    Serializer::Deserialize<Structure>(tower, array);
+    return tower;
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+
+#include <game/world/wave_function_collapse.hpp>
+#include <game/world/world_generation.hpp>
+
+#include <test.hpp>
+#include <test_blocks.hpp>
+
+/*
+    The same seed has to give the same blocks whichever order the chunks are generated in and on however many threads
+*/
+
+const int seed = 777;
+
+static uint64_t ChunkHash(Chunk& chunk) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (int x = 0; x < CHUNK_SIZE; x++)
+        for (int y = 0; y < CHUNK_SIZE; y++)
+            for (int z = 0; z < CHUNK_SIZE; z++)
+                hash = (hash ^ chunk.getBlock({x, y, z})->id) * 1099511628211ULL;
+
+    return hash;
+}
+
+static std::map<std::tuple<int, int, int>, uint64_t> Generate(WorldGenerator& generator, const std::vector<glm::ivec3>& order,
+                                                              int thread_count) {
+    generator.Clear();
+
+    std::map<std::tuple<int, int, int>, uint64_t> hashes{};
+    std::mutex hashes_mutex;
+    std::atomic<size_t> next = 0;
+
+    std::vector<std::thread> threads{};
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&]() {
+            for (size_t i; (i = next++) < order.size();) {
+                Chunk chunk(order[i]);
+                generator.GenerateTerrainChunk(&chunk, order[i]);
+
+                uint64_t hash = ChunkHash(chunk);
+
+                std::lock_guard lock(hashes_mutex);
+                hashes[{order[i].x, order[i].y, order[i].z}] = hash;
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return hashes;
+}
+
+static void TestTerrain() {
+    WorldGenerator generator{};
+    generator.SetSeed(seed);
+
+    std::vector<glm::ivec3> positions{};
+    for (int x = 18; x < 22; x++)
+        for (int z = -9; z < -5; z++)
+            for (int y = -1; y <= 1; y++)
+                positions.push_back({x, y, z});
+
+    auto reference = Generate(generator, positions, 1);
+
+    // Structures are spawned in the region, otherwise their placement isnt tested
+    size_t candidates = 0;
+    for (auto& position : positions)
+        candidates += generator.getHeightmapFor(position)->structure_candidates.size();
+    CHECK(candidates > 0);
+
+    for (int run = 1; run <= 2; run++) {
+        auto order = positions;
+        std::shuffle(order.begin(), order.end(), std::mt19937(run));
+
+        CHECK(Generate(generator, order, 4) == reference);
+    }
+}
+
+static void TestCaves() {
+    using WaveFunctionCollapse::ChunkDefinition;
+
+    // Two regions next to each other on every axis
+    std::vector<glm::ivec3> positions{};
+    for (int x = -8; x < 8; x++)
+        for (int y = -8; y < 8; y++)
+            for (int z = -8; z < 8; z++)
+                positions.push_back({x, y, z});
+
+    std::map<std::tuple<int, int, int>, const ChunkDefinition*> reference{};
+    for (auto& position : positions)
+        reference[{position.x, position.y, position.z}] = &ChunkDefinition::getDefinitionFor(position, seed);
+
+    auto order = positions;
+    std::shuffle(order.begin(), order.end(), std::mt19937(3));
+    for (size_t i = 0; i < order.size(); i += 97) {
+        auto& expected = reference[{order[i].x, order[i].y, order[i].z}];
+        CHECK(&ChunkDefinition::getDefinitionFor(order[i], seed) == expected);
+    }
+
+    // Neighbouring cells agree on the face between them, always across regions and nearly always inside of them
+    const std::array<glm::ivec3, 3> offsets = {glm::ivec3{1, 0, 0}, glm::ivec3{0, 1, 0}, glm::ivec3{0, 0, 1}};
+    const std::array<int, 3> faces          = {ChunkDefinition::RIGHT, ChunkDefinition::TOP, ChunkDefinition::BACK};
+
+    size_t total    = 0;
+    size_t disagree = 0;
+    for (auto& position : positions)
+        for (int axis = 0; axis < 3; axis++) {
+            auto neighbour = position + offsets[axis];
+            if (neighbour[axis] >= 8)
+                continue;
+
+            auto* definition       = const_cast<ChunkDefinition*>(reference[{position.x, position.y, position.z}]);
+            auto* other_definition = const_cast<ChunkDefinition*>(reference[{neighbour.x, neighbour.y, neighbour.z}]);
+
+            bool agrees = definition->getCrossTypes()[faces[axis]] == other_definition->getCrossTypes()[faces[axis] ^ 1];
+            total++;
+            disagree += !agrees;
+
+            if ((position[axis] >> 3) != (neighbour[axis] >> 3))
+                CHECK(agrees);
+        }
+
+    CHECK(disagree * 50 < total);
+}
+
+int main() {
+    RegisterGenerationBlocks();
+
+    TestCaves();
+    TestTerrain();
+
+    return Test::Result();
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#include <game/world/world_stream.hpp>
+#include <structure/record_store.hpp>
+#include <vec_hash.hpp>
+
+#include <memory_buffer.hpp>
+#include <test.hpp>
+#include <test_blocks.hpp>
+
+struct TestHeader {
+    int value = 0;
+};
+
+using Store = RecordStore<glm::ivec3, TestHeader, IVec3Hash, IVec3Equal>;
+
+static glm::ivec3 Marker(const glm::ivec3& position) {
+    return {(position.x * 7 + 3) & 63, (position.y * 5 + 11) & 63, (position.z * 13 + 1) & 63};
+}
+
+static BlockID MarkerBlock(size_t index) {
+    return static_cast<BlockID>(1 + index % 5);
+}
+
+/*
+    Far more segments than the cache and the save queue hold, saved from several threads while others flush,
+    every chunk has to come back after the store is reopened
+*/
+int main() {
+    RegisterTestBlocks();
+
+    MemoryBuffer buffer{};
+    auto store = std::make_shared<Store>();
+    store->SetBuffer(&buffer);
+
+    std::vector<glm::ivec3> positions{};
+    for (int x = -12; x < 12; x++)
+        for (int y = -4; y < 4; y++)
+            for (int z = -12; z < 12; z++)
+                positions.push_back({x, y, z});
+    std::shuffle(positions.begin(), positions.end(), std::mt19937(5));
+
+    {
+        WorldStream stream(store);
+
+        std::atomic<size_t> next = 0;
+        std::atomic<bool> saving = true;
+
+        auto save = [&]() {
+            size_t index = 0;
+            while ((index = next++) < positions.size()) {
+                auto position = positions[index];
+
+                auto chunk = std::make_unique<Chunk>(position);
+                chunk->setBlock(Marker(position), Block(MarkerBlock(index)), true);
+                CHECK(stream.Save(std::move(chunk)));
+
+                // Loading right back hits segments that are still waiting for the writer
+                if (index % 7 == 0) {
+                    auto loaded = stream.Load(position);
+                    CHECK(loaded != nullptr);
+                    if (loaded)
+                        stream.Save(std::move(loaded));
+                }
+            }
+        };
+
+        std::vector<std::thread> threads{};
+        for (int i = 0; i < 4; i++)
+            threads.emplace_back(save);
+
+        std::thread flusher([&]() {
+            while (saving) {
+                stream.Flush();
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        });
+
+        for (auto& thread : threads)
+            thread.join();
+
+        saving = false;
+        flusher.join();
+
+        stream.Flush();
+    }
+
+    store->SetBuffer(nullptr);
+    store->SetBuffer(&buffer);
+
+    WorldStream reopened(store);
+    for (size_t i = 0; i < positions.size(); i++) {
+        auto chunk = reopened.Load(positions[i]);
+        CHECK(chunk != nullptr);
+        if (chunk)
+            CHECK(chunk->getBlock(Marker(positions[i]))->id == MarkerBlock(i));
+    }
+
+    return Test::Result();
+}